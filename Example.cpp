@@ -27,8 +27,26 @@
 #include <QNodeViewEditor.h>
 #include <QNodeViewPort.h>
 #include <QNodeViewCanvas.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewPortTypeRegistry.h>
+#include <QNodeViewNodeTypeRegistry.h>
+#include <QNodeViewGraph.h>
+#include <QNodeViewGraphWriter.h>
+#include <QNodeViewPool.h>
+#include <QNodeViewTrace.h>
+#include <QNodeViewEventRecorder.h>
+#include <QNodeViewJournal.h>
+#include <QNodeViewSearchBox.h>
+#include <QNodeViewFocus.h>
+#include <QNodeViewAnimator.h>
+#include <QNodeViewConnection.h>
 
 #include <Example.h>
+#include <ExampleTypes.h>
+
+// Journals are folded into a fresh save once they hold this many edits, each fold builds a snapshot on the GUI thread
+static const qint64 s_compactionThreshold = 1000;
+static const qint32 s_compactionInterval = 60 * 1000;
 
 int main(int argc, char* argv[])
 {
@@ -41,25 +59,63 @@ int main(int argc, char* argv[])
 
 ExampleMainWindow::ExampleMainWindow(QWidget* parent)
 : QMainWindow(parent)
+, m_compactedSequence(0)
+, m_blockCount(0)
 {
     setWindowTitle(tr("QNodeView Example"));
 
     createMenus();
 
-    m_scene = new QGraphicsScene();
+    // Blocks with very long port lists show a window of rows instead of growing without bound
+    QNodeViewBlock::setDefaultPortRowLimit(64);
+
+    QNodeViewScene* scene = new QNodeViewScene();
+    m_scene = scene;
     m_view = new QNodeViewCanvas(m_scene, this);
     setCentralWidget(m_view);
 
+    // Opened with Ctrl+F over the canvas
+    new QNodeViewSearchBox(m_view);
+
     m_editor = new QNodeViewEditor(this);
     m_editor->install(m_scene);
 
+    m_focus = new QNodeViewFocus(this);
+    m_focus->install(scene);
+
+    m_animator = new QNodeViewAnimator(this);
+    m_animator->install(scene);
+
+    m_writer = new QNodeViewGraphWriter(this);
+    connect(m_writer, SIGNAL(saved(QString, bool, QString)), this, SLOT(fileSaved(QString, bool, QString)));
+
+    m_recorder = new QNodeViewEventRecorder(this);
+
+    m_journal = new QNodeViewJournal();
+    m_editor->setJournal(m_journal);
+
+    QTimer* compactionTimer = new QTimer(this);
+    connect(compactionTimer, SIGNAL(timeout()), this, SLOT(compactJournal()));
+    compactionTimer->start(s_compactionInterval);
+
+    m_testNodeType = registerExampleTypes();
+
     addBlockInternal(QPointF(0, 0));
     addBlockInternal(QPointF(150, 0));
     addBlockInternal(QPointF(150, 150));
+
+    // Edits left in a journal by a crash are replayed over the last save
+    const QString lastFileName = QSettings("QNodeView", "Example").value("lastFile").toString();
+    QVector<QNodeViewJournalRecord> records;
+
+    if (!lastFileName.isEmpty() && QNodeViewJournal::read(lastFileName, records) && !records.isEmpty())
+        openFile(lastFileName);
 }
 
 ExampleMainWindow::~ExampleMainWindow()
 {
+    m_writer->waitForDone();
+    delete m_journal;
 }
 
 void ExampleMainWindow::addBlock()
@@ -73,10 +129,56 @@ void ExampleMainWindow::saveFile()
     if (fileName.isEmpty())
 		return;
 
-    QFile file(fileName);
-    file.open(QFile::WriteOnly);
-    QDataStream stream(&file);
-    m_editor->save(stream);
+    saveSnapshot(fileName);
+    statusBar()->showMessage(tr("Saving %1...").arg(fileName));
+}
+
+void ExampleMainWindow::saveSnapshot(const QString& fileName)
+{
+    // Building the snapshot walks the whole scene here, only writing it happens in the background
+    QNodeViewGraph graph;
+    m_editor->save(graph);
+    m_writer->save(graph, fileName, m_compressAction->isChecked());
+
+    // Edits made while the save is in flight stay in the journal
+    m_snapshotSequences.enqueue(m_journal->sequence());
+    m_compactedSequence = m_journal->sequence();
+}
+
+void ExampleMainWindow::fileSaved(const QString& fileName, bool success, const QString& errorString)
+{
+    if (!success)
+    {
+        statusBar()->showMessage(tr("Failed to save %1: %2").arg(fileName, errorString));
+        return;
+    }
+
+    statusBar()->showMessage(tr("Saved %1").arg(fileName), 2000);
+
+    // Saves from before the last load or clear have nothing to do with the journal
+    if (m_snapshotSequences.isEmpty())
+        return;
+
+    const qint64 sequence = m_snapshotSequences.dequeue();
+
+    if (m_journal->isOpen())
+        m_journal->compact(fileName, sequence);
+    else
+        m_journal->open(fileName);
+
+    QSettings("QNodeView", "Example").setValue("lastFile", fileName);
+}
+
+void ExampleMainWindow::compactJournal()
+{
+    if (!m_journal->errorString().isEmpty())
+        statusBar()->showMessage(tr("Journal error: %1").arg(m_journal->errorString()));
+
+    if (!m_journal->isOpen() || m_writer->isBusy())
+        return;
+
+    if (m_journal->sequence() - m_compactedSequence >= s_compactionThreshold)
+        saveSnapshot(m_journal->snapshotFileName());
 }
 
 void ExampleMainWindow::loadFile()
@@ -85,10 +187,159 @@ void ExampleMainWindow::loadFile()
     if (fileName.isEmpty())
 		return;
 
-    QFile file(fileName);
-    file.open(QFile::ReadOnly);
-    QDataStream stream(&file);
-    m_editor->load(stream);
+    openFile(fileName);
+}
+
+void ExampleMainWindow::openFile(const QString& fileName)
+{
+    // A pending save of the same file has to land first
+    m_writer->waitForDone();
+
+    m_journal->close();
+    m_snapshotSequences.clear();
+    m_compactedSequence = 0;
+
+    QNodeViewGraph graph;
+    QString errorString;
+
+    if (!graph.loadFile(fileName, &errorString))
+    {
+        statusBar()->showMessage(tr("Failed to load %1: %2").arg(fileName, errorString));
+        return;
+    }
+
+    const qint64 allocations = pooledAllocations();
+
+    QElapsedTimer timer;
+    timer.start();
+    m_editor->load(graph);
+
+    QString message = tr("Loaded %1 in %2 ms, %3 pooled allocations").arg(fileName).arg(timer.elapsed()).arg(pooledAllocations() - allocations);
+
+    QVector<QNodeViewJournalRecord> records;
+    if (!QNodeViewJournal::read(fileName, records, &errorString))
+        message += tr(", journal ignored: %1").arg(errorString);
+    else if (!records.isEmpty())
+        message += tr(", recovered %1 of %2 edits").arg(m_editor->replay(records)).arg(records.size());
+
+    if (!m_journal->open(fileName, &errorString))
+        message += tr(", journaling disabled: %1").arg(errorString);
+
+    QSettings("QNodeView", "Example").setValue("lastFile", fileName);
+    statusBar()->showMessage(message);
+}
+
+void ExampleMainWindow::clearScene()
+{
+    const qint64 deallocations = pooledDeallocations();
+
+    // The editor closes the journal, the snapshots it was folded into go with it
+    m_snapshotSequences.clear();
+    m_compactedSequence = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    m_editor->clear();
+
+    statusBar()->showMessage(tr("Cleared in %1 ms, %2 pooled deallocations").arg(timer.elapsed()).arg(pooledDeallocations() - deallocations));
+}
+
+qint64 ExampleMainWindow::pooledAllocations()
+{
+    qint64 result = 0;
+
+    Q_FOREACH (const QNodeViewPoolBase::Statistics& statistics, QNodeViewPoolBase::allStatistics())
+        result += statistics.allocations;
+
+    return result;
+}
+
+qint64 ExampleMainWindow::pooledDeallocations()
+{
+    qint64 result = 0;
+
+    Q_FOREACH (const QNodeViewPoolBase::Statistics& statistics, QNodeViewPoolBase::allStatistics())
+        result += statistics.deallocations;
+
+    return result;
+}
+
+void ExampleMainWindow::exportTrace()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Trace"), QString(), tr("Chrome Trace (*.json)"));
+    if (fileName.isEmpty())
+        return;
+
+    QString errorString;
+    if (!QNodeViewTrace::writeChromeTrace(fileName, &errorString))
+        statusBar()->showMessage(tr("Failed to export trace: %1").arg(errorString));
+}
+
+void ExampleMainWindow::toggleFocus(bool enabled)
+{
+    m_focus->setEnabled(enabled);
+}
+
+void ExampleMainWindow::toggleFocusCulling(bool culling)
+{
+    m_focus->setMode(culling ? QNodeViewFocus_Cull : QNodeViewFocus_Dim);
+}
+
+void ExampleMainWindow::widenFocus()
+{
+    m_focus->setHops(m_focus->hops() + 1);
+    statusBar()->showMessage(tr("Focus on %1 hops, %2 blocks").arg(m_focus->hops()).arg(m_focus->focusedCount()), 2000);
+}
+
+void ExampleMainWindow::narrowFocus()
+{
+    m_focus->setHops(m_focus->hops() - 1);
+    statusBar()->showMessage(tr("Focus on %1 hops, %2 blocks").arg(m_focus->hops()).arg(m_focus->focusedCount()), 2000);
+}
+
+void ExampleMainWindow::toggleActivity()
+{
+    // Marks the wires of the selected blocks as carrying data, or idle again
+    QSet<QNodeViewConnection*> connections;
+
+    Q_FOREACH (QGraphicsItem* item, m_scene->selectedItems())
+    {
+        if (item->type() != QNodeViewType_Block)
+            continue;
+
+        Q_FOREACH (QNodeViewPort* port, static_cast<QNodeViewBlock*>(item)->ports())
+        {
+            Q_FOREACH (QNodeViewConnection* connection, port->connections())
+                connections.insert(connection);
+        }
+    }
+
+    Q_FOREACH (QNodeViewConnection* connection, connections)
+        connection->setActive(!connection->isActive());
+
+    statusBar()->showMessage(tr("%1 active wires").arg(m_animator->activeCount()), 2000);
+}
+
+void ExampleMainWindow::toggleRecording(bool recording)
+{
+    if (recording)
+    {
+        m_recorder->start(m_view);
+        statusBar()->showMessage(tr("Recording session"));
+        return;
+    }
+
+    m_recorder->stop();
+
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Recording"), QString(), tr("Session Recording (*.qnvr)"));
+    if (fileName.isEmpty())
+        return;
+
+    QString errorString;
+    if (!m_recorder->recording().save(fileName, &errorString))
+        statusBar()->showMessage(tr("Failed to save recording: %1").arg(errorString));
+    else
+        statusBar()->showMessage(tr("Saved %1 recorded events to %2").arg(m_recorder->recording().events.size()).arg(fileName));
 }
 
 void ExampleMainWindow::createMenus()
@@ -108,36 +359,77 @@ void ExampleMainWindow::createMenus()
     saveAction->setStatusTip(tr("Save node view to file"));
     connect(saveAction, SIGNAL(triggered()), this, SLOT(saveFile()));
 
+    m_compressAction = new QAction(tr("&Compress Saves"), this);
+    m_compressAction->setCheckable(true);
+    m_compressAction->setStatusTip(tr("Compress saved files"));
+
+    QAction* clearAction = new QAction(tr("&Clear"), this);
+    clearAction->setStatusTip(tr("Remove all blocks"));
+    connect(clearAction, SIGNAL(triggered()), this, SLOT(clearScene()));
+
     QAction* addAction = new QAction(tr("&Add"), this);
     addAction->setStatusTip(tr("Add new block"));
     connect(addAction, SIGNAL(triggered()), this, SLOT(addBlock()));
 
     m_fileMenu = menuBar()->addMenu(tr("&File"));
     m_fileMenu->addAction(addAction);
+    m_fileMenu->addAction(clearAction);
     m_fileMenu->addAction(loadAction);
     m_fileMenu->addAction(saveAction);
+    m_fileMenu->addAction(m_compressAction);
+
+    QAction* recordAction = new QAction(tr("&Record Session"), this);
+    recordAction->setCheckable(true);
+    recordAction->setStatusTip(tr("Record canvas input for QNodeViewReplay"));
+    connect(recordAction, SIGNAL(toggled(bool)), this, SLOT(toggleRecording(bool)));
+    m_fileMenu->addAction(recordAction);
+
+    QAction* focusAction = new QAction(tr("&Focus Selection"), this);
+    focusAction->setCheckable(true);
+    focusAction->setShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_F));
+    focusAction->setStatusTip(tr("Show only the neighborhood of the selected block"));
+    connect(focusAction, SIGNAL(toggled(bool)), this, SLOT(toggleFocus(bool)));
+
+    QAction* cullAction = new QAction(tr("&Hide Outside Focus"), this);
+    cullAction->setCheckable(true);
+    cullAction->setStatusTip(tr("Hide everything outside the focus instead of dimming it"));
+    connect(cullAction, SIGNAL(toggled(bool)), this, SLOT(toggleFocusCulling(bool)));
+
+    QAction* widenAction = new QAction(tr("&Widen Focus"), this);
+    widenAction->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_BracketRight));
+    connect(widenAction, SIGNAL(triggered()), this, SLOT(widenFocus()));
+
+    QAction* narrowAction = new QAction(tr("&Narrow Focus"), this);
+    narrowAction->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_BracketLeft));
+    connect(narrowAction, SIGNAL(triggered()), this, SLOT(narrowFocus()));
+
+    QAction* activityAction = new QAction(tr("Toggle Wire &Activity"), this);
+    activityAction->setShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_A));
+    activityAction->setStatusTip(tr("Animate the wires of the selected blocks"));
+    connect(activityAction, SIGNAL(triggered()), this, SLOT(toggleActivity()));
+
+    QMenu* viewMenu = menuBar()->addMenu(tr("&View"));
+    viewMenu->addAction(focusAction);
+    viewMenu->addAction(cullAction);
+    viewMenu->addAction(widenAction);
+    viewMenu->addAction(narrowAction);
+    viewMenu->addSeparator();
+    viewMenu->addAction(activityAction);
+
+#ifdef QNODEVIEW_TRACING
+    QNodeViewTrace::setEnabled(true);
+
+    QAction* traceAction = new QAction(tr("Export &Trace..."), this);
+    traceAction->setStatusTip(tr("Write recent trace events as a Chrome trace"));
+    connect(traceAction, SIGNAL(triggered()), this, SLOT(exportTrace()));
+    m_fileMenu->addAction(traceAction);
+#endif
     m_fileMenu->addSeparator();
     m_fileMenu->addAction(quitAction);
 }
 
 void ExampleMainWindow::addBlockInternal(const QPointF& position)
 {
-    QNodeViewBlock* block = new QNodeViewBlock(NULL);
-    m_scene->addItem(block);
-
-    static qint32 index = 1;
-    QString blockName = QString("myTest%1").arg(index++);
-
-    block->addPort(blockName, 0, QNodeViewPortLabel_Name);
-    block->addPort("TestEntity", 0, QNodeViewPortLabel_Type);
-
-    block->addInputPort("Input 1");
-    block->addInputPort("Input 2");
-    block->addInputPort("Input 3");
-
-    block->addOutputPort("Output 1");
-    block->addOutputPort("Output 2");
-    block->addOutputPort("Output 3");
-    block->addOutputPort("Output 4");
-    block->setPos(position);
+    // Every block gets a title of its own, so they can be told apart and searched for
+    m_editor->createBlock(m_testNodeType, position, tr("Test %1").arg(++m_blockCount));
 }
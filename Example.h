@@ -25,6 +25,11 @@
 #include <QtWidgets>
 
 class QNodeViewEditor;
+class QNodeViewGraphWriter;
+class QNodeViewEventRecorder;
+class QNodeViewJournal;
+class QNodeViewFocus;
+class QNodeViewAnimator;
 
 class ExampleMainWindow : public QMainWindow
 {
@@ -39,15 +44,41 @@ private slots:
 
 	void saveFile();
 	void loadFile();
+    void fileSaved(const QString& fileName, bool success, const QString& errorString);
+    void compactJournal();
+    void clearScene();
+    void exportTrace();
+    void toggleRecording(bool recording);
+    void toggleFocus(bool enabled);
+    void toggleFocusCulling(bool culling);
+    void widenFocus();
+    void narrowFocus();
+    void toggleActivity();
 
 private:
     void createMenus();
 
     void addBlockInternal(const QPointF& position);
 
+    void openFile(const QString& fileName);
+    void saveSnapshot(const QString& fileName);
+
+    static qint64 pooledAllocations();
+    static qint64 pooledDeallocations();
+
 private:
     QNodeViewEditor* m_editor;
+    QNodeViewGraphWriter* m_writer;
+    QNodeViewJournal* m_journal;
+    QQueue<qint64> m_snapshotSequences;
+    qint64 m_compactedSequence;
+    QNodeViewEventRecorder* m_recorder;
+    QNodeViewFocus* m_focus;
+    QNodeViewAnimator* m_animator;
+    QAction* m_compressAction;
     QMenu* m_fileMenu;
     QGraphicsView* m_view;
     QGraphicsScene* m_scene;
+    quint16 m_testNodeType;
+    qint32 m_blockCount;
 };
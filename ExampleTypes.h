@@ -0,0 +1,51 @@
+/*!
+  @file    ExampleTypes.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QNodeViewPortTypeRegistry.h>
+#include <QNodeViewNodeTypeRegistry.h>
+
+// Types used by the example, shared with the benchmarks and the replay tool so they load the same graphs
+
+static constexpr QNodeViewPortDescriptor s_testPorts[] =
+{
+    { "myTest",     false,  QNodeViewPortLabel_Name,    nullptr     },
+    { "TestEntity", false,  QNodeViewPortLabel_Type,    nullptr     },
+    { "Input 1",    false,  0,                          nullptr     },
+    { "Input 2",    false,  0,                          "Float"     },
+    { "Input 3",    false,  0,                          "Vector"    },
+    { "Output 1",   true,   0,                          nullptr     },
+    { "Output 2",   true,   0,                          "Float"     },
+    { "Output 3",   true,   0,                          "Vector"    },
+    { "Output 4",   true,   0,                          nullptr     }
+};
+
+static constexpr QNodeViewNodeDescriptor s_testNode = qNodeViewNodeDescriptor("TestEntity", s_testPorts);
+
+inline quint16 registerExampleTypes()
+{
+    const quint16 floatType = QNodeViewPortTypeRegistry::registerType("Float");
+    const quint16 vectorType = QNodeViewPortTypeRegistry::registerType("Vector");
+    QNodeViewPortTypeRegistry::setCompatible(floatType, vectorType);
+
+    return QNodeViewNodeTypeRegistry::registerType(s_testNode);
+}
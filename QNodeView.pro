@@ -1,4 +1,4 @@
-#/*!  @file    QNodeViewBlock.cpp
+#/*!  @file    QNodeView.pro
 #
 #  Copyright (c) 2014 Graham Wihlidal
 #
@@ -18,26 +18,28 @@
 #  @date    January 19, 2014
 #*/
 
-TARGET = QNodeView
-TEMPLATE = app
-
-QT += core gui widgets
-
-SOURCES +=  \
-            QNodeViewEditor.cpp \
-            QNodeViewPort.cpp \
-            QNodeViewConnection.cpp \
-            QNodeViewBlock.cpp \  
-            QNodeViewCanvas.cpp \
-            Example.cpp
-
-HEADERS  += \
-            QNodeViewEditor.h \
-            QNodeViewPort.h \
-            QNodeViewConnection.h \
-            QNodeViewBlock.h \
-            QNodeViewCommon.h \
-            QNodeViewCanvas.h \
-            Example.h
+TEMPLATE = subdirs
+
+# Headless graph model and serialization, usable without a display
+core.file = QNodeViewCore.pro
+
+widgets.file = QNodeViewWidgets.pro
+widgets.depends = core
+
+example.file = QNodeViewExample.pro
+example.depends = core widgets
+
+tool.file = QNodeViewTool.pro
+tool.depends = core
+
+# Headless benchmarks on the offscreen platform
+bench.file = QNodeViewBench.pro
+bench.depends = core widgets
+
+# Replays recorded sessions offscreen and reports interaction latency
+replay.file = QNodeViewReplay.pro
+replay.depends = core widgets
+
+SUBDIRS = core widgets example tool bench replay
 
 cache()
@@ -0,0 +1,157 @@
+/*!
+  @file    QNodeViewAnimator.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#include <QGraphicsView>
+#include <QRegion>
+
+#include <QNodeViewAnimator.h>
+#include <QNodeViewCanvas.h>
+#include <QNodeViewConnection.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewTrace.h>
+
+static const qint32 s_frameInterval = 16;
+
+QNodeViewAnimator::QNodeViewAnimator(QObject* parent)
+: QObject(parent)
+, m_scene(NULL)
+, m_lastFrameTime(0)
+, m_visibleCount(0)
+{
+    m_timer.setInterval(s_frameInterval);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(step()));
+
+    m_clock.start();
+}
+
+QNodeViewAnimator::~QNodeViewAnimator()
+{
+}
+
+void QNodeViewAnimator::install(QNodeViewScene* scene)
+{
+    Q_ASSERT(m_scene == NULL);
+
+    m_scene = scene;
+
+    connect(scene, SIGNAL(nodeItemAdded(QGraphicsItem*)), this, SLOT(itemAdded(QGraphicsItem*)));
+    connect(scene, SIGNAL(nodeItemRemoved(QGraphicsItem*)), this, SLOT(itemRemoved(QGraphicsItem*)));
+    connect(scene, SIGNAL(connectionActivityChanged(QGraphicsItem*)), this, SLOT(itemAdded(QGraphicsItem*)));
+
+    Q_FOREACH (QGraphicsItem* item, scene->items())
+        itemAdded(item);
+}
+
+void QNodeViewAnimator::wake()
+{
+    if (m_active.isEmpty() || m_timer.isActive())
+        return;
+
+    m_timer.start();
+}
+
+void QNodeViewAnimator::itemAdded(QGraphicsItem* item)
+{
+    if (item->type() != QNodeViewType_Connection)
+        return;
+
+    QNodeViewConnection* connection = static_cast<QNodeViewConnection*>(item);
+
+    if (!connection->isActive())
+    {
+        m_active.remove(connection);
+        return;
+    }
+
+    m_active.insert(connection);
+
+    watchCanvases();
+    wake();
+}
+
+void QNodeViewAnimator::itemRemoved(QGraphicsItem* item)
+{
+    // Connections leaving the scene, collapsed into a group for example, resume once they are added back
+    if (item->type() == QNodeViewType_Connection)
+        m_active.remove(static_cast<QNodeViewConnection*>(item));
+}
+
+void QNodeViewAnimator::step()
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewAnimator::step");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QNodeViewConnection::setActivityPhase(m_clock.nsecsElapsed() / 1000000000.0);
+
+    m_visibleCount = 0;
+
+    Q_FOREACH (QGraphicsView* view, m_scene->views())
+    {
+        if (!view->isVisible())
+            continue;
+
+        const QRectF visibleRect = view->mapToScene(view->viewport()->rect()).boundingRect();
+        QRegion dirty;
+
+        Q_FOREACH (QNodeViewConnection* connection, m_active)
+        {
+            // Focus culling leaves items visible but fully transparent
+            if (!connection->isVisible() || connection->effectiveOpacity() <= 0.0)
+                continue;
+
+            const QRectF area = connection->sceneBoundingRect() & visibleRect;
+            if (area.isEmpty())
+                continue;
+
+            // Extra pixels cover antialiasing at any zoom
+            dirty += view->mapFromScene(area).boundingRect().adjusted(-2, -2, 2, 2);
+            ++m_visibleCount;
+        }
+
+        // One update per view and frame, however many connections it covers
+        if (!dirty.isEmpty())
+            view->viewport()->update(dirty);
+    }
+
+    if (m_visibleCount == 0)
+        m_timer.stop();
+
+    m_lastFrameTime = timer.nsecsElapsed();
+}
+
+void QNodeViewAnimator::watchCanvases()
+{
+    Q_FOREACH (QGraphicsView* view, m_scene->views())
+    {
+        QNodeViewCanvas* canvas = qobject_cast<QNodeViewCanvas*>(view);
+        if (!canvas || m_canvases.contains(canvas))
+            continue;
+
+        // Navigating or editing repaints the canvas, which may bring active connections into view
+        connect(canvas, SIGNAL(frameRendered(qint64, bool)), this, SLOT(wake()));
+        m_canvases.append(canvas);
+    }
+
+    m_canvases.removeAll(QPointer<QNodeViewCanvas>());
+}
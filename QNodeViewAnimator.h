@@ -0,0 +1,83 @@
+/*!
+  @file    QNodeViewAnimator.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+
+class QGraphicsItem;
+class QNodeViewCanvas;
+class QNodeViewConnection;
+class QNodeViewScene;
+
+/*!
+    Drives the animation of connections marked with QNodeViewConnection::setActive().
+
+    One timer advances the phase shared by every active connection. Each frame
+    the active connections on screen are gathered into one region per view,
+    and that view's viewport is updated once; connections outside the views,
+    hidden or culled cost nothing. The timer stops as soon as no active
+    connection is on screen, and any repaint of a canvas on the scene, from
+    panning, zooming or editing, starts it again.
+*/
+class QNodeViewAnimator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QNodeViewAnimator(QObject* parent = NULL);
+    virtual ~QNodeViewAnimator();
+
+    void install(QNodeViewScene* scene);
+
+    qint32 activeCount() const { return m_active.size(); }
+    bool isRunning() const { return m_timer.isActive(); }
+
+    // Active connections on screen and time spent in the last frame, for measuring the cost of the animation
+    qint32 visibleCount() const { return m_visibleCount; }
+    qint64 lastFrameTime() const { return m_lastFrameTime; }
+
+public slots:
+    void wake();
+
+private slots:
+    void itemAdded(QGraphicsItem* item);
+    void itemRemoved(QGraphicsItem* item);
+    void step();
+
+private:
+    void watchCanvases();
+
+private:
+    QNodeViewScene* m_scene;
+    QSet<QNodeViewConnection*> m_active;
+    QList<QPointer<QNodeViewCanvas> > m_canvases;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    qint64 m_lastFrameTime;
+    qint32 m_visibleCount;
+};
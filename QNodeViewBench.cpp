@@ -0,0 +1,105 @@
+/*!
+  @file    QNodeViewBench.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include <QNodeViewBenchmarks.h>
+#include <QNodeViewGraph.h>
+
+#include <ExampleTypes.h>
+
+/*!
+    Runs one of the headless workloads in QNodeViewBenchmarks over a graph.
+
+        QNodeViewBench index|load|save|probes <graph>
+        QNodeViewBench navigate|search
+
+    Runs on the offscreen platform unless another one is requested, and
+    exits with 1 when the workload's checks fail.
+*/
+
+int main(int argc, char* argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication application(argc, argv);
+    QApplication::setApplicationName("QNodeViewBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a headless QNodeView benchmark over a graph.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("workload", "Benchmark to run: index, load, save, probes, navigate or search");
+    parser.addPositionalArgument("graph", "Graph file to load, navigate and search generate their own");
+    parser.process(application);
+
+    const QStringList arguments = parser.positionalArguments();
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (arguments.size() == 1 && arguments[0] == "navigate")
+    {
+        QNodeViewBenchmarks::navigate(out);
+        return 0;
+    }
+
+    if (arguments.size() == 1 && arguments[0] == "search")
+    {
+        QNodeViewBenchmarks::search(out);
+        return 0;
+    }
+
+    if (arguments.size() != 2)
+        parser.showHelp(1);
+
+    // Graphs saved by the example use its node types
+    registerExampleTypes();
+
+    QNodeViewGraph graph;
+    QString errorString;
+
+    if (!graph.loadFile(arguments[1], &errorString))
+    {
+        err << arguments[1] << ": " << errorString << endl;
+        return 1;
+    }
+
+    const QString& name = arguments[0];
+
+    if (name == "index")
+        return QNodeViewBenchmarks::index(graph, out, err) ? 0 : 1;
+
+    if (name == "load")
+        return QNodeViewBenchmarks::load(graph, out, err) ? 0 : 1;
+
+    if (name == "save")
+        return QNodeViewBenchmarks::save(graph, out, err) ? 0 : 1;
+
+    if (name == "probes")
+        return QNodeViewBenchmarks::probes(graph, out, err) ? 0 : 1;
+
+    err << "Unknown benchmark " << name << endl;
+    return 1;
+}
@@ -0,0 +1,759 @@
+/*!
+  @file    QNodeViewBenchmarks.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#include <QApplication>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QGraphicsView>
+#include <QPainterPath>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QWheelEvent>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <random>
+
+#include <QNodeViewBenchmarks.h>
+#include <QNodeViewBlock.h>
+#include <QNodeViewCanvas.h>
+#include <QNodeViewEditor.h>
+#include <QNodeViewGraph.h>
+#include <QNodeViewGraphGenerator.h>
+#include <QNodeViewGraphWriter.h>
+#include <QNodeViewPool.h>
+#include <QNodeViewPort.h>
+#include <QNodeViewProbe.h>
+#include <QNodeViewProbeSampler.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewSearchIndex.h>
+
+// Every run uses the same blocks and points
+static const quint32 s_seed = 7;
+
+// Drag workload, a handful of blocks moved a little per frame like a mouse drag
+static const qint32 s_dragBlocks = 20;
+static const qint32 s_dragFrames = 200;
+static const QPointF s_dragStep(2.0, 1.0);
+
+// Hit test workload, small areas around random points like the editor's press and hover tests
+static const qint32 s_hitTests = 10000;
+static const qreal s_hitSize = 8.0;
+
+// Load workload, the first round starts with cold pools and later rounds show the steady state
+static const qint32 s_loadRounds = 3;
+
+// Save workload, each round builds a snapshot on this thread and writes it on the writer's
+static const qint32 s_saveRounds = 3;
+
+// Navigate workload, a generated graph panned at two zoom levels and zoomed a notch at a time on a fixed size canvas
+static const qint32 s_navigateBlocks = 50000;
+static const QSize s_navigateSize(1600, 900);
+static const qint32 s_navigateFrames = 240;
+static const QPoint s_navigateStep(24, 12);
+static const qint32 s_navigateNotches = 20;
+
+// Probe workload, ports in view and off screen fed at audio-like rates while the sampler steps at display rate
+static const qint32 s_probePorts = 64;
+static const qint64 s_probeRate = 20000;
+static const qint64 s_probeDuration = 2000;
+static const qint32 s_probeFrameInterval = 16;
+
+// Empty steps after the producers stop, enough to close every open sparkline column
+static const qint32 s_probeFlushFrames = 8;
+
+// Search workload, a generated graph of about a million ports searched once per keystroke like the find box
+static const qint32 s_searchBlocks = 112000;
+static const qint32 s_searchLimit = 20;
+static const qint32 s_searchRounds = 10;
+
+namespace
+{
+    QString perOperation(qint64 nanoseconds, qint32 count)
+    {
+        return QString("%1 us").arg(nanoseconds / 1000.0 / qMax(count, 1), 0, 'f', 2);
+    }
+
+    bool loadScene(QNodeViewEditor& editor, const QNodeViewGraph& graph, QTextStream& err)
+    {
+        if (!editor.load(graph))
+        {
+            err << "graph uses unknown node types" << endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    QVector<QNodeViewBlock*> pickBlocks(QGraphicsScene& scene, qint32 count, std::mt19937& random)
+    {
+        QVector<QNodeViewBlock*> blocks;
+
+        Q_FOREACH (QGraphicsItem* item, scene.items(Qt::AscendingOrder))
+        {
+            if (item->type() == QNodeViewType_Block)
+                blocks.append(static_cast<QNodeViewBlock*>(item));
+        }
+
+        QVector<QNodeViewBlock*> picked;
+
+        for (qint32 index = 0; index < count && !blocks.isEmpty(); ++index)
+            picked.append(blocks[std::uniform_int_distribution<qint32>(0, blocks.size() - 1)(random)]);
+
+        return picked;
+    }
+
+    QVector<QRectF> pickAreas(const QRectF& bounds, qint32 count, std::mt19937& random)
+    {
+        std::uniform_real_distribution<qreal> x(bounds.left(), bounds.right());
+        std::uniform_real_distribution<qreal> y(bounds.top(), bounds.bottom());
+
+        QVector<QRectF> areas;
+        areas.reserve(count);
+
+        for (qint32 index = 0; index < count; ++index)
+            areas.append(QRectF(x(random) - s_hitSize / 2, y(random) - s_hitSize / 2, s_hitSize, s_hitSize));
+
+        return areas;
+    }
+
+    qint64 drag(QGraphicsScene& scene, const QVector<QNodeViewBlock*>& blocks)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        for (qint32 frame = 0; frame < s_dragFrames; ++frame)
+        {
+            Q_FOREACH (QNodeViewBlock* block, blocks)
+                block->moveBy(s_dragStep.x(), s_dragStep.y());
+
+            // Qt's index catches up lazily, on the next query, as it would for the repaint of the frame
+            scene.items(blocks.first()->sceneBoundingRect());
+        }
+
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        // Put everything back, so the next index sees the same scene
+        Q_FOREACH (QNodeViewBlock* block, blocks)
+            block->moveBy(-s_dragStep.x() * s_dragFrames, -s_dragStep.y() * s_dragFrames);
+
+        scene.items(blocks.first()->sceneBoundingRect());
+
+        return elapsed;
+    }
+
+    QGraphicsItem* segmentItemAt(QNodeViewScene& scene, const QRectF& area)
+    {
+        return scene.nodeItemAt(area);
+    }
+
+    // QNodeViewScene::nodeItemAt() with connections found by Qt's shape test instead of the segment index
+    QGraphicsItem* shapeItemAt(QNodeViewScene& scene, const QRectF& area)
+    {
+        QGraphicsItem* result = NULL;
+        qint32 resultPriority = 0;
+
+        QPainterPath areaPath;
+        areaPath.addRect(area);
+
+        Q_FOREACH (QGraphicsItem* item, scene.items(area, Qt::IntersectsItemBoundingRect))
+        {
+            if (!item->isVisible() || item->effectiveOpacity() <= 0.0)
+                continue;
+
+            qint32 priority = 0;
+            switch (item->type())
+            {
+                case QNodeViewType_Port:            priority = 4; break;
+                case QNodeViewType_ConnectionSplit: priority = 3; break;
+                case QNodeViewType_Block:
+                case QNodeViewType_Group:           priority = 2; break;
+                case QNodeViewType_Connection:      priority = 1; break;
+            }
+
+            if (priority <= resultPriority)
+                continue;
+
+            if (item->collidesWithPath(item->mapFromScene(areaPath)))
+            {
+                result = item;
+                resultPriority = priority;
+            }
+        }
+
+        return result;
+    }
+
+    qint64 hitTest(QNodeViewScene& scene, const QVector<QRectF>& areas, QGraphicsItem* (*itemAt)(QNodeViewScene&, const QRectF&), QVector<QGraphicsItem*>* results)
+    {
+        results->clear();
+        results->reserve(areas.size());
+
+        QElapsedTimer timer;
+        timer.start();
+
+        Q_FOREACH (const QRectF& area, areas)
+            results->append(itemAt(scene, area));
+
+        return timer.nsecsElapsed();
+    }
+
+    qint32 countHits(const QVector<QGraphicsItem*>& results)
+    {
+        return results.size() - results.count(NULL);
+    }
+
+    QString frameTimes(QVector<qint64> times)
+    {
+        if (times.isEmpty())
+            return QString("no frames");
+
+        std::sort(times.begin(), times.end());
+
+        const qint32 p95 = qMin(times.size() - 1, times.size() * 95 / 100);
+        const qint32 p99 = qMin(times.size() - 1, times.size() * 99 / 100);
+
+        return QString("p50 %1 ms, p95 %2 ms, p99 %3 ms, max %4 ms")
+            .arg(times[times.size() / 2] / 1000000.0, 0, 'f', 2)
+            .arg(times[p95] / 1000000.0, 0, 'f', 2)
+            .arg(times[p99] / 1000000.0, 0, 'f', 2)
+            .arg(times.last() / 1000000.0, 0, 'f', 2);
+    }
+
+    // Time of one navigation step, including the repaint it causes
+    qint64 settleFrame(QElapsedTimer& timer)
+    {
+        QApplication::processEvents();
+        return timer.nsecsElapsed();
+    }
+
+    QNodeViewPoolBase::Statistics poolTotals()
+    {
+        QNodeViewPoolBase::Statistics totals = { "total", 0, 0, 0, 0, 0 };
+
+        Q_FOREACH (const QNodeViewPoolBase::Statistics& statistics, QNodeViewPoolBase::allStatistics())
+        {
+            totals.allocations += statistics.allocations;
+            totals.deallocations += statistics.deallocations;
+            totals.live += statistics.live;
+            totals.slabs += statistics.slabs;
+        }
+
+        return totals;
+    }
+
+    struct ProbeProducer
+    {
+        ProbeProducer() : produced(0), lastPushed(0.0) {}
+
+        QSharedPointer<QNodeViewProbe> probe;
+        quint64 produced;
+        double lastPushed;
+    };
+
+    void produce(ProbeProducer* producer)
+    {
+        QElapsedTimer clock;
+        clock.start();
+
+        quint64 counter = 0;
+
+        // Rising counter values, so every sparkline column must start at or above the end of the one before
+        while (clock.elapsed() < s_probeDuration)
+        {
+            const quint64 due = quint64(clock.nsecsElapsed() / 1000) * s_probeRate / 1000000;
+            while (counter < due)
+            {
+                if (producer->probe->push(double(++counter)))
+                    producer->lastPushed = double(counter);
+            }
+
+            QThread::usleep(200);
+        }
+
+        producer->produced = counter;
+    }
+
+    bool checkSparkline(const QNodeViewPortProbe& probe, double lastPushed, qint32 index, QTextStream& err)
+    {
+        if (probe.columnCount <= 0 || probe.columnCount > QNodeViewPortProbe::s_columns || probe.columnOpen)
+        {
+            err << "probe " << index << ": " << probe.columnCount << " sparkline columns, " << (probe.columnOpen ? "one still open" : "none open") << endl;
+            return false;
+        }
+
+        float previous = 0.0f;
+
+        for (qint32 column = 0; column < probe.columnCount; ++column)
+        {
+            const qint32 slot = (probe.firstColumn + column) % QNodeViewPortProbe::s_columns;
+
+            if (probe.minimum[slot] > probe.maximum[slot] || probe.minimum[slot] < previous)
+            {
+                err << "probe " << index << ": sparkline column " << column << " spans " << probe.minimum[slot] << " to " << probe.maximum[slot]
+                    << " after " << previous << endl;
+                return false;
+            }
+
+            previous = probe.maximum[slot];
+        }
+
+        // The newest column and the shown value end on the last sample the ring accepted
+        if (probe.value != lastPushed || previous != float(lastPushed))
+        {
+            err << "probe " << index << ": shows " << probe.value << ", last column ends at " << previous << ", last sample was " << lastPushed << endl;
+            return false;
+        }
+
+        return true;
+    }
+}
+
+bool QNodeViewBenchmarks::index(const QNodeViewGraph& graph, QTextStream& out, QTextStream& err)
+{
+    QNodeViewScene scene;
+    QNodeViewEditor editor;
+    editor.install(&scene);
+
+    if (!loadScene(editor, graph, err))
+        return false;
+
+    std::mt19937 random(s_seed);
+
+    const QVector<QNodeViewBlock*> blocks = pickBlocks(scene, s_dragBlocks, random);
+    if (blocks.isEmpty())
+    {
+        err << "graph has no blocks to drag" << endl;
+        return false;
+    }
+
+    const QVector<QRectF> areas = pickAreas(scene.itemsBoundingRect(), s_hitTests, random);
+
+    out << scene.items().size() << " items, " << scene.nodeIndex().segmentItemCount() << " connections" << endl;
+
+    const QGraphicsScene::ItemIndexMethod methods[] = { QGraphicsScene::BspTreeIndex, QGraphicsScene::NoIndex };
+    const char* const names[] = { "BspTreeIndex", "NoIndex" };
+
+    for (qint32 method = 0; method < 2; ++method)
+    {
+        scene.setItemIndexMethod(methods[method]);
+
+        // Builds the index before anything is timed
+        scene.items(areas.first());
+
+        const qint64 dragTime = drag(scene, blocks);
+
+        QVector<QGraphicsItem*> segmentHits;
+        const qint64 segmentTime = hitTest(scene, areas, segmentItemAt, &segmentHits);
+
+        QVector<QGraphicsItem*> shapeHits;
+        const qint64 shapeTime = hitTest(scene, areas, shapeItemAt, &shapeHits);
+
+        // Both ask for the topmost item by the same priorities, they only test wires differently
+        qint32 differences = 0;
+        for (qint32 index = 0; index < areas.size(); ++index)
+        {
+            if (segmentHits[index] != shapeHits[index])
+                ++differences;
+        }
+
+        out << names[method] << ": drag " << perOperation(dragTime, s_dragFrames) << " per frame, "
+            << "hit test " << perOperation(segmentTime, areas.size()) << " with the segment index, "
+            << perOperation(shapeTime, areas.size()) << " with shape tests ("
+            << countHits(segmentHits) << " and " << countHits(shapeHits) << " hits, "
+            << differences << " differ)" << endl;
+    }
+
+    return true;
+}
+
+bool QNodeViewBenchmarks::load(const QNodeViewGraph& graph, QTextStream& out, QTextStream& err)
+{
+    QNodeViewScene scene;
+    QNodeViewEditor editor;
+    editor.install(&scene);
+
+    const QNodeViewGraphStatistics statistics = graph.statistics();
+    out << statistics.blocks << " blocks, " << statistics.ports << " ports, " << statistics.connections << " connections" << endl;
+
+    bool released = true;
+
+    for (qint32 round = 1; round <= s_loadRounds; ++round)
+    {
+        const QNodeViewPoolBase::Statistics before = poolTotals();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        if (!loadScene(editor, graph, err))
+            return false;
+
+        const qint64 loadTime = timer.elapsed();
+        const QNodeViewPoolBase::Statistics loaded = poolTotals();
+
+        timer.start();
+        editor.clear();
+
+        const qint64 clearTime = timer.elapsed();
+        const QNodeViewPoolBase::Statistics cleared = poolTotals();
+
+        out << "round " << round << ": load " << loadTime << " ms, " << loaded.allocations - before.allocations << " pooled allocations, "
+            << loaded.slabs << " slabs; clear " << clearTime << " ms, " << cleared.deallocations - loaded.deallocations << " pooled deallocations" << endl;
+
+        // A cleared scene holds nothing, so every pool is empty and trimmed
+        if (cleared.live != 0 || cleared.slabs != 0)
+        {
+            err << "round " << round << ": " << cleared.live << " pooled items and " << cleared.slabs << " slabs left after clear" << endl;
+            released = false;
+        }
+    }
+
+    Q_FOREACH (const QNodeViewPoolBase::Statistics& statistics, QNodeViewPoolBase::allStatistics())
+    {
+        out << statistics.name << ": " << statistics.allocations << " allocations, " << statistics.deallocations << " deallocations, "
+            << statistics.objectSize << " bytes each" << endl;
+    }
+
+    return released;
+}
+
+bool QNodeViewBenchmarks::save(const QNodeViewGraph& graph, QTextStream& out, QTextStream& err)
+{
+    QNodeViewScene scene;
+    QNodeViewEditor editor;
+    editor.install(&scene);
+
+    if (!loadScene(editor, graph, err))
+        return false;
+
+    QTemporaryDir directory;
+    if (!directory.isValid())
+    {
+        err << "cannot create a temporary directory" << endl;
+        return false;
+    }
+
+    const QString fileName = directory.filePath("snapshot.qnv");
+
+    const QNodeViewGraphStatistics statistics = graph.statistics();
+    out << statistics.blocks << " blocks, " << statistics.ports << " ports, " << statistics.connections << " connections" << endl;
+
+    QNodeViewGraphWriter writer;
+
+    for (qint32 round = 1; round <= s_saveRounds; ++round)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        // What the example does on the GUI thread for every save and journal compaction
+        QNodeViewGraph snapshot;
+        editor.save(snapshot);
+
+        const qint64 snapshotTime = timer.nsecsElapsed();
+
+        timer.start();
+        writer.save(snapshot, fileName);
+
+        const qint64 handOffTime = timer.nsecsElapsed();
+
+        timer.start();
+        writer.waitForDone();
+
+        const qint64 writeTime = timer.elapsed();
+
+        out << "round " << round << ": snapshot " << QString("%1 ms").arg(snapshotTime / 1000000.0, 0, 'f', 2) << ", "
+            << "hand off " << perOperation(handOffTime, 1) << ", "
+            << "background write " << writeTime << " ms" << endl;
+    }
+
+    return true;
+}
+
+void QNodeViewBenchmarks::navigate(QTextStream& out)
+{
+    QNodeViewGraphGeneratorOptions options;
+    options.seed = s_seed;
+    options.blocks = s_navigateBlocks;
+
+    const QNodeViewGraph graph = QNodeViewGraphGenerator::generate(options);
+
+    QNodeViewScene scene;
+    QNodeViewEditor editor;
+    editor.install(&scene);
+    editor.load(graph);
+
+    const QNodeViewGraphStatistics statistics = graph.statistics();
+    out << statistics.blocks << " blocks, " << statistics.ports << " ports, " << statistics.connections << " connections" << endl;
+
+    // Without animation every wheel notch renders the new zoom at once instead of scaling a snapshot
+    QNodeViewCanvas canvas(&scene);
+    canvas.setAnimated(false);
+    canvas.resize(s_navigateSize);
+    canvas.show();
+
+    const QPointF center = scene.itemsBoundingRect().center();
+    const qreal scales[] = { 1.0, 0.25 };
+
+    for (quint32 level = 0; level < sizeof(scales) / sizeof(scales[0]); ++level)
+    {
+        canvas.setTransform(QTransform::fromScale(scales[level], scales[level]));
+        canvas.centerOn(center);
+        QApplication::processEvents();
+
+        QVector<qint64> times;
+        canvas.beginInteraction();
+
+        for (qint32 frame = 0; frame < s_navigateFrames; ++frame)
+        {
+            // Back and forth, so the view stays over the graph
+            const QPoint step = (frame / (s_navigateFrames / 4)) % 2 ? -s_navigateStep : s_navigateStep;
+
+            QElapsedTimer timer;
+            timer.start();
+
+            canvas.horizontalScrollBar()->setValue(canvas.horizontalScrollBar()->value() + step.x());
+            canvas.verticalScrollBar()->setValue(canvas.verticalScrollBar()->value() + step.y());
+
+            times.append(settleFrame(timer));
+        }
+
+        canvas.endInteraction();
+        QApplication::processEvents();
+
+        out << "pan at " << scales[level] << "x: " << frameTimes(times) << endl;
+    }
+
+    canvas.setTransform(QTransform());
+    canvas.centerOn(center);
+    QApplication::processEvents();
+
+    QVector<qint64> times;
+    const QPoint anchor(s_navigateSize.width() / 2, s_navigateSize.height() / 2);
+
+    // Out and back in, each notch a frame rendered at the new zoom
+    for (qint32 notch = 0; notch < s_navigateNotches * 2; ++notch)
+    {
+        QWheelEvent event(anchor, notch < s_navigateNotches ? -120 : 120, Qt::NoButton, Qt::NoModifier);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        QApplication::sendEvent(canvas.viewport(), &event);
+        times.append(settleFrame(timer));
+    }
+
+    out << "zoom: " << frameTimes(times) << endl;
+}
+
+bool QNodeViewBenchmarks::probes(const QNodeViewGraph& graph, QTextStream& out, QTextStream& err)
+{
+    QNodeViewScene scene;
+    QNodeViewEditor editor;
+    editor.install(&scene);
+
+    if (!loadScene(editor, graph, err))
+        return false;
+
+    // Repaints are only counted for ports inside a visible view
+    QGraphicsView view(&scene);
+    view.resize(1280, 720);
+    view.show();
+    view.centerOn(scene.itemsBoundingRect().center());
+    QCoreApplication::sendPostedEvents();
+
+    const QRectF visibleRect = view.mapToScene(view.viewport()->rect()).boundingRect();
+
+    // Every n-th shown port in stacking order, so runs over the same file probe the same ports
+    QVector<QNodeViewPort*> ports;
+
+    Q_FOREACH (QGraphicsItem* item, scene.items(Qt::AscendingOrder))
+    {
+        if (item->type() == QNodeViewType_Port && item->isVisible() && static_cast<QNodeViewPort*>(item)->block())
+            ports.append(static_cast<QNodeViewPort*>(item));
+    }
+
+    if (ports.isEmpty())
+    {
+        err << "graph has no ports to probe" << endl;
+        return false;
+    }
+
+    const qint32 probeCount = qMin(s_probePorts, ports.size());
+    const qint32 stride = ports.size() / probeCount;
+
+    QNodeViewProbeSampler sampler;
+    sampler.install(&scene);
+    sampler.setAnimated(false);
+
+    QVector<ProbeProducer> producers(probeCount);
+    QVector<QNodeViewPort*> probedPorts(probeCount);
+    qint32 onScreen = 0;
+
+    for (qint32 index = 0; index < probeCount; ++index)
+    {
+        probedPorts[index] = ports[index * stride];
+        producers[index].probe = sampler.attach(probedPorts[index]);
+
+        if (visibleRect.intersects(probedPorts[index]->sceneBoundingRect()))
+            ++onScreen;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(probeCount);
+
+    for (qint32 index = 0; index < probeCount; ++index)
+        QtConcurrent::run(&pool, produce, &producers[index]);
+
+    quint64 received = 0;
+    qint64 stepTime = 0;
+    qint64 worstStep = 0;
+    qint32 frames = 0;
+    qint32 repaints = 0;
+    qint32 worstRepaints = 0;
+    qint32 flushFrames = 0;
+    bool bounded = true;
+
+    while (flushFrames < s_probeFlushFrames)
+    {
+        // Checked before stepping, so the flush frames see everything the producers pushed
+        if (pool.activeThreadCount() == 0)
+            ++flushFrames;
+
+        sampler.step();
+
+        received += sampler.lastSampleCount();
+        stepTime += sampler.lastStepTime();
+        worstStep = qMax(worstStep, sampler.lastStepTime());
+        repaints += sampler.lastRepaintCount();
+        worstRepaints = qMax(worstRepaints, sampler.lastRepaintCount());
+        ++frames;
+
+        // Ports outside the view are drained but never repainted
+        if (sampler.lastRepaintCount() > onScreen)
+            bounded = false;
+
+        if (flushFrames == 0)
+            QThread::msleep(s_probeFrameInterval);
+    }
+
+    pool.waitForDone();
+
+    quint64 produced = 0;
+    quint64 dropped = 0;
+    bool sparklines = true;
+
+    for (qint32 index = 0; index < probeCount; ++index)
+    {
+        produced += producers[index].produced;
+        dropped += producers[index].probe->dropped();
+
+        const QNodeViewPortProbe* probe = probedPorts[index]->probe();
+        if (!probe || !checkSparkline(*probe, producers[index].lastPushed, index, err))
+            sparklines = false;
+    }
+
+    out << probeCount << " probes, " << onScreen << " on screen, " << produced << " samples produced, " << received << " received, "
+        << dropped << " dropped" << endl;
+
+    out << frames << " steps, " << QString::number(stepTime / 1000000.0 / frames, 'f', 3) << " ms per step, slowest "
+        << QString::number(worstStep / 1000000.0, 'f', 3) << " ms; " << QString::number(qreal(repaints) / frames, 'f', 1)
+        << " repaints per step, at most " << worstRepaints << endl;
+
+    if (received + dropped != produced)
+        err << "error: " << produced - received - dropped << " samples lost" << endl;
+
+    if (!bounded)
+        err << "error: more ports repainted in one step than are on screen" << endl;
+
+    if (onScreen > 0 && repaints == 0)
+        err << "error: no probed port on screen was repainted" << endl;
+
+    return received + dropped == produced && bounded && (onScreen == 0 || repaints > 0) && sparklines;
+}
+
+void QNodeViewBenchmarks::search(QTextStream& out)
+{
+    QNodeViewGraphGeneratorOptions options;
+    options.seed = s_seed;
+    options.blocks = s_searchBlocks;
+    options.minInputs = 2;
+    options.maxInputs = 6;
+    options.minOutputs = 2;
+    options.maxOutputs = 6;
+    options.connectedInputs = 0.0;
+    options.splitDensity = 0.0;
+
+    const QNodeViewGraph graph = QNodeViewGraphGenerator::generate(options);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Filled the way QNodeViewScene fills its own, block titles ahead of port names
+    QNodeViewSearchIndex index;
+
+    Q_FOREACH (const QNodeViewGraphBlock& block, graph.blocks)
+    {
+        Q_FOREACH (const QNodeViewGraphPort& port, block.ports)
+        {
+            if (!port.name.isEmpty())
+                index.insert(port.id, port.name, (port.flags & QNodeViewPortLabel_Name) ? 1 : 0);
+        }
+    }
+
+    out << index.size() << " names indexed in " << timer.elapsed() << " ms" << endl;
+
+    // Names shared by many ports, a block title and a substring, typed one character at a time
+    const char* const typed[] = { "in 3", "out 2", "block 4711", "ock 47" };
+
+    QString slowestQuery;
+    qint64 slowestTime = 0;
+
+    for (quint32 text = 0; text < sizeof(typed) / sizeof(typed[0]); ++text)
+    {
+        const QString word = QString::fromLatin1(typed[text]);
+
+        for (qint32 length = 1; length <= word.size(); ++length)
+        {
+            const QString query = word.left(length);
+            qint32 matches = 0;
+
+            timer.start();
+
+            for (qint32 round = 0; round < s_searchRounds; ++round)
+                matches = index.search(query, s_searchLimit).size();
+
+            const qint64 elapsed = timer.nsecsElapsed();
+
+            out << "\"" << query << "\": " << perOperation(elapsed, s_searchRounds) << ", " << matches << " matches" << endl;
+
+            if (elapsed > slowestTime)
+            {
+                slowestTime = elapsed;
+                slowestQuery = query;
+            }
+        }
+    }
+
+    out << "slowest keystroke \"" << slowestQuery << "\": " << perOperation(slowestTime, s_searchRounds) << endl;
+}
@@ -0,0 +1,55 @@
+/*!
+  @file    QNodeViewBenchmarks.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#pragma once
+
+class QNodeViewGraph;
+class QTextStream;
+
+/*!
+    Headless benchmarks run by QNodeViewBench.
+
+    Each one builds its own scene from the graph, or generates its own
+    graph, runs a fixed, seeded workload and prints its timings. A benchmark that also checks results
+    returns false when a check fails.
+*/
+class QNodeViewBenchmarks
+{
+public:
+    // Drags and hit tests on one scene under Qt's BspTreeIndex and NoIndex, wires found by the segment index and by shape tests
+    static bool index(const QNodeViewGraph& graph, QTextStream& out, QTextStream& err);
+
+    // Loads and clears the graph a few times, checking every pooled item is released
+    static bool load(const QNodeViewGraph& graph, QTextStream& out, QTextStream& err);
+
+    // Builds snapshots of the loaded graph as the example's saves do, and writes them on a QNodeViewGraphWriter
+    static bool save(const QNodeViewGraph& graph, QTextStream& out, QTextStream& err);
+
+    // Feeds probes on the graph's ports from producer threads and steps a QNodeViewProbeSampler by hand
+    static bool probes(const QNodeViewGraph& graph, QTextStream& out, QTextStream& err);
+
+    // Pans and zooms a canvas over a generated graph of 50k blocks, reporting frame times
+    static void navigate(QTextStream& out);
+
+    // Searches the names of a generated graph of about a million ports, one query per keystroke
+    static void search(QTextStream& out);
+};
@@ -24,89 +24,536 @@
 #include <QFontMetrics>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
+#include <QGraphicsSceneWheelEvent>
 
 #include <QNodeViewBlock.h>
+#include <QNodeViewCanvas.h>
+#include <QNodeViewChromeCache.h>
+#include <QNodeViewGraph.h>
+#include <QNodeViewGroup.h>
+#include <QNodeViewNodeTypeRegistry.h>
 #include <QNodeViewPort.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewTrace.h>
+
+// Rows scrolled per wheel notch over a virtualized block
+static const qint32 s_wheelRows = 3;
+
+static qint32 s_defaultRowLimit = 0;
 
 QNodeViewBlock::QNodeViewBlock(QGraphicsItem* parent)
 : QGraphicsPathItem(parent)
+, m_group(NULL)
+, m_nodeType(NULL)
 , m_width(100)
 , m_height(5)
-, m_horizontalMargin(20)
-, m_verticalMargin(5)
+, m_minimumWidth(100)
+, m_moreInput(NULL)
+, m_moreOutput(NULL)
+, m_rowLimit(s_defaultRowLimit)
+, m_firstRow(0)
+, m_headerRows(0)
 {
-    setCacheMode(DeviceCoordinateCache);
+    // Chrome is blitted from the shared QNodeViewChromeCache instead of a pixmap per item
+    setCacheMode(NoCache);
 
     setFlag(QGraphicsItem::ItemIsMovable);
     setFlag(QGraphicsItem::ItemIsSelectable);
+    setFlag(QGraphicsItem::ItemSendsGeometryChanges);
 
     QPainterPath path;
     path.addRoundedRect(-50, -15, 100, 30, 5, 5);
     setPath(path);
     setPen(QPen(QColor(30, 30, 30))); // GW-TODO: Expose to QStyle
     setBrush(QColor(50, 50, 50)); // GW-TODO: Expose to QStyle
+}
+
+QNodeViewBlock::~QNodeViewBlock()
+{
+    if (m_group)
+        m_group->removeMember(this);
 
-    // GW-TODO:
-    //     This causes a crash in the BSP intersect code deep within Qt5.
-    //     Need to investigate further, but many issues are open it appears...
-    // https://codereview.qt-project.org/#change,40931
-    // https://bugreports.qt-project.org/browse/QTBUG-23205
-    // https://bugreports.qt-project.org/browse/QTBUG-24792
-    // https://bugreports.qt-project.org/browse/QTBUG-18021
-    // https://bugreports.qt-project.org/browse/QTBUG-5090
-#if 0
-    m_dropShadow.setBlurRadius(16);
-    m_dropShadow.setXOffset(0.0);
-    m_dropShadow.setYOffset(5.0);
+    Q_FOREACH (const PortRow& row, m_rows)
+    {
+        if (!row.port)
+            QNodeViewScene::rowRemoved(this, row.record.id);
+    }
 
-    setGraphicsEffect(&m_dropShadow);
-#endif
+    QNodeViewScene::itemDestroyed(this);
 }
 
-QNodeViewBlock::~QNodeViewBlock()
+QNodeViewPort* QNodeViewBlock::addPort(const QString& name, bool isOutput, qint32 flags, qint32 index, quint16 typeId)
 {
+    QNODEVIEW_TRACE_SCOPE("QNodeViewBlock::addPort");
+
+    QNodeViewPort* port = createPort(name, isOutput, flags, index, typeId);
+
+    // The caller holds on to the port, so adding rows hides them but never releases any
+    if (isVirtualized())
+    {
+        appendHiddenRow(port);
+        return port;
+    }
+
+    applyRowLimit(false);
+
+    if (!isVirtualized())
+        updateLayout();
+
+	return port;
 }
 
-QNodeViewPort* QNodeViewBlock::addPort(const QString& name, bool isOutput, qint32 flags, qint32 index)
+QNodeViewPort* QNodeViewBlock::createPort(const QString& name, bool isOutput, qint32 flags, qint32 index, quint16 typeId)
 {
+    // Once ports are added by hand the block no longer matches its node type
+    m_nodeType = NULL;
+
     QNodeViewPort* port = new QNodeViewPort(this);
 	port->setName(name);
 	port->setIsOutput(isOutput);
     port->setBlock(this);
 	port->setPortFlags(flags);
     port->setIndex(index);
+    port->setTypeId(typeId);
+	return port;
+}
 
-    QFontMetrics fontMetrics(scene()->font());
-    const qint32 width  = fontMetrics.width(name);
-    const qint32 height = fontMetrics.height();
+void QNodeViewBlock::setNodeType(quint16 nodeTypeId)
+{
+    Q_ASSERT(ports().isEmpty());
 
-    if (width > m_width - m_horizontalMargin)
-        m_width = width + m_horizontalMargin;
+    QNodeViewNodeType* nodeType = QNodeViewNodeTypeRegistry::nodeType(nodeTypeId);
+    Q_ASSERT(nodeType);
 
-    m_height += height;
+    const QNodeViewNodeLayout& layout = nodeType->layout(scene()->font());
 
-    QPainterPath path;
-    path.addRoundedRect(-(m_width >> 1), -(m_height >> 1), m_width, m_height, 5, 5);
-    setPath(path);
+    Q_FOREACH (const QNodeViewPortLayout& portLayout, layout.ports)
+    {
+        QNodeViewPort* port = new QNodeViewPort(this);
+        port->setBlock(this);
+        port->setLayout(portLayout);
+    }
 
-    qint32 y = -(m_height >> 1) + m_verticalMargin + port->radius();
+    m_nodeType = nodeType;
+    m_width  = layout.width;
+    m_height = layout.height;
+    setPath(layout.path);
 
-    Q_FOREACH (QGraphicsItem* childItem, childItems())
+    QNodeViewScene::itemGeometryChanged(this);
+}
+
+quint16 QNodeViewBlock::nodeTypeId() const
+{
+    return m_nodeType ? m_nodeType->id() : QNodeViewNodeTypeRegistry::CustomType;
+}
+
+void QNodeViewBlock::setTitle(const QString& title)
+{
+    QNodeViewPort* port = titlePort();
+    if (!port)
+        return;
+
+    if (!m_nodeType)
     {
-        if (childItem->type() != QNodeViewType_Port)
-			continue;
+        port->setName(title);
 
-        QNodeViewPort* childPort = static_cast<QNodeViewPort*>(childItem);
+        if (isVirtualized())
+            layoutRows();
+        else
+            updateLayout();
 
-        if (childPort->isOutput())
-            childPort->setPos((m_width >> 1) + childPort->radius(), y);
-		else
-            childPort->setPos(-(m_width >> 1) - childPort->radius(), y);
+        return;
+    }
 
-        y += height;
-	}
+    const QNodeViewNodeLayout& layout = m_nodeType->layout(scene()->font());
+    const QVector<QNodeViewPort*> blockPorts = ports();
+    const qint32 titleRow = blockPorts.indexOf(port);
 
-	return port;
+    m_title = title;
+    port->setName(title.isEmpty() ? layout.ports[titleRow].name : title);
+
+    // Titles that fit keep the node type's shared geometry, longer ones widen only this block
+    QNodeViewNodeLayout wideLayout;
+    const QNodeViewNodeLayout* blockLayout = &layout;
+
+    if (!layout.fits(port->portName()))
+    {
+        wideLayout = layout;
+        wideLayout.ports[titleRow].name = port->portName();
+        wideLayout.build(layout.font, m_minimumWidth);
+        blockLayout = &wideLayout;
+    }
+
+    m_width  = blockLayout->width;
+    m_height = blockLayout->height;
+    setPath(blockLayout->path);
+
+    for (qint32 index = 0; index < blockPorts.size(); ++index)
+    {
+        blockPorts[index]->setPos(blockLayout->ports[index].position);
+        blockPorts[index]->updateConnections();
+    }
+
+    QNodeViewScene::itemGeometryChanged(this);
+}
+
+QString QNodeViewBlock::title()
+{
+    QNodeViewPort* port = titlePort();
+    return port ? port->portName() : QString();
+}
+
+QNodeViewPort* QNodeViewBlock::titlePort()
+{
+    Q_FOREACH (QNodeViewPort* port, ports())
+    {
+        if (port->portFlags() & QNodeViewPortLabel_Name)
+            return port;
+    }
+
+    return NULL;
+}
+
+void QNodeViewBlock::updateLayout()
+{
+    const QVector<QNodeViewPort*> blockPorts = ports();
+
+    QNodeViewNodeLayout layout;
+    layout.ports.resize(blockPorts.size());
+
+    for (qint32 index = 0; index < blockPorts.size(); ++index)
+    {
+        layout.ports[index].name = blockPorts[index]->portName();
+        layout.ports[index].isOutput = blockPorts[index]->isOutput();
+        layout.ports[index].flags = blockPorts[index]->portFlags();
+    }
+
+    layout.build(scene()->font(), m_minimumWidth);
+
+    m_width  = layout.width;
+    m_height = layout.height;
+    setPath(layout.path);
+
+    for (qint32 index = 0; index < blockPorts.size(); ++index)
+        blockPorts[index]->setPos(layout.ports[index].position);
+
+    QNodeViewScene::itemGeometryChanged(this);
+}
+
+void QNodeViewBlock::setPortRowLimit(qint32 rows)
+{
+    m_rowLimit = qMax(0, rows);
+
+    if (scene())
+        updatePortRows();
+}
+
+void QNodeViewBlock::setDefaultPortRowLimit(qint32 rows)
+{
+    s_defaultRowLimit = qMax(0, rows);
+}
+
+qint32 QNodeViewBlock::defaultPortRowLimit()
+{
+    return s_defaultRowLimit;
+}
+
+void QNodeViewBlock::scrollPortRows(qint32 firstRow)
+{
+    if (!isVirtualized() || m_firstRow == firstRow)
+        return;
+
+    const qint32 bodyRows = m_rows.size() - m_headerRows;
+
+    // Rows that were never laid out, or no longer fit the limit, take the full pass
+    if (!m_moreInput || m_rowLimit == 0 || bodyRows <= m_rowLimit || (m_group && m_group->isCollapsed()) || !scene())
+    {
+        m_firstRow = firstRow;
+        updatePortRows();
+        return;
+    }
+
+    firstRow = qBound(0, firstRow, bodyRows - m_rowLimit);
+    if (m_firstRow == firstRow)
+        return;
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewBlock::scrollPortRows");
+
+    const qint32 previousRow = m_firstRow;
+    m_firstRow = firstRow;
+
+    QVector<QNodeViewPort*> changedPorts;
+
+    for (qint32 body = previousRow; body < previousRow + m_rowLimit; ++body)
+    {
+        if (body >= firstRow && body < firstRow + m_rowLimit)
+            continue;
+
+        QNodeViewPort* port = updateRow(m_headerRows + body, false, true);
+        if (port)
+            changedPorts.append(port);
+    }
+
+    for (qint32 body = firstRow; body < firstRow + m_rowLimit; ++body)
+    {
+        if (body >= previousRow && body < previousRow + m_rowLimit)
+            continue;
+
+        changedPorts.append(updateRow(m_headerRows + body, true, true));
+    }
+
+    layoutRows();
+
+    // Ports that moved already updated their wires, but a row can enter or leave the window in place
+    Q_FOREACH (QNodeViewPort* port, changedPorts)
+        port->updateConnections();
+}
+
+QNodeViewPort* QNodeViewBlock::scrollToPort(quint64 id)
+{
+    for (qint32 index = 0; index < m_rows.size(); ++index)
+    {
+        const PortRow& row = m_rows[index];
+        if ((row.port ? row.port->id() : row.record.id) != id)
+            continue;
+
+        const qint32 bodyIndex = index - m_headerRows;
+
+        if (bodyIndex >= 0 && bodyIndex < m_firstRow)
+            scrollPortRows(bodyIndex);
+        else if (bodyIndex >= m_firstRow + m_rowLimit)
+            scrollPortRows(bodyIndex - m_rowLimit + 1);
+
+        return m_rows[index].port;
+    }
+
+    // Not virtualized, or no such row
+    Q_FOREACH (QNodeViewPort* port, ports())
+    {
+        if (port->id() == id)
+            return port;
+    }
+
+    return NULL;
+}
+
+qint32 QNodeViewBlock::portRowCount()
+{
+    return isVirtualized() ? m_rows.size() : ports().size();
+}
+
+void QNodeViewBlock::updatePortRows()
+{
+    applyRowLimit(true);
+}
+
+void QNodeViewBlock::applyRowLimit(bool releaseHidden)
+{
+    // Typed blocks share their node type's layout, groups only hold proxies
+    if (m_nodeType || type() == QNodeViewType_Group || !scene())
+        return;
+
+    // Member ports of a collapsed group are proxied by the group until it expands
+    if (m_group && m_group->isCollapsed())
+        return;
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewBlock::updatePortRows");
+
+    if (!isVirtualized())
+    {
+        const QVector<QNodeViewPort*> blockPorts = ports();
+        if (m_rowLimit == 0 || blockPorts.size() <= m_rowLimit)
+            return;
+
+        m_rows.resize(blockPorts.size());
+        for (qint32 index = 0; index < blockPorts.size(); ++index)
+        {
+            m_rows[index].record = portRecord(blockPorts[index]);
+            m_rows[index].port = blockPorts[index];
+        }
+    }
+
+    // Leading title rows always stay in view
+    m_headerRows = 0;
+    while (m_headerRows < m_rows.size() && (m_rows[m_headerRows].record.flags & (QNodeViewPortLabel_Name | QNodeViewPortLabel_Type)))
+        ++m_headerRows;
+
+    const qint32 bodyRows = m_rows.size() - m_headerRows;
+
+    if (m_rowLimit == 0 || bodyRows <= m_rowLimit)
+    {
+        releaseRows();
+        return;
+    }
+
+    m_firstRow = qBound(0, m_firstRow, bodyRows - m_rowLimit);
+
+    if (!m_moreInput)
+    {
+        m_moreInput = new QNodeViewPort(this);
+        m_moreInput->setBlock(this);
+        m_moreOutput = new QNodeViewPort(this);
+        m_moreOutput->setBlock(this);
+        m_moreOutput->setIsOutput(true);
+    }
+
+    for (qint32 index = 0; index < m_rows.size(); ++index)
+    {
+        const qint32 bodyIndex = index - m_headerRows;
+        const bool shown = (bodyIndex < 0) || (bodyIndex >= m_firstRow && bodyIndex < m_firstRow + m_rowLimit);
+
+        updateRow(index, shown, releaseHidden);
+    }
+
+    m_moreInput->setName(QString("%1 more").arg(bodyRows - m_rowLimit));
+
+    layoutRows();
+
+    Q_FOREACH (const PortRow& row, m_rows)
+    {
+        if (row.port)
+            row.port->updateConnections();
+    }
+}
+
+QNodeViewPort* QNodeViewBlock::updateRow(qint32 index, bool shown, bool releaseHidden)
+{
+    PortRow& row = m_rows[index];
+
+    if (shown && !row.port)
+    {
+        row.port = createPort(row.record.name, row.record.isOutput, row.record.flags, row.record.id, row.record.typeId);
+        row.port->setId(row.record.id);
+    }
+    else if (!shown && releaseHidden && row.port && row.port->connections().isEmpty() && row.port->proxiedPorts().isEmpty() && !row.port->probe())
+    {
+        // Nothing refers to the port, so the row goes back to being a plain record
+        row.record = portRecord(row.port);
+        row.port->setProxy(NULL);
+        delete row.port;
+        row.port = NULL;
+
+        QNodeViewScene::rowReleased(this, row.record);
+    }
+
+    if (row.port)
+    {
+        // Wires to hidden rows end on the "more" row
+        row.port->setVisible(shown);
+        row.port->setProxy(shown ? NULL : (row.port->isOutput() ? m_moreOutput : m_moreInput));
+    }
+
+    return row.port;
+}
+
+void QNodeViewBlock::appendHiddenRow(QNodeViewPort* port)
+{
+    const PortRow row = { portRecord(port), port };
+    m_rows.append(row);
+
+    // Collapsed members and blocks still loading get their anchors from the next updatePortRows()
+    if (!m_moreInput || (m_group && m_group->isCollapsed()))
+        return;
+
+    // The window is full and never past the last row, so a new last row always starts out of view
+    port->setVisible(false);
+    port->setProxy(port->isOutput() ? m_moreOutput : m_moreInput);
+
+    const QString moreName = QString("%1 more").arg(m_rows.size() - m_headerRows - m_rowLimit);
+    const bool wider = moreName.size() != m_moreInput->portName().size();
+    m_moreInput->setName(moreName);
+
+    // Only a label that gained a digit can change the block's width
+    if (wider)
+        layoutRows();
+}
+
+void QNodeViewBlock::layoutRows()
+{
+    QVector<QNodeViewPort*> shownPorts;
+    shownPorts.reserve(m_headerRows + m_rowLimit + 1);
+
+    // Only the title rows and the rows in the window are shown, so the rest are never walked
+    for (qint32 index = 0; index < m_headerRows; ++index)
+        shownPorts.append(m_rows[index].port);
+
+    const qint32 windowEnd = qMin(m_rows.size(), m_headerRows + m_firstRow + m_rowLimit);
+    for (qint32 index = m_headerRows + m_firstRow; index < windowEnd; ++index)
+        shownPorts.append(m_rows[index].port);
+
+    shownPorts.append(m_moreInput);
+
+    QNodeViewNodeLayout layout;
+    layout.ports.resize(shownPorts.size());
+
+    for (qint32 index = 0; index < shownPorts.size(); ++index)
+    {
+        layout.ports[index].name = shownPorts[index]->portName();
+        layout.ports[index].isOutput = shownPorts[index]->isOutput();
+        layout.ports[index].flags = shownPorts[index]->portFlags();
+    }
+
+    layout.build(scene()->font(), m_minimumWidth);
+
+    m_width  = layout.width;
+    m_height = layout.height;
+    setPath(layout.path);
+
+    for (qint32 index = 0; index < shownPorts.size(); ++index)
+        shownPorts[index]->setPos(layout.ports[index].position);
+
+    // Both anchors share the last row, mirrored across the block
+    const QPointF morePosition = layout.ports.last().position;
+    m_moreOutput->setPos(-morePosition.x(), morePosition.y());
+
+    // Ports and anchors that moved update their wires, and those of the rows they proxy, from itemChange()
+    QNodeViewScene::itemGeometryChanged(this);
+}
+
+void QNodeViewBlock::releaseRows()
+{
+    // Few enough rows again, every row gets its port back and the anchors go away
+    for (qint32 index = 0; index < m_rows.size(); ++index)
+    {
+        PortRow& row = m_rows[index];
+
+        if (!row.port)
+        {
+            row.port = createPort(row.record.name, row.record.isOutput, row.record.flags, row.record.id, row.record.typeId);
+            row.port->setId(row.record.id);
+        }
+
+        row.port->setProxy(NULL);
+        row.port->setVisible(true);
+    }
+
+    // Rematerialized ports were appended, so restore the row order among the children
+    for (qint32 index = m_rows.size() - 1; index > 0; --index)
+        m_rows[index - 1].port->stackBefore(m_rows[index].port);
+
+    m_rows.clear();
+    m_firstRow = 0;
+
+    delete m_moreInput;
+    delete m_moreOutput;
+    m_moreInput = NULL;
+    m_moreOutput = NULL;
+
+    updateLayout();
+
+    Q_FOREACH (QNodeViewPort* port, ports())
+        port->updateConnections();
+}
+
+QNodeViewGraphPort QNodeViewBlock::portRecord(QNodeViewPort* port)
+{
+    QNodeViewGraphPort record;
+    record.id = port->id();
+    record.name = port->portName();
+    record.isOutput = port->isOutput();
+    record.flags = port->portFlags();
+    record.typeId = port->typeId();
+    return record;
 }
 
 void QNodeViewBlock::addInputPort(const QString& name)
@@ -131,81 +578,136 @@ void QNodeViewBlock::addOutputPorts(const QStringList& names)
         addOutputPort(name);
 }
 
-void QNodeViewBlock::save(QDataStream& stream)
+void QNodeViewBlock::save(QNodeViewGraphBlock& record)
 {
-    stream << pos();
+    record.position = pos();
 
-    qint32 count = 0;
-
-    Q_FOREACH (QGraphicsItem* childItem, childItems())
-	{
-        if (childItem->type() != QNodeViewType_Port)
-			continue;
+    // Typed blocks only need their port ids, the ports come from the node type
+    record.nodeType = nodeTypeId();
+    record.title = m_title;
+    record.ports.clear();
 
-        ++count;
-	}
+    // Virtualized blocks save every row, including the ones without a port
+    if (isVirtualized())
+    {
+        Q_FOREACH (const PortRow& row, m_rows)
+            record.ports.append(row.port ? portRecord(row.port) : row.record);
 
-    stream << count;
+        return;
+    }
 
-    Q_FOREACH (QGraphicsItem* childItem, childItems())
+    Q_FOREACH (QNodeViewPort* port, ports())
 	{
-        if (childItem->type() != QNodeViewType_Port)
-			continue;
-
-        QNodeViewPort* port = static_cast<QNodeViewPort*>(childItem);
-        stream << reinterpret_cast<quint64>(port);
-        stream << port->portName();
-        stream << port->isOutput();
-        stream << port->portFlags();
+        QNodeViewGraphPort portRecord;
+        portRecord.id = port->id();
+
+        if (record.nodeType == QNodeViewNodeTypeRegistry::CustomType)
+        {
+            portRecord.name = port->portName();
+            portRecord.isOutput = port->isOutput();
+            portRecord.flags = port->portFlags();
+            portRecord.typeId = port->typeId();
+        }
+
+        record.ports.append(portRecord);
 	}
 }
 
-void QNodeViewBlock::load(QDataStream& stream, QMap<quint64, QNodeViewPort*>& portMap)
+void QNodeViewBlock::load(const QNodeViewGraphBlock& record, QMap<quint64, QNodeViewPort*>& portMap, const QVector<quint16>& typeMap, const QVector<quint16>& nodeTypeMap, const QSet<quint64>& connectedPorts)
 {
-    QPointF position;
-    stream >> position;
-    setPos(position);
+    setPos(record.position);
 
-    qint32 count;
-    stream >> count;
+    const quint16 nodeType = nodeTypeMap.value(record.nodeType, QNodeViewNodeTypeRegistry::CustomType);
 
-    for (qint32 iter = 0; iter < count; iter++)
-	{
-        quint64 index;
-        stream >> index;
+    if (nodeType != QNodeViewNodeTypeRegistry::CustomType)
+    {
+        setNodeType(nodeType);
 
-        QString name;
-        stream >> name;
+        const QVector<QNodeViewPort*> blockPorts = ports();
+        if (blockPorts.size() != record.ports.size())
+            qWarning("QNodeViewBlock: node type %s has %d ports, file has %d", qPrintable(m_nodeType->name()), blockPorts.size(), record.ports.size());
 
-        bool output;
-        stream >> output;
+        // Wires to ports the node type no longer declares are dropped
+        const qint32 count = qMin(blockPorts.size(), record.ports.size());
 
-        qint32 flags;
-        stream >> flags;
+        for (qint32 iter = 0; iter < count; iter++)
+        {
+            blockPorts[iter]->setIndex(record.ports[iter].id);
+            blockPorts[iter]->setId(record.ports[iter].id);
+            portMap[record.ports[iter].id] = blockPorts[iter];
+        }
 
-        portMap[index] = addPort(name, output, flags, index);
-	}
+        if (!record.title.isEmpty())
+            setTitle(record.title);
+
+        return;
+    }
+
+    qint32 headerRows = 0;
+    while (headerRows < record.ports.size() && (record.ports[headerRows].flags & (QNodeViewPortLabel_Name | QNodeViewPortLabel_Type)))
+        ++headerRows;
+
+    // Long blocks go straight to row records, the anchors and layout follow in updatePortRows() once the wires exist
+    if (m_rowLimit > 0 && record.ports.size() - headerRows > m_rowLimit)
+    {
+        m_rows.resize(record.ports.size());
+
+        for (qint32 index = 0; index < record.ports.size(); ++index)
+        {
+            PortRow& row = m_rows[index];
+            row.record = record.ports[index];
+            row.record.typeId = typeMap.value(row.record.typeId);
+            row.port = NULL;
+
+            if (index < headerRows + m_rowLimit || connectedPorts.contains(row.record.id))
+            {
+                row.port = createPort(row.record.name, row.record.isOutput, row.record.flags, row.record.id, row.record.typeId);
+                row.port->setId(row.record.id);
+                portMap[row.record.id] = row.port;
+            }
+            else
+            {
+                // Rows loaded without a port are found by search like released ones
+                QNodeViewScene::rowReleased(this, row.record);
+            }
+        }
+
+        return;
+    }
+
+    Q_FOREACH (const QNodeViewGraphPort& portRecord, record.ports)
+    {
+        QNodeViewPort* port = createPort(portRecord.name, portRecord.isOutput, portRecord.flags, portRecord.id, typeMap.value(portRecord.typeId));
+        port->setId(portRecord.id);
+        portMap[portRecord.id] = port;
+    }
+
+    updateLayout();
 }
 
 void QNodeViewBlock::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
-    Q_UNUSED(widget);
+    QNODEVIEW_TRACE_SCOPE("QNodeViewBlock::paint");
 
     // Only paint dirty regions for increased performance
     painter->setClipRect(option->exposedRect);
 
-    if (isSelected())
+    const QRectF bodyRect = path().boundingRect();
+
+    if (!QNodeViewCanvas::isInteracting(widget))
     {
-        painter->setPen(QPen(QColor(30, 30, 30))); // GW-TODO: Expose to QStyle
-        painter->setBrush(QColor(100, 100, 100)); // GW-TODO: Expose to QStyle
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+        QNodeViewChromeCache::drawShadow(painter, bodyRect);
     }
-    else
-    {
-        painter->setPen(QPen(QColor(30, 30, 30))); // GW-TODO: Expose to QStyle
-        painter->setBrush(QColor(80, 80, 80)); // GW-TODO: Expose to QStyle
-	}
 
-	painter->drawPath(path());
+    QNodeViewChromeCache::drawBody(painter, bodyRect, isSelected());
+}
+
+QRectF QNodeViewBlock::boundingRect() const
+{
+    // Leave room for the drop shadow around the body
+    const qreal blur = QNodeViewChromeCache::shadowBlurRadius();
+    return QGraphicsPathItem::boundingRect().adjusted(-blur, -blur, blur, blur + QNodeViewChromeCache::shadowOffset());
 }
 
 QNodeViewBlock* QNodeViewBlock::clone()
@@ -213,6 +715,29 @@ QNodeViewBlock* QNodeViewBlock::clone()
     QNodeViewBlock* block = new QNodeViewBlock(NULL);
     this->scene()->addItem(block);
 
+    if (m_nodeType)
+    {
+        block->setNodeType(m_nodeType->id());
+
+        if (!m_title.isEmpty())
+            block->setTitle(m_title);
+
+        return block;
+    }
+
+    if (isVirtualized())
+    {
+        // Lay out once at the end instead of once per row
+        Q_FOREACH (const PortRow& row, m_rows)
+        {
+            const QNodeViewGraphPort record = row.port ? portRecord(row.port) : row.record;
+            block->createPort(record.name, record.isOutput, record.flags, record.id, record.typeId);
+        }
+
+        block->setPortRowLimit(m_rowLimit);
+        return block;
+    }
+
     Q_FOREACH (QGraphicsItem* childPort, childItems())
 	{
         if (childPort->type() == QNodeViewType_Port)
@@ -222,17 +747,43 @@ QNodeViewBlock* QNodeViewBlock::clone()
                     clonePort->portName(),
                     clonePort->isOutput(),
                     clonePort->portFlags(),
-                    clonePort->index());
+                    clonePort->index(),
+                    clonePort->typeId());
 		}
 	}
 
     return block;
 }
 
+quint64 QNodeViewBlock::id()
+{
+    if (isVirtualized())
+        return m_rows.first().port ? m_rows.first().port->id() : m_rows.first().record.id;
+
+    Q_FOREACH (QGraphicsItem* childItem, childItems())
+    {
+        if (childItem->type() == QNodeViewType_Port)
+            return static_cast<QNodeViewPort*>(childItem)->id();
+    }
+
+    return 0;
+}
+
 QVector<QNodeViewPort*> QNodeViewBlock::ports()
 {
     QVector<QNodeViewPort*> result;
 
+    if (isVirtualized())
+    {
+        Q_FOREACH (const PortRow& row, m_rows)
+        {
+            if (row.port)
+                result.append(row.port);
+        }
+
+        return result;
+    }
+
     Q_FOREACH (QGraphicsItem* childItem, childItems())
 	{
         if (childItem->type() == QNodeViewType_Port)
@@ -242,8 +793,41 @@ QVector<QNodeViewPort*> QNodeViewBlock::ports()
     return result;
 }
 
+void QNodeViewBlock::setGroup(QNodeViewGroup* group)
+{
+    m_group = group;
+}
+
 QVariant QNodeViewBlock::itemChange(GraphicsItemChange change, const QVariant& value)
 {
-    Q_UNUSED(change);
+    QNodeViewScene::itemChanged(this, change);
+
+    // Released rows follow the block out of one scene's search index and into the next
+    if (change == ItemSceneChange || change == ItemSceneHasChanged)
+    {
+        Q_FOREACH (const PortRow& row, m_rows)
+        {
+            if (row.port)
+                continue;
+
+            if (change == ItemSceneChange)
+                QNodeViewScene::rowRemoved(this, row.record.id);
+            else
+                QNodeViewScene::rowReleased(this, row.record);
+        }
+    }
+
 	return value;
 }
+
+void QNodeViewBlock::wheelEvent(QGraphicsSceneWheelEvent* event)
+{
+    if (!isVirtualized())
+    {
+        event->ignore();
+        return;
+    }
+
+    scrollPortRows(m_firstRow - (event->delta() / 120) * s_wheelRows);
+    event->accept();
+}
@@ -22,10 +22,13 @@
 #pragma once
 
 #include <QGraphicsPathItem>
-#include <QGraphicsDropShadowEffect>
+#include <QSet>
 #include <QNodeViewCommon.h>
+#include <QNodeViewGraph.h>
 
 class QNodeViewPort;
+class QNodeViewGroup;
+class QNodeViewNodeType;
 
 class QNodeViewBlock : public QGraphicsPathItem
 {
@@ -33,34 +36,100 @@ public:
     QNodeViewBlock(QGraphicsItem* parent = NULL);
     virtual ~QNodeViewBlock();
 
-    QNodeViewPort* addPort(const QString& name, bool isOutput, qint32 flags = 0, qint32 index = 0);
+    // On a virtualized block the new row is hidden but keeps its port until the rows are next scrolled or relimited
+    QNodeViewPort* addPort(const QString& name, bool isOutput, qint32 flags = 0, qint32 index = 0, quint16 typeId = 0);
 
     void addInputPort(const QString& name);
     void addOutputPort(const QString& name);
     void addInputPorts(const QStringList& names);
     void addOutputPorts(const QStringList& names);
 
+    // Instantiates a registered node type, sharing its precomputed layout
+    void setNodeType(quint16 nodeTypeId);
+    quint16 nodeTypeId() const;
+
+    // Renames the title row; an empty title gives a typed block its node type's title back
+    void setTitle(const QString& title);
+    QString title();
+
+    // Port rows past the limit are virtualized, see updatePortRows(); 0 shows every row
+    void setPortRowLimit(qint32 rows);
+    qint32 portRowLimit() const { return m_rowLimit; }
+    static void setDefaultPortRowLimit(qint32 rows);
+    static qint32 defaultPortRowLimit();
+
+    // Only rows entering or leaving the window are touched
+    void scrollPortRows(qint32 firstRow);
+
+    // Scrolls the row with the port id into view, giving a released row its port back
+    QNodeViewPort* scrollToPort(quint64 id);
+    qint32 firstPortRow() const { return m_firstRow; }
+    qint32 portRowCount();
+    bool isVirtualized() const { return !m_rows.isEmpty(); }
+    bool isPortRowAnchor(const QNodeViewPort* port) const { return port && (port == m_moreInput || port == m_moreOutput); }
+
+    // Applies the row limit; call after loading connections, hidden rows are only released while unconnected
+    void updatePortRows();
+
 public:
-    void save(QDataStream& stream);
-    void load(QDataStream&, QMap<quint64, QNodeViewPort*>& portMap);
+    void save(QNodeViewGraphBlock& record);
+    // Past the row limit, only rows in view and rows listed in connectedPorts get a port
+    void load(const QNodeViewGraphBlock& record, QMap<quint64, QNodeViewPort*>& portMap, const QVector<quint16>& typeMap, const QVector<quint16>& nodeTypeMap, const QSet<quint64>& connectedPorts);
 
 public:
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
+    QRectF boundingRect() const;
 
 public:
     QNodeViewBlock* clone();
+
+    // Materialized ports in row order, without the anchors of virtualized rows
     QVector<QNodeViewPort*> ports();
 
+    // Blocks have no id in the file format, so they go by the id of their first port, or 0 without ports
+    quint64 id();
+
+    void setGroup(QNodeViewGroup* group);
+    QNodeViewGroup* group() const { return m_group; }
+
     // QGraphicsItem
     int type() const { return QNodeViewType_Block; }
 
 protected:
     QVariant itemChange(GraphicsItemChange change, const QVariant& value);
+    void wheelEvent(QGraphicsSceneWheelEvent* event);
+
+    QNodeViewPort* createPort(const QString& name, bool isOutput, qint32 flags = 0, qint32 index = 0, quint16 typeId = 0);
+    void updateLayout();
+
+private:
+    struct PortRow
+    {
+        QNodeViewGraphPort record;
+        QNodeViewPort* port;
+    };
+
+    void applyRowLimit(bool releaseHidden);
+    QNodeViewPort* updateRow(qint32 index, bool shown, bool releaseHidden);
+    void appendHiddenRow(QNodeViewPort* port);
+    void layoutRows();
+    void releaseRows();
+    QNodeViewPort* titlePort();
+    static QNodeViewGraphPort portRecord(QNodeViewPort* port);
 
 private:
-    //QGraphicsDropShadowEffect m_dropShadow;
+    QNodeViewGroup* m_group;
+    QNodeViewNodeType* m_nodeType;
+    QString m_title;
     qint32 m_width;
     qint32 m_height;
-    qint32 m_horizontalMargin;
-    qint32 m_verticalMargin;
+    qint32 m_minimumWidth;
+
+    // Only filled while virtualized; hidden rows without a port live on as records, still indexed by the scene
+    QVector<PortRow> m_rows;
+    QNodeViewPort* m_moreInput;
+    QNodeViewPort* m_moreOutput;
+    qint32 m_rowLimit;
+    qint32 m_firstRow;
+    qint32 m_headerRows;
 };
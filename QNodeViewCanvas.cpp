@@ -20,11 +20,48 @@
 */
 
 #include <QNodeViewCanvas.h>
+#include <QNodeViewTrace.h>
+
+// Time without input before the view is re-rendered at full quality
+static const qint32 s_idleInterval = 150;
+
+// Kinetic navigation tuning, velocities are in pixels per millisecond
+static const qint32 s_frameInterval = 16;
+static const qint32 s_zoomDuration = 120;
+static const qint32 s_flickTimeout = 50;
+static const qreal s_panFriction = 0.9;
+static const qreal s_panStopVelocity = 0.02;
+
+// Zoom range used when focusing on an item, the item fills about a third of the view
+static const qreal s_focusMinScale = 0.25;
+static const qreal s_focusMaxScale = 1.5;
+static const qreal s_focusFill = 3.0;
+
+// Matches the pen of QNodeViewConnection, in scene units
+static const qreal s_wireWidth = 2.0;
 
 QNodeViewCanvas::QNodeViewCanvas(QGraphicsScene* scene, QWidget* parent)
 : QGraphicsView(scene, parent)
+, m_lastFrameTime(0)
+, m_zoomFrom(1.0)
+, m_zoomTo(1.0)
+, m_zoomCurrent(1.0)
+, m_animated(true)
+, m_interacting(false)
+, m_panning(false)
+, m_spaceHeld(false)
 {
     setRenderHint(QPainter::Antialiasing, true);
+
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(s_idleInterval);
+    connect(&m_idleTimer, SIGNAL(timeout()), this, SLOT(restoreQuality()));
+
+    m_inertiaTimer.setInterval(s_frameInterval);
+    connect(&m_inertiaTimer, SIGNAL(timeout()), this, SLOT(stepInertia()));
+
+    m_zoomTimer.setInterval(s_frameInterval);
+    connect(&m_zoomTimer, SIGNAL(timeout()), this, SLOT(stepZoom()));
 }
 
 QNodeViewCanvas::~QNodeViewCanvas()
@@ -38,6 +75,8 @@ void QNodeViewCanvas::contextMenuEvent(QContextMenuEvent* event)
 
 void QNodeViewCanvas::drawBackground(QPainter* painter, const QRectF& rect)
 {
+    QNODEVIEW_TRACE_SCOPE("QNodeViewCanvas::drawBackground");
+
     // GW-TODO: Expose this to QStyle
     painter->fillRect(rect, QBrush(QColor(50, 50, 50)));
 
@@ -64,14 +103,367 @@ void QNodeViewCanvas::drawBackground(QPainter* painter, const QRectF& rect)
     painter->drawLines(linesY.data(), linesY.size());
 }
 
+void QNodeViewCanvas::drawForeground(QPainter* painter, const QRectF& rect)
+{
+    QGraphicsView::drawForeground(painter, rect);
+
+    if (m_pendingWire.isEmpty() || !rect.intersects(m_pendingWire.controlPointRect().adjusted(-s_wireWidth, -s_wireWidth, s_wireWidth, s_wireWidth)))
+        return;
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewCanvas::drawForeground");
+
+    painter->setPen(QPen(QColor(170, 170, 170), s_wireWidth)); // GW-TODO: Expose to QStyle
+    painter->setBrush(Qt::NoBrush);
+    painter->drawPath(m_pendingWire);
+}
+
+void QNodeViewCanvas::setPendingWire(const QPainterPath& path)
+{
+    // Only the area the wire leaves and the area it now covers are repainted
+    const QRectF dirty = m_pendingWire.controlPointRect() | path.controlPointRect();
+    m_pendingWire = path;
+    updateSceneArea(dirty);
+}
+
+void QNodeViewCanvas::clearPendingWire()
+{
+    if (m_pendingWire.isEmpty())
+        return;
+
+    const QRectF dirty = m_pendingWire.controlPointRect();
+    m_pendingWire = QPainterPath();
+    updateSceneArea(dirty);
+}
+
+void QNodeViewCanvas::beginInteraction()
+{
+    m_idleTimer.stop();
+
+    if (m_interacting)
+        return;
+
+    m_interacting = true;
+
+    // The update mode is left alone, the default minimal updates already scroll drawn pixels while panning
+    setRenderHint(QPainter::Antialiasing, false);
+}
+
+void QNodeViewCanvas::endInteraction()
+{
+    if (!m_interacting)
+        return;
+
+    if (m_animated)
+        m_idleTimer.start();
+    else
+        restoreQuality();
+}
+
+void QNodeViewCanvas::setAnimated(bool animated)
+{
+    m_animated = animated;
+
+    if (!m_animated)
+    {
+        finishZoom();
+        m_inertiaTimer.stop();
+    }
+}
+
+void QNodeViewCanvas::focusOn(const QRectF& sceneArea)
+{
+    finishZoom();
+    m_inertiaTimer.stop();
+
+    const QSizeF viewSize = viewport()->size();
+    const qreal fit = qMin(viewSize.width() / qMax<qreal>(1.0, sceneArea.width() * s_focusFill),
+                           viewSize.height() / qMax<qreal>(1.0, sceneArea.height() * s_focusFill));
+
+    const qreal target = qBound(s_focusMinScale, fit, s_focusMaxScale);
+    const qreal factor = target / transform().m11();
+    scale(factor, factor);
+
+    // Grow the scrollable area so the result can be centered even at the edge of the graph
+    QRectF visible(QPointF(), viewSize / target);
+    visible.moveCenter(sceneArea.center());
+
+    if (!sceneRect().contains(visible))
+        setSceneRect(sceneRect().united(visible));
+
+    centerOn(sceneArea.center());
+}
+
+bool QNodeViewCanvas::isInteracting(const QWidget* viewport)
+{
+    if (!viewport)
+        return false;
+
+    const QNodeViewCanvas* canvas = qobject_cast<const QNodeViewCanvas*>(viewport->parentWidget());
+    return canvas && canvas->m_interacting;
+}
+
+void QNodeViewCanvas::restoreQuality()
+{
+    m_interacting = false;
+
+    setRenderHint(QPainter::Antialiasing, true);
+
+    // Render once at full quality now that the view has settled
+    viewport()->update();
+}
+
+void QNodeViewCanvas::keyPressEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_Space && !event->isAutoRepeat())
+    {
+        m_spaceHeld = true;
+        viewport()->setCursor(Qt::OpenHandCursor);
+        event->accept();
+        return;
+    }
+
+    QGraphicsView::keyPressEvent(event);
+}
+
+void QNodeViewCanvas::keyReleaseEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_Space && !event->isAutoRepeat())
+    {
+        m_spaceHeld = false;
+
+        if (!m_panning)
+            viewport()->unsetCursor();
+
+        event->accept();
+        return;
+    }
+
+    QGraphicsView::keyReleaseEvent(event);
+}
+
+void QNodeViewCanvas::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::MiddleButton || (event->button() == Qt::LeftButton && m_spaceHeld))
+    {
+        finishZoom();
+        m_inertiaTimer.stop();
+
+        m_panning = true;
+        m_panPosition = event->pos();
+        m_panVelocity = QPointF();
+        m_panClock.start();
+
+        viewport()->setCursor(Qt::ClosedHandCursor);
+        beginInteraction();
+        event->accept();
+        return;
+    }
+
+    QGraphicsView::mousePressEvent(event);
+}
+
+void QNodeViewCanvas::mouseMoveEvent(QMouseEvent* event)
+{
+    if (m_panning)
+    {
+        const QPoint delta = event->pos() - m_panPosition;
+        m_panPosition = event->pos();
+
+        // Smooth the velocity so a single jittery event does not dominate the flick
+        const qint64 elapsed = m_panClock.restart();
+        if (elapsed > 0)
+            m_panVelocity = m_panVelocity * 0.2 + QPointF(delta) / elapsed * 0.8;
+
+        panBy(delta);
+        event->accept();
+        return;
+    }
+
+    if (event->buttons() != Qt::NoButton)
+        beginInteraction();
+
+    QGraphicsView::mouseMoveEvent(event);
+}
+
+void QNodeViewCanvas::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (m_panning)
+    {
+        if (event->button() != Qt::MiddleButton && event->button() != Qt::LeftButton)
+            return;
+
+        m_panning = false;
+
+        if (m_spaceHeld)
+            viewport()->setCursor(Qt::OpenHandCursor);
+        else
+            viewport()->unsetCursor();
+
+        // Only flick if the pointer was still moving when it was released
+        if (m_animated && m_panClock.elapsed() < s_flickTimeout && m_panVelocity.manhattanLength() > s_panStopVelocity)
+            m_inertiaTimer.start();
+        else
+            endInteraction();
+
+        event->accept();
+        return;
+    }
+
+    QGraphicsView::mouseReleaseEvent(event);
+
+    if (event->buttons() == Qt::NoButton)
+        endInteraction();
+}
+
+void QNodeViewCanvas::paintEvent(QPaintEvent* event)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!m_zoomSnapshot.isNull())
+    {
+        // Scale the last rendered frame around the anchor instead of re-rendering the scene
+        QPainter painter(viewport());
+        painter.fillRect(viewport()->rect(), QColor(50, 50, 50)); // GW-TODO: Expose this to QStyle
+
+        const QSizeF size = QSizeF(m_zoomSnapshot.size()) / m_zoomSnapshot.devicePixelRatio() * m_zoomCurrent;
+        const QPointF topLeft = m_zoomAnchor - m_zoomAnchor * m_zoomCurrent;
+        painter.drawPixmap(QRectF(topLeft, size), m_zoomSnapshot, QRectF(m_zoomSnapshot.rect()));
+    }
+    else
+    {
+        QGraphicsView::paintEvent(event);
+    }
+
+    m_lastFrameTime = timer.nsecsElapsed();
+    emit frameRendered(m_lastFrameTime, m_interacting);
+}
+
 void QNodeViewCanvas::wheelEvent(QWheelEvent *event)
 {
-    this->setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
-    double scaleFactor = 1.15;
+    const qreal scaleFactor = 1.15;
+
+    // Shift scrolls the port rows of the block under the cursor instead of zooming
+    if (event->modifiers() & Qt::ShiftModifier)
+    {
+        QGraphicsView::wheelEvent(event);
+        return;
+    }
+
+    beginInteraction();
+    m_inertiaTimer.stop();
+
+    if (!m_animated)
+    {
+        zoomBy(event->delta() > 0 ? scaleFactor : 1.0 / scaleFactor, event->pos());
+        endInteraction();
+        event->accept();
+        return;
+    }
+
+    if (m_zoomSnapshot.isNull())
+    {
+        m_zoomSnapshot = viewport()->grab();
+        m_zoomAnchor = event->pos();
+        m_zoomCurrent = 1.0;
+        m_zoomTo = 1.0;
+    }
+
+    // Further notches retarget the running animation from where it currently is
+    m_zoomFrom = m_zoomCurrent;
+
+    if (event->delta() > 0)
+        m_zoomTo *= scaleFactor;
+    else
+        m_zoomTo /= scaleFactor;
+
+    m_zoomClock.start();
+    m_zoomTimer.start();
+    event->accept();
+}
+
+void QNodeViewCanvas::stepZoom()
+{
+    const qreal progress = qMin(1.0, m_zoomClock.elapsed() / qreal(s_zoomDuration));
+    const qreal eased = 1.0 - (1.0 - progress) * (1.0 - progress);
+
+    m_zoomCurrent = m_zoomFrom + (m_zoomTo - m_zoomFrom) * eased;
+    viewport()->update();
+
+    if (progress >= 1.0)
+        finishZoom();
+}
+
+void QNodeViewCanvas::finishZoom()
+{
+    m_zoomTimer.stop();
+
+    if (m_zoomSnapshot.isNull())
+        return;
+
+    m_zoomSnapshot = QPixmap();
+
+    // Apply the final zoom for real
+    zoomBy(m_zoomTo, m_zoomAnchor.toPoint());
+
+    m_zoomCurrent = 1.0;
+    m_zoomTo = 1.0;
+
+    // The final frame is the full quality one
+    m_idleTimer.stop();
+    restoreQuality();
+}
 
-    if(event->delta() > 0) {
-        this-> scale(scaleFactor, scaleFactor);
-    } else {
-        this->scale(1.0 / scaleFactor, 1.0 / scaleFactor);
+void QNodeViewCanvas::updateSceneArea(const QRectF& sceneArea)
+{
+    const QRectF area = sceneArea.adjusted(-s_wireWidth, -s_wireWidth, s_wireWidth, s_wireWidth);
+
+    // Extra pixels cover antialiasing at any zoom
+    viewport()->update(mapFromScene(area).boundingRect().adjusted(-2, -2, 2, 2));
+}
+
+void QNodeViewCanvas::zoomBy(qreal factor, const QPoint& anchor)
+{
+    // Keep the anchor under the same viewport pixel
+    const QPointF sceneAnchor = mapToScene(anchor);
+
+    const QGraphicsView::ViewportAnchor transformAnchor = transformationAnchor();
+    setTransformationAnchor(QGraphicsView::NoAnchor);
+    scale(factor, factor);
+    setTransformationAnchor(transformAnchor);
+
+    const QPoint drift = mapFromScene(sceneAnchor) - anchor;
+    horizontalScrollBar()->setValue(horizontalScrollBar()->value() + drift.x());
+    verticalScrollBar()->setValue(verticalScrollBar()->value() + drift.y());
+}
+
+void QNodeViewCanvas::stepInertia()
+{
+    panBy(m_panVelocity * s_frameInterval);
+    m_panVelocity *= s_panFriction;
+
+    if (m_panVelocity.manhattanLength() < s_panStopVelocity)
+    {
+        m_inertiaTimer.stop();
+        endInteraction();
     }
 }
+
+void QNodeViewCanvas::panBy(const QPointF& delta)
+{
+    m_panRemainder += delta;
+    const QPoint step = m_panRemainder.toPoint();
+    m_panRemainder -= step;
+
+    if (step.isNull())
+        return;
+
+    // Grow the scrollable area so panning is not clamped to the item bounds
+    const QRectF target = mapToScene(viewport()->rect().translated(-step)).boundingRect();
+    if (!sceneRect().contains(target))
+        setSceneRect(sceneRect().united(target));
+
+    // Scrolling shifts the existing viewport pixels and only exposes a strip
+    horizontalScrollBar()->setValue(horizontalScrollBar()->value() - step.x());
+    verticalScrollBar()->setValue(verticalScrollBar()->value() - step.y());
+}
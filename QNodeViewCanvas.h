@@ -26,13 +26,78 @@
 
 class QNodeViewCanvas : public QGraphicsView
 {
+    Q_OBJECT
+
 public:
     QNodeViewCanvas(QGraphicsScene* scene, QWidget* parent = NULL);
     virtual ~QNodeViewCanvas();
 
     void contextMenuEvent(QContextMenuEvent* event);
     void drawBackground(QPainter* painter, const QRectF& rect);
+    void drawForeground(QPainter* painter, const QRectF& rect);
+
+    // Drops to interactive quality until the idle timer expires
+    void beginInteraction();
+    void endInteraction();
+    bool isInteracting() const { return m_interacting; }
+
+    qint64 lastFrameTime() const { return m_lastFrameTime; }
+
+    // Without animation zoom and quality changes apply at once, so timer free replays stay deterministic
+    void setAnimated(bool animated);
+    bool isAnimated() const { return m_animated; }
+
+    // Centers on a scene area and zooms so it fills part of the view, e.g. for search results
+    void focusOn(const QRectF& sceneArea);
+
+    // Wire being dragged out of a port, drawn over the scene so no item is re-indexed while it follows the mouse
+    void setPendingWire(const QPainterPath& path);
+    void clearPendingWire();
+
+    // Items use this from paint() to skip labels and shadows while navigating
+    static bool isInteracting(const QWidget* viewport);
+
+signals:
+    void frameRendered(qint64 nanoseconds, bool interactive);
 
 protected:
     virtual void wheelEvent(QWheelEvent* event);
+    virtual void keyPressEvent(QKeyEvent* event);
+    virtual void keyReleaseEvent(QKeyEvent* event);
+    virtual void mousePressEvent(QMouseEvent* event);
+    virtual void mouseMoveEvent(QMouseEvent* event);
+    virtual void mouseReleaseEvent(QMouseEvent* event);
+    virtual void paintEvent(QPaintEvent* event);
+
+private slots:
+    void restoreQuality();
+    void stepInertia();
+    void stepZoom();
+
+private:
+    void panBy(const QPointF& delta);
+    void zoomBy(qreal factor, const QPoint& anchor);
+    void finishZoom();
+    void updateSceneArea(const QRectF& sceneArea);
+
+private:
+    QTimer m_idleTimer;
+    QTimer m_inertiaTimer;
+    QTimer m_zoomTimer;
+    QElapsedTimer m_panClock;
+    QElapsedTimer m_zoomClock;
+    QPixmap m_zoomSnapshot;
+    QPainterPath m_pendingWire;
+    QPoint m_panPosition;
+    QPointF m_panVelocity;
+    QPointF m_panRemainder;
+    QPointF m_zoomAnchor;
+    qint64 m_lastFrameTime;
+    qreal m_zoomFrom;
+    qreal m_zoomTo;
+    qreal m_zoomCurrent;
+    bool m_animated;
+    bool m_interacting;
+    bool m_panning;
+    bool m_spaceHeld;
 };
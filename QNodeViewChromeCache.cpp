@@ -0,0 +1,250 @@
+/*!
+  @file    QNodeViewChromeCache.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QCache>
+#include <QImage>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QVector>
+#include <QtMath>
+#include <qdrawutil.h>
+
+#include <QNodeViewChromeCache.h>
+
+namespace
+{
+    const qint32 s_cornerRadius = 5;
+    const qint32 s_maximumPixmapExtent = 4096;
+
+    bool s_shadowsEnabled = true;
+
+    QCache<quint64, QPixmap>& pixmapCache()
+    {
+        // Cost is measured in kilobytes
+        static QCache<quint64, QPixmap> cache(32 * 1024);
+        return cache;
+    }
+
+    quint64 pixmapKey(quint32 kind, const QSize& size, bool selected, qint32 bucket)
+    {
+        return (quint64(kind) << 41) |
+               (quint64(quint8(bucket + 128)) << 33) |
+               (quint64(selected ? 1 : 0) << 32) |
+               (quint64(quint16(size.height())) << 16) |
+               quint64(quint16(size.width()));
+    }
+
+    void insertPixmap(quint64 key, const QPixmap& pixmap)
+    {
+        const qint32 cost = qMax(1, pixmap.width() * pixmap.height() * 4 / 1024);
+        pixmapCache().insert(key, new QPixmap(pixmap), cost);
+    }
+
+    void boxBlur(const QVector<qint32>& source, QVector<qint32>& target, qint32 count, qint32 length, qint32 stride, qint32 step, qint32 radius)
+    {
+        const qint32 window = radius * 2 + 1;
+
+        for (qint32 line = 0; line < count; ++line)
+        {
+            const qint32 base = line * stride;
+            qint32 sum = 0;
+
+            for (qint32 offset = -radius; offset <= radius; ++offset)
+                sum += source[base + qBound(0, offset, length - 1) * step];
+
+            for (qint32 position = 0; position < length; ++position)
+            {
+                target[base + position * step] = sum / window;
+
+                const qint32 next = qMin(position + radius + 1, length - 1);
+                const qint32 last = qMax(position - radius, 0);
+                sum += source[base + next * step] - source[base + last * step];
+            }
+        }
+    }
+
+    void blurAlpha(QImage& image, qint32 radius)
+    {
+        const qint32 width = image.width();
+        const qint32 height = image.height();
+
+        QVector<qint32> alpha(width * height);
+        QVector<qint32> scratch(width * height);
+
+        for (qint32 y = 0; y < height; ++y)
+        {
+            const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            for (qint32 x = 0; x < width; ++x)
+                alpha[y * width + x] = qAlpha(line[x]);
+        }
+
+        // Three box passes are a close enough approximation of a gaussian
+        for (qint32 pass = 0; pass < 3; ++pass)
+        {
+            boxBlur(alpha, scratch, height, width, width, 1, radius);
+            boxBlur(scratch, alpha, width, height, 1, width, radius);
+        }
+
+        for (qint32 y = 0; y < height; ++y)
+        {
+            QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+            for (qint32 x = 0; x < width; ++x)
+                line[x] = qRgba(0, 0, 0, alpha[y * width + x]);
+        }
+    }
+
+    void setBodyColors(QPainter* painter, bool selected)
+    {
+        painter->setPen(QPen(QColor(30, 30, 30))); // GW-TODO: Expose to QStyle
+
+        if (selected)
+            painter->setBrush(QColor(100, 100, 100)); // GW-TODO: Expose to QStyle
+        else
+            painter->setBrush(QColor(80, 80, 80)); // GW-TODO: Expose to QStyle
+    }
+}
+
+void QNodeViewChromeCache::drawShadow(QPainter* painter, const QRectF& bodyRect)
+{
+    if (!s_shadowsEnabled)
+        return;
+
+    const qint32 bucket = zoomBucket(painter);
+    const qreal scale = bucketScale(bucket);
+    const qreal blur = shadowBlurRadius();
+
+    const QPixmap pixmap = shadow(bucket);
+
+    const qint32 margin = qCeil(blur) + s_cornerRadius + 1;
+    const qint32 sourceMargin = qMin(pixmap.width() / 2 - 1, qRound(margin * scale));
+
+    const QRectF target = bodyRect.adjusted(-blur, -blur, blur, blur).translated(0, shadowOffset());
+
+    qDrawBorderPixmap(painter, target.toRect(), QMargins(margin, margin, margin, margin),
+                      pixmap, pixmap.rect(), QMargins(sourceMargin, sourceMargin, sourceMargin, sourceMargin));
+}
+
+void QNodeViewChromeCache::drawBody(QPainter* painter, const QRectF& bodyRect, bool selected)
+{
+    const qint32 bucket = zoomBucket(painter);
+    const qreal scale = bucketScale(bucket);
+    const QSize size = bodyRect.size().toSize();
+
+    if ((size.width() + 2) * scale > s_maximumPixmapExtent ||
+        (size.height() + 2) * scale > s_maximumPixmapExtent)
+    {
+        // Too large to be worth caching at this zoom level
+        setBodyColors(painter, selected);
+        painter->drawRoundedRect(bodyRect, s_cornerRadius, s_cornerRadius);
+        return;
+    }
+
+    const QPixmap pixmap = body(size, selected, bucket);
+
+    // The pixmap carries a pixel of padding so the outline is not clipped
+    painter->drawPixmap(bodyRect.adjusted(-1, -1, 1, 1), pixmap, QRectF(pixmap.rect()));
+}
+
+void QNodeViewChromeCache::setShadowsEnabled(bool enabled)
+{
+    s_shadowsEnabled = enabled;
+}
+
+bool QNodeViewChromeCache::shadowsEnabled()
+{
+    return s_shadowsEnabled;
+}
+
+void QNodeViewChromeCache::clear()
+{
+    pixmapCache().clear();
+}
+
+qint32 QNodeViewChromeCache::zoomBucket(const QPainter* painter)
+{
+    const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+
+    // Quarter octave steps keep resampling error low without multiplying entries
+    return qBound(-16, qRound(qLn(qMax(scale, 0.0001)) / qLn(2.0) * 4.0), 12);
+}
+
+qreal QNodeViewChromeCache::bucketScale(qint32 bucket)
+{
+    return qPow(2.0, bucket / 4.0);
+}
+
+QPixmap QNodeViewChromeCache::body(const QSize& size, bool selected, qint32 bucket)
+{
+    const quint64 key = pixmapKey(0, size, selected, bucket);
+
+    QPixmap* cached = pixmapCache().object(key);
+    if (cached)
+        return *cached;
+
+    const qreal scale = bucketScale(bucket);
+
+    QPixmap pixmap(qCeil((size.width() + 2) * scale), qCeil((size.height() + 2) * scale));
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.scale(scale, scale);
+    painter.translate(1, 1);
+    setBodyColors(&painter, selected);
+    painter.drawRoundedRect(QRectF(QPointF(0, 0), size), s_cornerRadius, s_cornerRadius);
+    painter.end();
+
+    insertPixmap(key, pixmap);
+    return pixmap;
+}
+
+QPixmap QNodeViewChromeCache::shadow(qint32 bucket)
+{
+    const quint64 key = pixmapKey(1, QSize(), false, bucket);
+
+    QPixmap* cached = pixmapCache().object(key);
+    if (cached)
+        return *cached;
+
+    const qreal scale = bucketScale(bucket);
+    const qreal blur = shadowBlurRadius();
+
+    // Smallest rounded rect that still has a stretchable middle
+    const qint32 inner = s_cornerRadius * 2 + 4;
+    const qint32 extent = qCeil((inner + blur * 2.0) * scale);
+
+    QImage image(extent, extent, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.scale(scale, scale);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0, 0, 0, 160)); // GW-TODO: Expose to QStyle
+    painter.drawRoundedRect(QRectF(blur, blur, inner, inner), s_cornerRadius, s_cornerRadius);
+    painter.end();
+
+    blurAlpha(image, qMax(1, qRound(blur * scale / 3.0)));
+
+    const QPixmap pixmap = QPixmap::fromImage(image);
+    insertPixmap(key, pixmap);
+    return pixmap;
+}
@@ -0,0 +1,57 @@
+/*!
+  @file    QNodeViewChromeCache.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QPixmap>
+#include <QMargins>
+
+class QPainter;
+
+/*!
+    Process-wide cache of pre-rendered block chrome.
+
+    Most blocks share a handful of sizes, so instead of a device cache per
+    item the rounded body is rendered once per size, selection state and zoom
+    bucket. Drop shadows are a single pre-blurred nine-slice pixmap per zoom
+    bucket that is stretched around any block size.
+*/
+class QNodeViewChromeCache
+{
+public:
+    static void drawShadow(QPainter* painter, const QRectF& bodyRect);
+    static void drawBody(QPainter* painter, const QRectF& bodyRect, bool selected);
+
+    static qreal shadowBlurRadius() { return 16.0; }
+    static qreal shadowOffset() { return 5.0; }
+
+    static void setShadowsEnabled(bool enabled);
+    static bool shadowsEnabled();
+
+    static void clear();
+
+private:
+    static qint32 zoomBucket(const QPainter* painter);
+    static qreal bucketScale(qint32 bucket);
+
+    static QPixmap body(const QSize& size, bool selected, qint32 bucket);
+    static QPixmap shadow(qint32 bucket);
+};
@@ -26,7 +26,8 @@ enum QNodeViewType
     QNodeViewType_Port              = QGraphicsItem::UserType + 1,
     QNodeViewType_Connection        = QGraphicsItem::UserType + 2,
     QNodeViewType_ConnectionSplit   = QGraphicsItem::UserType + 3,
-    QNodeViewType_Block             = QGraphicsItem::UserType + 4
+    QNodeViewType_Block             = QGraphicsItem::UserType + 4,
+    QNodeViewType_Group             = QGraphicsItem::UserType + 5
 };
 
 enum QNodeViewPortLabel
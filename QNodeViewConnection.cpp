@@ -24,9 +24,56 @@
 #include <QGraphicsScene>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include <QNodeViewConnection.h>
+#include <QNodeViewGraph.h>
+#include <QNodeViewPool.h>
 #include <QNodeViewPort.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewTrace.h>
+
+// Number of line segments each curve is flattened into for hit testing and indexing
+static const qint32 s_curveSubdivisions = 16;
+
+// Maximum number of polyline segments in a leaf of the bounds tree
+static const qint32 s_leafSegments = 4;
+
+// Dash pattern of active connections in pen widths, and how fast it moves in pen widths per second
+static const qreal s_activityDash = 3.0;
+static const qreal s_activitySpeed = 12.0;
+
+static qreal s_activityPhase = 0.0;
+
+namespace
+{
+    void curveAnchors(const QPointF& startPosition, const QPointF& endPosition, QPointF* anchor1, QPointF* anchor2)
+    {
+        const qreal deltaX = endPosition.x() - startPosition.x();
+        const qreal deltaY = endPosition.y() - startPosition.y();
+
+        *anchor1 = QPointF(startPosition.x() + deltaX * 0.25, startPosition.y() + deltaY * 0.1);
+        *anchor2 = QPointF(startPosition.x() + deltaX * 0.75, startPosition.y() + deltaY * 0.9);
+    }
+}
+
+static QNodeViewPool<QNodeViewConnectionSplit>& splitPool()
+{
+    static QNodeViewPool<QNodeViewConnectionSplit> pool("QNodeViewConnectionSplit");
+    return pool;
+}
+
+static QNodeViewPool<QNodeViewConnection>& connectionPool()
+{
+    static QNodeViewPool<QNodeViewConnection> pool("QNodeViewConnection");
+    return pool;
+}
 
 QNodeViewConnectionSplit::QNodeViewConnectionSplit(QNodeViewConnection* connection)
 : QGraphicsPathItem(NULL)
@@ -42,7 +89,17 @@ QNodeViewConnectionSplit::QNodeViewConnectionSplit(QNodeViewConnection* connecti
 
 QNodeViewConnectionSplit::~QNodeViewConnectionSplit()
 {
+    QNodeViewScene::itemDestroyed(this);
+}
 
+void* QNodeViewConnectionSplit::operator new(size_t size)
+{
+    return splitPool().allocate(size);
+}
+
+void QNodeViewConnectionSplit::operator delete(void* pointer, size_t size)
+{
+    splitPool().deallocate(pointer, size);
 }
 
 void QNodeViewConnectionSplit::setSplitPosition(const QPointF& position)
@@ -59,10 +116,14 @@ void QNodeViewConnectionSplit::updatePath()
     path.moveTo(m_splitPosition);
     path.addEllipse(-m_radius, -m_radius, m_radius * 2, m_radius * 2);
     setPath(path);
+
+    QNodeViewScene::itemGeometryChanged(this);
 }
 
 void QNodeViewConnectionSplit::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
+    QNODEVIEW_TRACE_SCOPE("QNodeViewConnectionSplit::paint");
+
     Q_UNUSED(widget);
 
     // Only paint dirty regions for increased performance
@@ -82,11 +143,16 @@ void QNodeViewConnectionSplit::paint(QPainter* painter, const QStyleOptionGraphi
 
 QVariant QNodeViewConnectionSplit::itemChange(GraphicsItemChange change, const QVariant& value)
 {
+    QNodeViewScene::itemChanged(this, change);
+
     if (change == ItemScenePositionHasChanged)
     {
         const QPointF newPosition = value.toPointF();
         setSplitPosition(newPosition);
-        m_connection->updatePath();
+
+        // During a batch move the mover translates or updates the connection itself
+        if (!QNodeViewScene::isBatchMoving(this))
+            m_connection->updatePath();
     }
 
     return value;
@@ -96,6 +162,7 @@ QNodeViewConnection::QNodeViewConnection(QGraphicsItem* parent)
 : QGraphicsPathItem(parent)
 , m_startPort(NULL)
 , m_endPort(NULL)
+, m_active(false)
 {
     setCacheMode(DeviceCoordinateCache);
     setPen(QPen(QColor(170, 170, 170), 2)); // GW-TODO: Expose to QStyle
@@ -113,6 +180,18 @@ QNodeViewConnection::~QNodeViewConnection()
 
     Q_FOREACH (QNodeViewConnectionSplit* split, m_splits)
         delete split;
+
+    QNodeViewScene::itemDestroyed(this);
+}
+
+void* QNodeViewConnection::operator new(size_t size)
+{
+    return connectionPool().allocate(size);
+}
+
+void QNodeViewConnection::operator delete(void* pointer, size_t size)
+{
+    connectionPool().deallocate(pointer, size);
 }
 
 void QNodeViewConnection::setStartPosition(const QPointF& position)
@@ -129,23 +208,65 @@ void QNodeViewConnection::setStartPort(QNodeViewPort* port)
 {
     m_startPort = port;
     m_startPort->connections().append(this);
+
+    QNodeViewScene::connectionChanged(this);
 }
 
 void QNodeViewConnection::setEndPort(QNodeViewPort* port)
 {
     m_endPort = port;
     m_endPort->connections().append(this);
+
+    QNodeViewScene::connectionChanged(this);
+}
+
+void QNodeViewConnection::setActive(bool active)
+{
+    if (m_active == active)
+        return;
+
+    m_active = active;
+
+    // The dashes change every frame, so a device cache would only be rendered twice
+    setCacheMode(active ? NoCache : DeviceCoordinateCache);
+    update();
+
+    QNodeViewScene::activityChanged(this);
+}
+
+void QNodeViewConnection::setActivityPhase(qreal phase)
+{
+    s_activityPhase = phase;
+}
+
+qreal QNodeViewConnection::activityPhase()
+{
+    return s_activityPhase;
 }
 
 void QNodeViewConnection::updatePosition()
 {
-    m_startPosition = m_startPort->scenePos();
-    m_endPosition   = m_endPort->scenePos();
+    m_startPosition = m_startPort->anchor()->scenePos();
+    m_endPosition   = m_endPort->anchor()->scenePos();
+}
+
+QPainterPath QNodeViewConnection::curvePath(const QPointF& startPosition, const QPointF& endPosition)
+{
+    QPointF anchor1;
+    QPointF anchor2;
+    curveAnchors(startPosition, endPosition, &anchor1, &anchor2);
+
+    QPainterPath path(startPosition);
+    path.cubicTo(anchor1, anchor2, endPosition);
+    return path;
 }
 
 void QNodeViewConnection::updatePath()
 {
+    QNODEVIEW_TRACE_SCOPE("QNodeViewConnection::updatePath");
+
     QPainterPath path;
+    m_polyline.clear();
 
     QVector<QPointF> curvePoints;
     curvePoints.append(m_startPosition);
@@ -160,17 +281,338 @@ void QNodeViewConnection::updatePath()
         const QPointF& startPosition = curvePoints[index + 0];
         const QPointF& endPosition = curvePoints[index + 1];
 
-        const qreal deltaX = endPosition.x() - startPosition.x();
-        const qreal deltaY = endPosition.y() - startPosition.y();
-
-        QPointF anchor1(startPosition.x() + deltaX * 0.25, startPosition.y() + deltaY * 0.1);
-        QPointF anchor2(startPosition.x() + deltaX * 0.75, startPosition.y() + deltaY * 0.9);
+        QPointF anchor1;
+        QPointF anchor2;
+        curveAnchors(startPosition, endPosition, &anchor1, &anchor2);
 
         path.moveTo(startPosition);
         path.cubicTo(anchor1, anchor2, endPosition);
+
+        if (m_polyline.isEmpty())
+            m_polyline.append(startPosition);
+
+        for (qint32 step = 1; step <= s_curveSubdivisions; ++step)
+        {
+            const qreal t = qreal(step) / s_curveSubdivisions;
+            const qreal u = 1.0 - t;
+
+            m_polyline.append(startPosition * (u * u * u) +
+                              anchor1 * (3.0 * u * u * t) +
+                              anchor2 * (3.0 * u * t * t) +
+                              endPosition * (t * t * t));
+        }
     }
 
     setPath(path);
+    updateGeometry();
+
+    QNodeViewScene::itemGeometryChanged(this);
+}
+
+void QNodeViewConnection::settlePosition()
+{
+    const QPointF offset = pos();
+    if (offset.isNull())
+        return;
+
+    setPos(0, 0);
+
+    m_startPosition += offset;
+    m_endPosition += offset;
+    m_polyline.translate(offset);
+
+    // Arc lengths do not change under translation, only the bounds do
+    for (qint32 index = 0; index < m_boundsTree.size(); ++index)
+        m_boundsTree[index].bounds.translate(offset);
+
+    m_shape = QPainterPath();
+    setPath(path().translated(offset));
+
+    QNodeViewScene::itemGeometryChanged(this);
+}
+
+void QNodeViewConnection::updateGeometry()
+{
+    const qint32 segmentCount = qMax(0, m_polyline.size() - 1);
+
+    m_arcLengths.resize(m_polyline.size());
+    if (!m_polyline.isEmpty())
+        m_arcLengths[0] = 0.0;
+
+    for (qint32 index = 0; index < segmentCount; ++index)
+    {
+        const QPointF delta = m_polyline[index + 1] - m_polyline[index];
+        m_arcLengths[index + 1] = m_arcLengths[index] + qSqrt(QPointF::dotProduct(delta, delta));
+    }
+
+    // Bounding volume tree over the segments, children always follow their parent
+    m_boundsTree.clear();
+
+    if (segmentCount > 0)
+        buildBoundsTree(0, segmentCount);
+
+    m_shape = QPainterPath();
+}
+
+qint32 QNodeViewConnection::buildBoundsTree(qint32 first, qint32 last)
+{
+    const qint32 nodeIndex = m_boundsTree.size();
+    m_boundsTree.append(BoundsNode());
+
+    QRectF bounds(m_polyline[first], QSizeF(0, 0));
+    for (qint32 index = first + 1; index <= last; ++index)
+        bounds |= QRectF(m_polyline[index], QSizeF(0, 0));
+
+    BoundsNode node;
+    node.bounds = bounds;
+    node.first = first;
+    node.last = last;
+    node.left = -1;
+    node.right = -1;
+
+    if (last - first > s_leafSegments)
+    {
+        const qint32 middle = (first + last) / 2;
+        node.left = buildBoundsTree(first, middle);
+        node.right = buildBoundsTree(middle, last);
+    }
+
+    m_boundsTree[nodeIndex] = node;
+    return nodeIndex;
+}
+
+qreal QNodeViewConnection::closestPoint(const QPointF& point, qint32* segmentIndex, qreal* segmentT) const
+{
+    qreal bestDistance = std::numeric_limits<qreal>::max();
+    qint32 bestSegment = 0;
+    qreal bestT = 0.0;
+
+    if (m_boundsTree.isEmpty())
+    {
+        if (!m_polyline.isEmpty())
+        {
+            const QPointF delta = point - m_polyline.first();
+            bestDistance = qSqrt(QPointF::dotProduct(delta, delta));
+        }
+    }
+    else
+    {
+        QVarLengthArray<qint32, 64> stack;
+        stack.append(0);
+
+        while (!stack.isEmpty())
+        {
+            const BoundsNode& node = m_boundsTree[stack[stack.size() - 1]];
+            stack.resize(stack.size() - 1);
+
+            // Skip whole subtrees that cannot contain anything closer
+            const qreal dx = qMax(qMax(node.bounds.left() - point.x(), 0.0), point.x() - node.bounds.right());
+            const qreal dy = qMax(qMax(node.bounds.top() - point.y(), 0.0), point.y() - node.bounds.bottom());
+            if (qSqrt(dx * dx + dy * dy) >= bestDistance)
+                continue;
+
+            if (node.left >= 0)
+            {
+                stack.append(node.right);
+                stack.append(node.left);
+                continue;
+            }
+
+            for (qint32 index = node.first; index < node.last; ++index)
+            {
+                const QPointF segmentStart = m_polyline[index + 0];
+                const QPointF segment = m_polyline[index + 1] - segmentStart;
+                const qreal lengthSquared = QPointF::dotProduct(segment, segment);
+
+                qreal t = 0.0;
+                if (lengthSquared > 0.0)
+                    t = qBound(0.0, QPointF::dotProduct(point - segmentStart, segment) / lengthSquared, 1.0);
+
+                const QPointF delta = point - (segmentStart + segment * t);
+                const qreal distance = qSqrt(QPointF::dotProduct(delta, delta));
+
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestSegment = index;
+                    bestT = t;
+                }
+            }
+        }
+    }
+
+    if (segmentIndex)
+        *segmentIndex = bestSegment;
+
+    if (segmentT)
+        *segmentT = bestT;
+
+    return bestDistance;
+}
+
+qreal QNodeViewConnection::distanceTo(const QPointF& point) const
+{
+    return closestPoint(point, NULL, NULL);
+}
+
+qreal QNodeViewConnection::parameterAt(const QPointF& point) const
+{
+    const qreal length = m_arcLengths.isEmpty() ? 0.0 : m_arcLengths.last();
+    if (length <= 0.0)
+        return 0.0;
+
+    qint32 segment;
+    qreal t;
+    closestPoint(point, &segment, &t);
+
+    return (m_arcLengths[segment] + (m_arcLengths[segment + 1] - m_arcLengths[segment]) * t) / length;
+}
+
+QPointF QNodeViewConnection::pointAtParameter(qreal parameter) const
+{
+    if (m_polyline.size() < 2)
+        return m_polyline.isEmpty() ? m_startPosition : m_polyline.first();
+
+    const qreal target = qBound(0.0, parameter, 1.0) * m_arcLengths.last();
+
+    // First polyline point past the target, the segment ending there contains it
+    qint32 index = std::upper_bound(m_arcLengths.constBegin(), m_arcLengths.constEnd(), target) - m_arcLengths.constBegin();
+    index = qBound(1, index, m_polyline.size() - 1);
+
+    const qreal segmentLength = m_arcLengths[index] - m_arcLengths[index - 1];
+    const qreal t = (segmentLength > 0.0) ? (target - m_arcLengths[index - 1]) / segmentLength : 0.0;
+
+    return m_polyline[index - 1] + (m_polyline[index] - m_polyline[index - 1]) * t;
+}
+
+QNodeViewConnectionSplit* QNodeViewConnection::insertSplit(qreal parameter)
+{
+    return insertSplits(QVector<qreal>() << parameter).first();
+}
+
+QList<QNodeViewConnectionSplit*> QNodeViewConnection::insertSplits(const QVector<qreal>& parameters)
+{
+    Q_ASSERT(scene());
+
+    QVector<qreal> sortedParameters = parameters;
+    std::sort(sortedParameters.begin(), sortedParameters.end());
+
+    // Resolve every position against the current curve before any split reshapes it
+    QVector<QPointF> positions;
+    QVector<qint32> splitIndices;
+
+    Q_FOREACH (qreal parameter, sortedParameters)
+    {
+        const QPointF position = pointAtParameter(parameter);
+
+        // Each curve between two splits is flattened into the same number of segments
+        qint32 segment = 0;
+        closestPoint(position, &segment, NULL);
+
+        positions.append(position);
+        splitIndices.append(qBound(0, segment / s_curveSubdivisions, m_splits.size()));
+    }
+
+    QList<QNodeViewConnectionSplit*> result;
+
+    // Insert back to front so the remaining indices stay valid
+    for (qint32 index = positions.size() - 1; index >= 0; --index)
+    {
+        QNodeViewConnectionSplit* split = new QNodeViewConnectionSplit(this);
+        scene()->addItem(split);
+        split->setSplitPosition(positions[index]);
+        split->updatePath();
+
+        m_splits.insert(splitIndices[index], split);
+        result.prepend(split);
+    }
+
+    updatePath();
+    return result;
+}
+
+QNodeViewConnectionSplit* QNodeViewConnection::insertSplitAt(qint32 index, const QPointF& position)
+{
+    Q_ASSERT(scene());
+
+    QNodeViewConnectionSplit* split = new QNodeViewConnectionSplit(this);
+    scene()->addItem(split);
+    split->setSplitPosition(position);
+    split->updatePath();
+
+    m_splits.insert(qBound(0, index, m_splits.size()), split);
+    updatePath();
+    return split;
+}
+
+QList<QNodeViewConnectionSplit*> QNodeViewConnection::splitEvenly(qint32 count)
+{
+    QVector<qreal> parameters;
+
+    for (qint32 index = 1; index <= count; ++index)
+        parameters.append(qreal(index) / (count + 1));
+
+    return insertSplits(parameters);
+}
+
+void QNodeViewConnection::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewConnection::paint");
+
+    if (m_active)
+    {
+        const qreal period = s_activityDash * 2.0;
+
+        QPen activePen = pen();
+        activePen.setDashPattern(QVector<qreal>() << s_activityDash << s_activityDash);
+        activePen.setDashOffset(period - std::fmod(s_activityPhase * s_activitySpeed, period));
+
+        painter->setPen(activePen);
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPath(path());
+        return;
+    }
+
+    QGraphicsPathItem::paint(painter, option, widget);
+}
+
+QPainterPath QNodeViewConnection::shape() const
+{
+    if (m_shape.isEmpty() && m_polyline.size() > 1)
+    {
+        // Ribbon around the cached polyline, much cheaper than stroking the cubic path
+        const qreal halfWidth = qMax(pen().widthF(), 1.0) * 0.5 + 1.0;
+
+        const qint32 count = m_polyline.size();
+        QPolygonF ribbon(count * 2);
+
+        for (qint32 index = 0; index < count; ++index)
+        {
+            const QPointF previous = m_polyline[qMax(index - 1, 0)];
+            const QPointF next = m_polyline[qMin(index + 1, count - 1)];
+            const QPointF tangent = next - previous;
+            const qreal length = qSqrt(QPointF::dotProduct(tangent, tangent));
+
+            QPointF normal;
+            if (length > 0.0)
+                normal = QPointF(-tangent.y(), tangent.x()) * (halfWidth / length);
+
+            ribbon[index] = m_polyline[index] + normal;
+            ribbon[count * 2 - 1 - index] = m_polyline[index] - normal;
+        }
+
+        m_shape.setFillRule(Qt::WindingFill);
+        m_shape.addPolygon(ribbon);
+        m_shape.closeSubpath();
+    }
+
+    return m_shape;
+}
+
+QVariant QNodeViewConnection::itemChange(GraphicsItemChange change, const QVariant& value)
+{
+    QNodeViewScene::itemChanged(this, change);
+    return value;
 }
 
 void QNodeViewConnection::updateSplits()
@@ -191,38 +633,32 @@ QNodeViewPort* QNodeViewConnection::endPort() const
     return m_endPort;
 }
 
-void QNodeViewConnection::save(QDataStream& stream)
+void QNodeViewConnection::save(QNodeViewGraphConnection& record)
 {
-    stream << reinterpret_cast<quint64>(m_startPort);
-    stream << reinterpret_cast<quint64>(m_endPort);
+    record.startPort = m_startPort ? m_startPort->id() : 0;
+    record.endPort = m_endPort ? m_endPort->id() : 0;
 
-    const qint32 splitCount = m_splits.size();
-    stream << splitCount;
+    record.splits.clear();
+    record.splits.reserve(m_splits.size());
 
     Q_FOREACH (QNodeViewConnectionSplit* split, m_splits)
-    {
-        const QPointF splitPosition = split->splitPosition();
-        stream << splitPosition;
-    }
+        record.splits.append(split->splitPosition());
 }
 
-void QNodeViewConnection::load(QDataStream& stream, const QMap<quint64, QNodeViewPort*>& portMap)
+bool QNodeViewConnection::load(const QNodeViewGraphConnection& record, const QMap<quint64, QNodeViewPort*>& portMap)
 {
-    quint64 startPortIndex;
-    quint64 endPortIndex;
-    stream >> startPortIndex;
-    stream >> endPortIndex;
+    QNodeViewPort* startPort = portMap.value(record.startPort);
+    QNodeViewPort* endPort = portMap.value(record.endPort);
 
-    setStartPort(portMap[startPortIndex]);
-    setEndPort(portMap[endPortIndex]);
+    // Either end may be gone if a node type lost ports since the file was written
+    if (!startPort || !endPort)
+        return false;
 
-    qint32 splitCount;
-    stream >> splitCount;
+    setStartPort(startPort);
+    setEndPort(endPort);
 
-    for (qint32 splitIndex = 0; splitIndex < splitCount; splitIndex++)
+    Q_FOREACH (const QPointF& splitPosition, record.splits)
     {
-        QPointF splitPosition;
-        stream >> splitPosition;
         QNodeViewConnectionSplit* split = new QNodeViewConnectionSplit(this);
         scene()->addItem(split);
         split->setSplitPosition(splitPosition);
@@ -232,4 +668,5 @@ void QNodeViewConnection::load(QDataStream& stream, const QMap<quint64, QNodeVie
     updatePosition();
 	updatePath();
     updateSplits();
+    return true;
 }
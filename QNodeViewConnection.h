@@ -26,6 +26,7 @@
 
 class QNodeViewPort;
 class QNodeViewConnection;
+struct QNodeViewGraphConnection;
 
 class QNodeViewConnectionSplit : public QGraphicsPathItem
 {
@@ -33,6 +34,10 @@ public:
     QNodeViewConnectionSplit(QNodeViewConnection* connection);
     virtual ~QNodeViewConnectionSplit();
 
+    // Allocated from a QNodeViewPool, see QNodeViewPool.h
+    static void* operator new(size_t size);
+    static void operator delete(void* pointer, size_t size);
+
     void setSplitPosition(const QPointF& position);
 
     void updatePath();
@@ -61,6 +66,10 @@ public:
     QNodeViewConnection(QGraphicsItem* parent = NULL);
     virtual ~QNodeViewConnection();
 
+    // Allocated from a QNodeViewPool, see QNodeViewPool.h
+    static void* operator new(size_t size);
+    static void operator delete(void* pointer, size_t size);
+
     void setStartPosition(const QPointF& position);
     void setEndPosition(const QPointF& position);
 
@@ -71,6 +80,32 @@ public:
 	void updatePath();
     void updateSplits();
 
+    // Active connections are drawn with dashes marching from start to end, see QNodeViewAnimator
+    void setActive(bool active);
+    bool isActive() const { return m_active; }
+
+    // Seconds on the clock shared by all active connections, advanced by the animator
+    static void setActivityPhase(qreal phase);
+    static qreal activityPhase();
+
+    // A connection moved rigidly with moveBy() keeps its cached geometry; this folds the offset back into it
+    void settlePosition();
+
+    // The curve of a single unsplit segment, used for the preview while a wire is dragged out
+    static QPainterPath curvePath(const QPointF& startPosition, const QPointF& endPosition);
+
+    const QPolygonF& polyline() const { return m_polyline; }
+    qreal distanceTo(const QPointF& point) const;
+
+    // Parameters are normalized arc length along the whole connection
+    qreal parameterAt(const QPointF& point) const;
+    QPointF pointAtParameter(qreal parameter) const;
+
+    QNodeViewConnectionSplit* insertSplit(qreal parameter);
+    QList<QNodeViewConnectionSplit*> insertSplits(const QVector<qreal>& parameters);
+    QList<QNodeViewConnectionSplit*> splitEvenly(qint32 count);
+    QNodeViewConnectionSplit* insertSplitAt(qint32 index, const QPointF& position);
+
     QList<QNodeViewConnectionSplit*>& splits() { return m_splits; }
 
     QPointF startPosition() const { return m_startPosition; }
@@ -80,14 +115,39 @@ public:
     QNodeViewPort* endPort() const;
 
 public:
-    void save(QDataStream& stream);
-    void load(QDataStream&, const QMap<quint64, QNodeViewPort*>& portMap);
+    void save(QNodeViewGraphConnection& record);
+    bool load(const QNodeViewGraphConnection& record, const QMap<quint64, QNodeViewPort*>& portMap);
 
 public:
     // QGraphicsItem
     int type() const { return QNodeViewType_Connection; }
 
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
+    QPainterPath shape() const;
+
+protected:
+    QVariant itemChange(GraphicsItemChange change, const QVariant& value);
+
 private:
+    struct BoundsNode
+    {
+        QRectF bounds;
+        qint32 first;
+        qint32 last;
+        qint32 left;
+        qint32 right;
+    };
+
+    void updateGeometry();
+    qint32 buildBoundsTree(qint32 first, qint32 last);
+    qreal closestPoint(const QPointF& point, qint32* segmentIndex, qreal* segmentT) const;
+
+private:
+    QPolygonF m_polyline;
+    QVector<qreal> m_arcLengths;
+    QVector<BoundsNode> m_boundsTree;
+    mutable QPainterPath m_shape;
+
     QPointF m_startPosition;
     QPointF m_endPosition;
 
@@ -95,4 +155,6 @@ private:
 
     QNodeViewPort* m_startPort;
     QNodeViewPort* m_endPort;
+
+    bool m_active;
 };
@@ -0,0 +1,55 @@
+#/*!  @file    QNodeViewCore.pro
+#
+#  Copyright (c) 2014 Graham Wihlidal
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+#  @author  Graham Wihlidal
+#  @date    January 19, 2014
+#*/
+
+TARGET = QNodeViewCore
+TEMPLATE = lib
+
+CONFIG += staticlib c++11
+QT = core concurrent
+
+# Build with qmake CONFIG+=qnodeview_tracing to compile in the trace points
+qnodeview_tracing: DEFINES += QNODEVIEW_TRACING
+
+DESTDIR = $$OUT_PWD
+
+SOURCES +=  \
+            QNodeViewGraph.cpp \
+            QNodeViewGraphDiff.cpp \
+            QNodeViewGraphGenerator.cpp \
+            QNodeViewGraphJson.cpp \
+            QNodeViewGraphWriter.cpp \
+            QNodeViewJournal.cpp \
+            QNodeViewPool.cpp \
+            QNodeViewPortTypeRegistry.cpp \
+            QNodeViewProbe.cpp \
+            QNodeViewSearchIndex.cpp \
+            QNodeViewTrace.cpp
+
+HEADERS  += \
+            QNodeViewGraph.h \
+            QNodeViewGraphDiff.h \
+            QNodeViewGraphGenerator.h \
+            QNodeViewGraphWriter.h \
+            QNodeViewJournal.h \
+            QNodeViewPool.h \
+            QNodeViewPortTypeRegistry.h \
+            QNodeViewProbe.h \
+            QNodeViewSearchIndex.h \
+            QNodeViewTrace.h
@@ -26,13 +26,46 @@
 #include <QGraphicsSceneMouseEvent>
 
 #include <QNodeViewEditor.h>
+#include <QNodeViewCanvas.h>
 #include <QNodeViewPort.h>
 #include <QNodeViewConnection.h>
 #include <QNodeViewBlock.h>
+#include <QNodeViewGroup.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewPortTypeRegistry.h>
+#include <QNodeViewNodeTypeRegistry.h>
+#include <QNodeViewGraph.h>
+#include <QNodeViewJournal.h>
+#include <QNodeViewPool.h>
+#include <QNodeViewTrace.h>
+
+namespace
+{
+    QNodeViewConnection* findConnection(QNodeViewPort* startPort, QNodeViewPort* endPort)
+    {
+        Q_FOREACH (QNodeViewConnection* connection, startPort->connections())
+        {
+            if (connection->startPort() == startPort && connection->endPort() == endPort)
+                return connection;
+        }
+
+        return NULL;
+    }
+
+    void collectPorts(QNodeViewBlock* block, QHash<quint64, QNodeViewPort*>& ports)
+    {
+        Q_FOREACH (QNodeViewPort* port, block->ports())
+            ports.insert(port->id(), port);
+    }
+}
 
 QNodeViewEditor::QNodeViewEditor(QObject* parent)
 : QObject(parent)
-, m_connection(NULL)
+, m_wireStart(NULL)
+, m_journal(NULL)
+, m_movedSplit(NULL)
+, m_dragItem(NULL)
+, m_groupDrag(false)
 {
 }
 
@@ -51,22 +84,45 @@ bool QNodeViewEditor::eventFilter(QObject* object, QEvent* event)
 	{
         case QEvent::GraphicsSceneMousePress:
         {
+            QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::mousePress");
+
             switch (static_cast<qint32>(mouseEvent->button()))
             {
                 case Qt::LeftButton:
                 {
+                    // A release that went to another window never ended the last interaction
+                    finishInteraction();
+
                     QGraphicsItem* item = itemAt(mouseEvent->scenePos());
                     if (!item)
                         break;
 
                     if (item->type() == QNodeViewType_Port)
                     {
-                        m_connection = new QNodeViewConnection(NULL);
-                        m_scene->addItem(m_connection);
-                        m_connection->setStartPort(static_cast<QNodeViewPort*>(item));
-                        m_connection->setStartPosition(item->scenePos());
-                        m_connection->setEndPosition(mouseEvent->scenePos());
-                        m_connection->updatePath();
+                        QNodeViewPort* port = static_cast<QNodeViewPort*>(item);
+
+                        // The "more" row of a virtualized block pages through its rows
+                        if (port->block() && port->block()->isPortRowAnchor(port))
+                        {
+                            QNodeViewBlock* block = port->block();
+                            const qint32 firstRow = block->firstPortRow();
+                            block->scrollPortRows(firstRow + block->portRowLimit());
+
+                            // Wraps around after the last page
+                            if (block->firstPortRow() == firstRow)
+                                block->scrollPortRows(0);
+
+                            return true;
+                        }
+
+                        // Wires to a collapsed group attach to the member port behind the proxy
+                        if (!port->proxiedPorts().isEmpty())
+                            port = port->proxiedPorts().first();
+
+                        m_wireStart = port;
+                        m_wireOrigin = item->scenePos();
+                        updatePendingWire(mouseEvent->scenePos());
+                        updateHighlights();
                         return true;
                     }
                     else if (item->type() == QNodeViewType_Block)
@@ -74,6 +130,13 @@ bool QNodeViewEditor::eventFilter(QObject* object, QEvent* event)
                         // GW-TODO: Some form of property editor callback?
                     }
 
+                    if (item->type() == QNodeViewType_Block || item->type() == QNodeViewType_Group)
+                    {
+                        m_dragItem = item;
+                        m_dragOrigin = mouseEvent->scenePos();
+                    }
+
+                    beginMove(item);
                     break;
                 }
 
@@ -87,32 +150,46 @@ bool QNodeViewEditor::eventFilter(QObject* object, QEvent* event)
 
                     if (item->type() == QNodeViewType_Connection)
                     {
-                        showConnectionMenu(menuPosition, static_cast<QNodeViewConnection*>(item));
+                        showConnectionMenu(menuPosition, mouseEvent->scenePos(), static_cast<QNodeViewConnection*>(item));
                     }
-                    else if (item->type() == QNodeViewType_Block)
+                    else if (item->type() == QNodeViewType_Block || item->type() == QNodeViewType_Group)
                     {
                         showBlockMenu(menuPosition, static_cast<QNodeViewBlock*>(item));
                     }
                     else if (item->type() == QNodeViewType_ConnectionSplit)
                     {
-                        QNodeViewConnectionSplit* split = static_cast<QNodeViewConnectionSplit*>(item);
-                        QNodeViewConnection* connection = split->connection();
-                        connection->splits().removeAll(split);
-                        delete split;
-                        connection->updatePath();
+                        removeSplit(static_cast<QNodeViewConnectionSplit*>(item));
                     }
 
                     break;
                 }
             }
+
+            // A group drag is only decided by a real move, the scene applies the press to the selection first
+            break;
         }
 
         case QEvent::GraphicsSceneMouseMove:
         {
-            if (m_connection)
+            QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::mouseMove");
+
+            if (m_wireStart)
             {
-                m_connection->setEndPosition(mouseEvent->scenePos());
-                m_connection->updatePath();
+                updatePendingWire(mouseEvent->scenePos());
+                updateHighlights();
+                return true;
+            }
+
+            if (m_dragItem && (mouseEvent->buttons() & Qt::LeftButton))
+            {
+                // Decided on the first move, once the scene has applied the press to the selection
+                if (!m_groupDrag && !beginGroupDrag())
+                {
+                    m_dragItem = NULL;
+                    break;
+                }
+
+                dragGroup(mouseEvent->scenePos());
                 return true;
             }
 
@@ -121,31 +198,55 @@ bool QNodeViewEditor::eventFilter(QObject* object, QEvent* event)
 
         case QEvent::GraphicsSceneMouseRelease:
         {
-            if (m_connection && mouseEvent->button() == Qt::LeftButton)
+            QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::mouseRelease");
+
+            if (m_wireStart && mouseEvent->button() == Qt::LeftButton)
             {
+                clearHighlights();
+                clearPendingWire();
+
+                QNodeViewPort* startPort = m_wireStart;
+                m_wireStart = NULL;
+
                 QGraphicsItem* item = itemAt(mouseEvent->scenePos());
                 if (item && item->type() == QNodeViewType_Port)
                 {
-                    QNodeViewPort* startPort = m_connection->startPort();
                     QNodeViewPort* endPort = static_cast<QNodeViewPort*>(item);
 
-                    if (startPort->block()    != endPort->block() &&
-                        startPort->isOutput() != endPort->isOutput() &&
-                        !startPort->isConnected(endPort))
+                    if (!endPort->proxiedPorts().isEmpty())
+                        endPort = endPort->proxiedPorts().first();
+
+                    if (canConnect(startPort, endPort) && !startPort->isConnected(endPort))
                     {
-                        m_connection->setEndPosition(endPort->scenePos());
-                        m_connection->setEndPort(endPort);
-                        m_connection->updatePath();
-                        m_connection = NULL;
-                        return true;
+                        // Only an accepted drop becomes a scene item
+                        QNodeViewConnection* connection = new QNodeViewConnection(NULL);
+                        m_scene->addItem(connection);
+                        connection->setStartPort(startPort);
+                        connection->setEndPort(endPort);
+                        connection->setStartPosition(m_wireOrigin);
+                        connection->setEndPosition(item->scenePos());
+                        connection->updatePath();
+                        logConnection(QNodeViewJournal_Connect, connection);
                     }
                 }
 
-                delete m_connection;
-                m_connection = NULL;
                 return true;
             }
 
+            if (mouseEvent->button() == Qt::LeftButton)
+            {
+                finishGroupDrag();
+                finishMove();
+            }
+
+            break;
+        }
+
+        // Losing focus or the window mid-drag also loses the mouse grab, so the release never arrives
+        case QEvent::FocusOut:
+        case QEvent::WindowDeactivate:
+        {
+            finishInteraction();
             break;
         }
 	}
@@ -155,57 +256,286 @@ bool QNodeViewEditor::eventFilter(QObject* object, QEvent* event)
 
 void QNodeViewEditor::save(QDataStream& stream)
 {
+    QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::save");
+
+    QNodeViewGraph graph;
+    save(graph);
+
+    QString errorString;
+    if (!graph.save(stream, QNodeViewFile_Version, &errorString))
+        qWarning("QNodeViewEditor: %s", qPrintable(errorString));
+}
+
+bool QNodeViewEditor::load(QDataStream& stream)
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::load");
+
+    QNodeViewGraph graph;
+
+    QString errorString;
+    if (!graph.load(stream, &errorString))
+    {
+        qWarning("QNodeViewEditor: %s", qPrintable(errorString));
+        return false;
+    }
+
+    return load(graph);
+}
+
+void QNodeViewEditor::save(QNodeViewGraph& graph)
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::save(graph)");
+
+    graph.clear();
+
+    // Port and node types are stored by id, so the graph carries the tables to remap them on load
+    graph.portTypes = QNodeViewPortTypeRegistry::typeNames();
+    graph.nodeTypes = QNodeViewNodeTypeRegistry::typeNames();
+
+    // One pass over the scene, fetching and sorting its item list is a good part of the cost
     Q_FOREACH (QGraphicsItem* item, m_scene->items())
     {
         if (item->type() == QNodeViewType_Block)
 		{
-            stream << item->type();
-            static_cast<QNodeViewBlock*>(item)->save(stream);
+            QNodeViewBlock* block = static_cast<QNodeViewBlock*>(item);
+
+            // Grouped blocks are written out by their group
+            if (block->group())
+                continue;
+
+            graph.blocks.append(QNodeViewGraphBlock());
+            block->save(graph.blocks.last());
 		}
-    }
+        else if (item->type() == QNodeViewType_Group)
+        {
+            QNodeViewGroup* group = static_cast<QNodeViewGroup*>(item);
 
-    Q_FOREACH (QGraphicsItem* item, m_scene->items())
-    {
-        if (item->type() == QNodeViewType_Connection)
+            graph.groups.append(QNodeViewGraphGroup());
+            group->save(graph.groups.last());
+
+            // Connections inside a collapsed group are not in the scene
+            Q_FOREACH (QNodeViewConnection* connection, group->hiddenConnections())
+            {
+                graph.connections.append(QNodeViewGraphConnection());
+                connection->save(graph.connections.last());
+            }
+        }
+        else if (item->type() == QNodeViewType_Connection)
 		{
-            stream << item->type();
-            static_cast<QNodeViewConnection*>(item)->save(stream);
+            graph.connections.append(QNodeViewGraphConnection());
+            static_cast<QNodeViewConnection*>(item)->save(graph.connections.last());
 		}
     }
 }
 
-void QNodeViewEditor::load(QDataStream& stream)
+bool QNodeViewEditor::load(const QNodeViewGraph& graph)
 {
+    QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::load(graph)");
+
     QMap<quint64, QNodeViewPort*> portMap;
+    QList<QNodeViewGroup*> groups;
+
+    QVector<quint16> typeMap;
+    QVector<quint16> nodeTypeMap;
+
+    Q_FOREACH (const QString& typeName, graph.portTypes)
+        typeMap.append(QNodeViewPortTypeRegistry::registerType(typeName));
+
+    // Node types carry the port lists, so they must all be registered up front
+    nodeTypeMap.append(QNodeViewNodeTypeRegistry::CustomType);
+
+    for (qint32 index = 1; index < graph.nodeTypes.size(); ++index)
+    {
+        const quint16 nodeTypeId = QNodeViewNodeTypeRegistry::typeId(graph.nodeTypes[index]);
+        if (nodeTypeId == QNodeViewNodeTypeRegistry::CustomType)
+        {
+            qWarning("QNodeViewEditor: unknown node type %s", qPrintable(graph.nodeTypes[index]));
+            return false;
+        }
+
+        nodeTypeMap.append(nodeTypeId);
+    }
 
     Q_ASSERT(m_scene);
+    abandonInteraction();
     m_scene->clear();
 
-    while (!stream.atEnd())
-	{
-        qint32 type;
-        stream >> type;
+    // With every item gone the pools can hand their slabs back in one go
+    QNodeViewPoolBase::trimAll();
 
-        if (type == QNodeViewType_Block)
-		{
-            QNodeViewBlock* block = new QNodeViewBlock(NULL);
-            m_scene->addItem(block);
-            block->load(stream, portMap);
+    // Blocks past the row limit only create ports for the rows in view and the rows wires attach to
+    QSet<quint64> connectedPorts;
+
+    if (QNodeViewBlock::defaultPortRowLimit() > 0)
+    {
+        Q_FOREACH (const QNodeViewGraphConnection& record, graph.connections)
+        {
+            connectedPorts.insert(record.startPort);
+            connectedPorts.insert(record.endPort);
         }
-        else if (type == QNodeViewType_Connection)
-		{
-            QNodeViewConnection* connection = new QNodeViewConnection(NULL);
-            m_scene->addItem(connection);
-            connection->load(stream, portMap);
-		}
-	}
+    }
+
+    QList<QNodeViewBlock*> blocks;
+
+    Q_FOREACH (const QNodeViewGraphBlock& record, graph.blocks)
+    {
+        QNodeViewBlock* block = new QNodeViewBlock(NULL);
+        m_scene->addItem(block);
+        block->load(record, portMap, typeMap, nodeTypeMap, connectedPorts);
+        blocks.append(block);
+    }
+
+    Q_FOREACH (const QNodeViewGraphGroup& record, graph.groups)
+    {
+        QNodeViewGroup* group = new QNodeViewGroup(NULL);
+        m_scene->addItem(group);
+        group->load(record, portMap, typeMap, nodeTypeMap, connectedPorts);
+        groups.append(group);
+    }
+
+    Q_FOREACH (const QNodeViewGraphConnection& record, graph.connections)
+    {
+        QNodeViewConnection* connection = new QNodeViewConnection(NULL);
+        m_scene->addItem(connection);
+
+        if (!connection->load(record, portMap))
+            delete connection;
+    }
+
+    // Rows are virtualized once the connections are known, so connected rows keep their ports
+    Q_FOREACH (QNodeViewBlock* block, blocks)
+        block->updatePortRows();
+
+    Q_FOREACH (QNodeViewGroup* group, groups)
+    {
+        Q_FOREACH (QNodeViewBlock* member, group->members())
+            member->updatePortRows();
+
+        group->completeLoad();
+    }
+
+    return true;
+}
+
+void QNodeViewEditor::clear()
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::clear");
+
+    Q_ASSERT(m_scene);
+
+    if (m_journal)
+        m_journal->close();
+
+    abandonInteraction();
+    m_scene->clear();
+    QNodeViewPoolBase::trimAll();
+}
+
+bool QNodeViewEditor::canConnect(QNodeViewPort* startPort, QNodeViewPort* endPort) const
+{
+    if (startPort->block() == endPort->block() || startPort->isOutput() == endPort->isOutput())
+        return false;
+
+    // Anchors of hidden rows stand for many ports, so wires cannot end on them
+    if (endPort->block() && endPort->block()->isPortRowAnchor(endPort))
+        return false;
+
+    // Title rows are ports too, but never accept wires
+    if ((startPort->portFlags() | endPort->portFlags()) & (QNodeViewPortLabel_Name | QNodeViewPortLabel_Type))
+        return false;
+
+    QNodeViewPort* outputPort = startPort->isOutput() ? startPort : endPort;
+    QNodeViewPort* inputPort  = startPort->isOutput() ? endPort : startPort;
+    return QNodeViewPortTypeRegistry::isCompatible(outputPort->typeId(), inputPort->typeId());
+}
+
+void QNodeViewEditor::updateHighlights()
+{
+    Q_ASSERT(m_wireStart);
+
+    QRectF visibleRect;
+    Q_FOREACH (QGraphicsView* view, m_scene->views())
+        visibleRect |= view->mapToScene(view->viewport()->rect()).boundingRect();
+
+    // Only the ports on screen are checked, and only again once the view moves
+    if (visibleRect == m_highlightRect)
+        return;
+
+    m_highlightRect = visibleRect;
+
+    const QList<QGraphicsItem*> items = m_scene->items(visibleRect);
+
+    QNodeViewPort* startPort = m_wireStart;
+    QSet<QNodeViewPort*> highlightedPorts;
+
+    Q_FOREACH (QGraphicsItem* item, items)
+    {
+        if (item->type() != QNodeViewType_Port || !item->isVisible())
+            continue;
+
+        QNodeViewPort* port = static_cast<QNodeViewPort*>(item);
+        QNodeViewPort* target = port->proxiedPorts().isEmpty() ? port : port->proxiedPorts().first();
+
+        if (canConnect(startPort, target))
+            highlightedPorts.insert(port);
+    }
+
+    Q_FOREACH (QNodeViewPort* port, m_highlightedPorts)
+    {
+        if (!highlightedPorts.contains(port))
+            port->setHighlighted(false);
+    }
+
+    Q_FOREACH (QNodeViewPort* port, highlightedPorts)
+        port->setHighlighted(true);
+
+    m_highlightedPorts = highlightedPorts;
+}
+
+void QNodeViewEditor::clearHighlights()
+{
+    Q_FOREACH (QNodeViewPort* port, m_highlightedPorts)
+        port->setHighlighted(false);
+
+    m_highlightedPorts.clear();
+    m_highlightRect = QRectF();
+}
+
+void QNodeViewEditor::updatePendingWire(const QPointF& endPosition)
+{
+    Q_ASSERT(m_wireStart);
+
+    const QPainterPath path = QNodeViewConnection::curvePath(m_wireOrigin, endPosition);
+
+    Q_FOREACH (QGraphicsView* view, m_scene->views())
+    {
+        QNodeViewCanvas* canvas = qobject_cast<QNodeViewCanvas*>(view);
+        if (canvas)
+            canvas->setPendingWire(path);
+    }
+}
+
+void QNodeViewEditor::clearPendingWire()
+{
+    Q_FOREACH (QGraphicsView* view, m_scene->views())
+    {
+        QNodeViewCanvas* canvas = qobject_cast<QNodeViewCanvas*>(view);
+        if (canvas)
+            canvas->clearPendingWire();
+    }
 }
 
 QGraphicsItem* QNodeViewEditor::itemAt(const QPointF& point)
 {
     Q_ASSERT(m_scene);
 
-    QList<QGraphicsItem*> items = m_scene->items(QRectF(point - QPointF(1, 1), QSize(3, 3)));
+    const QRectF area(point - QPointF(1, 1), QSize(3, 3));
+
+    QNodeViewScene* nodeScene = qobject_cast<QNodeViewScene*>(m_scene);
+    if (nodeScene)
+        return nodeScene->nodeItemAt(area);
+
+    QList<QGraphicsItem*> items = m_scene->items(area);
 
     Q_FOREACH (QGraphicsItem* item, items)
     {
@@ -218,37 +548,621 @@ QGraphicsItem* QNodeViewEditor::itemAt(const QPointF& point)
     return NULL;
 }
 
+QList<QNodeViewBlock*> QNodeViewEditor::selectedBlocks()
+{
+    QList<QNodeViewBlock*> result;
+
+    Q_FOREACH (QGraphicsItem* item, m_scene->selectedItems())
+    {
+        if (item->type() != QNodeViewType_Block)
+            continue;
+
+        QNodeViewBlock* block = static_cast<QNodeViewBlock*>(item);
+        if (!block->group())
+            result.append(block);
+    }
+
+    return result;
+}
+
 void QNodeViewEditor::showBlockMenu(const QPoint& point, QNodeViewBlock* block)
 {
+    const QList<QNodeViewBlock*> groupBlocks = selectedBlocks();
+
+    QNodeViewGroup* group = (block->type() == QNodeViewType_Group) ? static_cast<QNodeViewGroup*>(block) : block->group();
+
     QMenu menu;
+    QAction* groupAction = NULL;
+    QAction* collapseAction = NULL;
+    QAction* expandAction = NULL;
+    QAction* ungroupAction = NULL;
+
+    if (group)
+    {
+        if (group->isCollapsed())
+            expandAction = menu.addAction("Expand");
+        else
+            collapseAction = menu.addAction("Collapse Group");
+
+        ungroupAction = menu.addAction("Ungroup");
+        menu.addSeparator();
+    }
+    else if (groupBlocks.size() > 1 && groupBlocks.contains(block))
+    {
+        groupAction = menu.addAction("Group Selected");
+        menu.addSeparator();
+    }
+
     QAction* deleteAction = menu.addAction("Delete");
     QAction* selection = menu.exec(point);
+    if (!selection)
+        return;
+
     if (selection == deleteAction)
     {
+        if (block->type() == QNodeViewType_Block)
+            logBlock(QNodeViewJournal_DeleteBlock, block);
+
+        m_moveStart.remove(block);
         delete block;
     }
+    else if (selection == groupAction)
+    {
+        m_scene->clearSelection();
+
+        group = new QNodeViewGroup(NULL);
+        m_scene->addItem(group);
+        group->setName("Group");
+
+        Q_FOREACH (QNodeViewBlock* groupBlock, groupBlocks)
+            group->addMember(groupBlock);
+
+        group->collapse();
+    }
+    else if (selection == collapseAction)
+    {
+        m_scene->clearSelection();
+        group->collapse();
+    }
+    else if (selection == expandAction)
+    {
+        group->expand();
+    }
+    else if (selection == ungroupAction)
+    {
+        group->expand();
+
+        Q_FOREACH (QNodeViewBlock* member, group->members())
+            group->removeMember(member);
+
+        delete group;
+    }
 }
 
-void QNodeViewEditor::showConnectionMenu(const QPoint& point, QNodeViewConnection* connection)
+void QNodeViewEditor::showConnectionMenu(const QPoint& point, const QPointF& scenePoint, QNodeViewConnection* connection)
 {
     QMenu menu;
     QAction* splitAction = menu.addAction("Split");
+    QMenu* splitEvenlyMenu = menu.addMenu("Split Evenly");
+
+    QMap<QAction*, qint32> splitCounts;
+    for (qint32 count = 2; count <= 4; ++count)
+        splitCounts.insert(splitEvenlyMenu->addAction(QString("%1 Points").arg(count)), count);
+
     menu.addSeparator();
     QAction* deleteAction = menu.addAction("Delete");
     QAction* selection = menu.exec(point);
+    if (!selection)
+        return;
+
     if (selection == deleteAction)
     {
+        logConnection(QNodeViewJournal_Disconnect, connection);
         delete connection;
+        return;
+    }
+
+    QList<QNodeViewConnectionSplit*> splits;
+
+    if (selection == splitAction)
+        splits.append(connection->insertSplit(connection->parameterAt(scenePoint)));
+    else if (splitCounts.contains(selection))
+        splits = connection->splitEvenly(splitCounts.value(selection));
+
+    // Logged front to back, so replaying each at its final index rebuilds the same order
+    Q_FOREACH (QNodeViewConnectionSplit* split, splits)
+        logSplit(QNodeViewJournal_AddSplit, split);
+}
+
+void QNodeViewEditor::removeSplit(QNodeViewConnectionSplit* split)
+{
+    logSplit(QNodeViewJournal_RemoveSplit, split);
+
+    QNodeViewConnection* connection = split->connection();
+    connection->splits().removeAll(split);
+    delete split;
+    connection->updatePath();
+}
+
+void QNodeViewEditor::setJournal(QNodeViewJournal* journal)
+{
+    m_journal = journal;
+}
+
+QNodeViewBlock* QNodeViewEditor::createBlock(quint16 nodeTypeId, const QPointF& position, const QString& title)
+{
+    Q_ASSERT(m_scene);
+
+    QNodeViewBlock* block = new QNodeViewBlock(NULL);
+    m_scene->addItem(block);
+    block->setNodeType(nodeTypeId);
+    block->setPos(position);
+
+    if (!title.isEmpty())
+        block->setTitle(title);
+
+    logBlock(QNodeViewJournal_AddBlock, block);
+    return block;
+}
+
+void QNodeViewEditor::log(const QNodeViewJournalRecord& record)
+{
+    if (m_journal)
+        m_journal->append(record);
+}
+
+void QNodeViewEditor::logBlock(qint32 operation, QNodeViewBlock* block)
+{
+    if (!m_journal || block->id() == 0)
+        return;
+
+    QNodeViewJournalRecord record;
+    record.operation = operation;
+    record.startPort = block->id();
+    record.position = block->pos();
+
+    if (operation == QNodeViewJournal_AddBlock)
+    {
+        QNodeViewGraphBlock blockRecord;
+        block->save(blockRecord);
+
+        record.nodeType = QNodeViewNodeTypeRegistry::typeNames().value(blockRecord.nodeType);
+        record.title = blockRecord.title;
+        record.ports = blockRecord.ports;
+
+        Q_FOREACH (const QNodeViewGraphPort& port, blockRecord.ports)
+            record.portTypes.append(QNodeViewPortTypeRegistry::typeName(port.typeId));
     }
-    else if (selection == splitAction)
+
+    log(record);
+}
+
+void QNodeViewEditor::logConnection(qint32 operation, QNodeViewConnection* connection)
+{
+    if (!m_journal || !connection->startPort() || !connection->endPort())
+        return;
+
+    QNodeViewJournalRecord record;
+    record.operation = operation;
+    record.startPort = connection->startPort()->id();
+    record.endPort = connection->endPort()->id();
+    log(record);
+}
+
+void QNodeViewEditor::logSplit(qint32 operation, QNodeViewConnectionSplit* split)
+{
+    QNodeViewConnection* connection = split->connection();
+    if (!m_journal || !connection->startPort() || !connection->endPort())
+        return;
+
+    QNodeViewJournalRecord record;
+    record.operation = operation;
+    record.startPort = connection->startPort()->id();
+    record.endPort = connection->endPort()->id();
+    record.index = connection->splits().indexOf(split);
+    record.position = split->splitPosition();
+    log(record);
+}
+
+void QNodeViewEditor::abandonInteraction()
+{
+    cancelWire();
+
+    m_splitDragStart.clear();
+    finishGroupDrag();
+
+    m_moveStart.clear();
+    m_movedSplit = NULL;
+}
+
+void QNodeViewEditor::finishInteraction()
+{
+    cancelWire();
+    finishGroupDrag();
+    finishMove();
+}
+
+void QNodeViewEditor::cancelWire()
+{
+    if (!m_wireStart)
+        return;
+
+    clearHighlights();
+    clearPendingWire();
+    m_wireStart = NULL;
+}
+
+void QNodeViewEditor::beginMove(QGraphicsItem* item)
+{
+    m_moveStart.clear();
+    m_movedSplit = NULL;
+
+    if (!m_journal)
+        return;
+
+    if (item->type() == QNodeViewType_ConnectionSplit)
     {
-        QNodeViewConnectionSplit* split = new QNodeViewConnectionSplit(connection);
-        m_scene->addItem(split);
-        // GW-TODO: Temp: Need to calculate multiple points
-        QPointF splitPosition = (connection->startPosition() + connection->endPosition()) / 2;
-        split->setSplitPosition(splitPosition);
-        split->updatePath();
-        connection->splits().append(split);
+        m_movedSplit = static_cast<QNodeViewConnectionSplit*>(item);
+        m_splitMoveStart = m_movedSplit->splitPosition();
+        return;
+    }
+
+    if (item->type() != QNodeViewType_Block)
+        return;
+
+    // The scene moves the whole selection if the pressed block is part of it
+    m_moveStart.insert(static_cast<QNodeViewBlock*>(item), item->pos());
+
+    Q_FOREACH (QNodeViewBlock* block, selectedBlocks())
+        m_moveStart.insert(block, block->pos());
+}
+
+void QNodeViewEditor::finishMove()
+{
+    // Only where a drag ended is logged, not every step along the way
+    for (QHash<QNodeViewBlock*, QPointF>::const_iterator entry = m_moveStart.constBegin(); entry != m_moveStart.constEnd(); ++entry)
+    {
+        if (entry.key()->pos() != entry.value())
+            logBlock(QNodeViewJournal_MoveBlock, entry.key());
+    }
+
+    if (m_movedSplit && m_movedSplit->splitPosition() != m_splitMoveStart)
+        logSplit(QNodeViewJournal_MoveSplit, m_movedSplit);
+
+    m_moveStart.clear();
+    m_movedSplit = NULL;
+}
+
+bool QNodeViewEditor::beginGroupDrag()
+{
+    // Single items are left to the scene, there is nothing to share between wires
+    if (!m_dragItem->isSelected())
+        return false;
+
+    QSet<QNodeViewBlock*> moving;
+    QList<QNodeViewConnectionSplit*> splits;
+
+    Q_FOREACH (QGraphicsItem* item, m_scene->selectedItems())
+    {
+        if (!(item->flags() & QGraphicsItem::ItemIsMovable))
+            continue;
+
+        if (item->type() == QNodeViewType_Block || item->type() == QNodeViewType_Group)
+            moving.insert(static_cast<QNodeViewBlock*>(item));
+        else if (item->type() == QNodeViewType_ConnectionSplit)
+            splits.append(static_cast<QNodeViewConnectionSplit*>(item));
+    }
+
+    if (moving.size() < 2)
+        return false;
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::beginGroupDrag");
+
+    m_internalConnections.clear();
+    m_boundaryConnections.clear();
+
+    Q_FOREACH (QNodeViewBlock* block, moving)
+    {
+        Q_FOREACH (QNodeViewPort* port, block->ports())
+        {
+            QVector<QNodeViewConnection*> connections = port->connections();
+
+            Q_FOREACH (QNodeViewPort* proxied, port->proxiedPorts())
+                connections += proxied->connections();
+
+            Q_FOREACH (QNodeViewConnection* connection, connections)
+            {
+                // Wires hidden inside a collapsed group are not drawn
+                if (!connection->scene() || !connection->startPort() || !connection->endPort())
+                    continue;
+
+                // Wires with both ends in the selection only translate, the rest change shape
+                if (moving.contains(connection->startPort()->anchor()->block()) && moving.contains(connection->endPort()->anchor()->block()))
+                    m_internalConnections.insert(connection);
+                else
+                    m_boundaryConnections.insert(connection);
+            }
+        }
+    }
+
+    // Selected splits on internal wires travel with them, the others reshape their wire
+    m_dragSplits.clear();
+
+    Q_FOREACH (QNodeViewConnectionSplit* split, splits)
+    {
+        if (m_internalConnections.contains(split->connection()))
+            continue;
+
+        m_dragSplits.append(split);
+        m_boundaryConnections.insert(split->connection());
+    }
+
+    // Every split the drag carries is journaled where it ends, like the blocks in finishMove()
+    m_splitDragStart.clear();
+
+    if (m_journal)
+    {
+        Q_FOREACH (QNodeViewConnection* connection, m_internalConnections)
+        {
+            Q_FOREACH (QNodeViewConnectionSplit* split, connection->splits())
+                m_splitDragStart.insert(split, split->splitPosition());
+        }
+
+        Q_FOREACH (QNodeViewConnectionSplit* split, m_dragSplits)
+            m_splitDragStart.insert(split, split->splitPosition());
+    }
+
+    m_dragBlocks = moving.toList();
+    m_dragOffset = QPointF();
+    m_groupDrag = true;
+
+    QNodeViewScene* nodeScene = qobject_cast<QNodeViewScene*>(m_scene);
+    if (nodeScene)
+        nodeScene->beginBatchMove();
+
+    return true;
+}
+
+void QNodeViewEditor::dragGroup(const QPointF& scenePosition)
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::dragGroup");
+
+    const QPointF offset = scenePosition - m_dragOrigin;
+    const QPointF step = offset - m_dragOffset;
+    m_dragOffset = offset;
+
+    if (step.isNull())
+        return;
+
+    Q_FOREACH (QNodeViewBlock* block, m_dragBlocks)
+        block->moveBy(step.x(), step.y());
+
+    // Moving the item keeps its cached path and device cache, it is settled on release
+    Q_FOREACH (QNodeViewConnection* connection, m_internalConnections)
+    {
+        connection->moveBy(step.x(), step.y());
+
+        Q_FOREACH (QNodeViewConnectionSplit* split, connection->splits())
+            split->moveBy(step.x(), step.y());
+    }
+
+    Q_FOREACH (QNodeViewConnectionSplit* split, m_dragSplits)
+        split->moveBy(step.x(), step.y());
+
+    Q_FOREACH (QNodeViewConnection* connection, m_boundaryConnections)
+    {
+        connection->updatePosition();
         connection->updatePath();
+        connection->updateSplits();
+    }
+}
+
+void QNodeViewEditor::finishGroupDrag()
+{
+    m_dragItem = NULL;
+
+    if (!m_groupDrag)
+        return;
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewEditor::finishGroupDrag");
+
+    m_groupDrag = false;
+
+    Q_FOREACH (QNodeViewConnection* connection, m_internalConnections)
+        connection->settlePosition();
+
+    for (QHash<QNodeViewConnectionSplit*, QPointF>::const_iterator entry = m_splitDragStart.constBegin(); entry != m_splitDragStart.constEnd(); ++entry)
+    {
+        if (entry.key()->splitPosition() != entry.value())
+            logSplit(QNodeViewJournal_MoveSplit, entry.key());
+    }
+
+    m_splitDragStart.clear();
+
+    QNodeViewScene* nodeScene = qobject_cast<QNodeViewScene*>(m_scene);
+    if (nodeScene)
+        nodeScene->endBatchMove();
+
+    m_dragBlocks.clear();
+    m_dragSplits.clear();
+    m_internalConnections.clear();
+    m_boundaryConnections.clear();
+}
+
+qint32 QNodeViewEditor::replay(const QVector<QNodeViewJournalRecord>& records)
+{
+    Q_ASSERT(m_scene);
+
+    // Journaled edits may address any row, so virtualized blocks show all of them while replaying
+    QHash<QNodeViewBlock*, qint32> rowLimits;
+    const qint32 defaultRowLimit = QNodeViewBlock::defaultPortRowLimit();
+    QNodeViewBlock::setDefaultPortRowLimit(0);
+
+    Q_FOREACH (QGraphicsItem* item, m_scene->items())
+    {
+        if (item->type() != QNodeViewType_Block)
+            continue;
+
+        QNodeViewBlock* block = static_cast<QNodeViewBlock*>(item);
+        if (block->portRowLimit() == 0)
+            continue;
+
+        rowLimits.insert(block, block->portRowLimit());
+        block->setPortRowLimit(0);
+    }
+
+    QHash<quint64, QNodeViewPort*> ports;
+
+    Q_FOREACH (QGraphicsItem* item, m_scene->items())
+    {
+        if (item->type() == QNodeViewType_Port)
+            ports.insert(static_cast<QNodeViewPort*>(item)->id(), static_cast<QNodeViewPort*>(item));
+        else if (item->type() == QNodeViewType_Group)
+        {
+            // Members of collapsed groups are out of the scene
+            Q_FOREACH (QNodeViewBlock* member, static_cast<QNodeViewGroup*>(item)->members())
+                collectPorts(member, ports);
+        }
+    }
+
+    qint32 applied = 0;
+
+    Q_FOREACH (const QNodeViewJournalRecord& record, records)
+    {
+        if (apply(record, ports))
+            ++applied;
+        else
+            qWarning("QNodeViewEditor: could not replay journal operation %d", record.operation);
+    }
+
+    // Replayed deletes may have removed some of the blocks, so only blocks still in the scene are touched
+    QNodeViewBlock::setDefaultPortRowLimit(defaultRowLimit);
+
+    Q_FOREACH (QGraphicsItem* item, m_scene->items())
+    {
+        if (item->type() == QNodeViewType_Block)
+            static_cast<QNodeViewBlock*>(item)->setPortRowLimit(rowLimits.value(static_cast<QNodeViewBlock*>(item), defaultRowLimit));
+    }
+
+    return applied;
+}
+
+bool QNodeViewEditor::apply(const QNodeViewJournalRecord& record, QHash<quint64, QNodeViewPort*>& ports)
+{
+    QNodeViewPort* startPort = ports.value(record.startPort);
+    QNodeViewPort* endPort = ports.value(record.endPort);
+
+    switch (record.operation)
+    {
+        case QNodeViewJournal_AddBlock:
+        {
+            QNodeViewBlock* block = new QNodeViewBlock(NULL);
+            m_scene->addItem(block);
+            block->setPos(record.position);
+
+            const quint16 nodeTypeId = QNodeViewNodeTypeRegistry::typeId(record.nodeType);
+
+            if (nodeTypeId != QNodeViewNodeTypeRegistry::CustomType)
+            {
+                block->setNodeType(nodeTypeId);
+
+                if (!record.title.isEmpty())
+                    block->setTitle(record.title);
+            }
+            else
+            {
+                for (qint32 index = 0; index < record.ports.size(); ++index)
+                {
+                    const QNodeViewGraphPort& portRecord = record.ports[index];
+                    const quint16 typeId = QNodeViewPortTypeRegistry::registerType(record.portTypes.value(index));
+                    block->addPort(portRecord.name, portRecord.isOutput, portRecord.flags, portRecord.id, typeId);
+                }
+            }
+
+            const QVector<QNodeViewPort*> blockPorts = block->ports();
+            for (qint32 index = 0; index < qMin(blockPorts.size(), record.ports.size()); ++index)
+                blockPorts[index]->setId(record.ports[index].id);
+
+            collectPorts(block, ports);
+            return true;
+        }
+
+        case QNodeViewJournal_DeleteBlock:
+        case QNodeViewJournal_MoveBlock:
+        {
+            if (!startPort)
+                return false;
+
+            QNodeViewBlock* block = startPort->block();
+
+            if (record.operation == QNodeViewJournal_MoveBlock)
+            {
+                block->setPos(record.position);
+                return true;
+            }
+
+            Q_FOREACH (QNodeViewPort* port, block->ports())
+                ports.remove(port->id());
+
+            delete block;
+            return true;
+        }
+
+        case QNodeViewJournal_Connect:
+        {
+            if (!startPort || !endPort || startPort->isConnected(endPort))
+                return false;
+
+            QNodeViewConnection* connection = new QNodeViewConnection(NULL);
+            m_scene->addItem(connection);
+            connection->setStartPort(startPort);
+            connection->setEndPort(endPort);
+            connection->updatePosition();
+            connection->updatePath();
+            return true;
+        }
+
+        default:
+            break;
+    }
+
+    // Everything else addresses an existing connection
+    QNodeViewConnection* connection = (startPort && endPort) ? findConnection(startPort, endPort) : NULL;
+    if (!connection)
+        return false;
+
+    switch (record.operation)
+    {
+        case QNodeViewJournal_Disconnect:
+            delete connection;
+            return true;
+
+        case QNodeViewJournal_AddSplit:
+            connection->insertSplitAt(record.index, record.position);
+            return true;
+
+        case QNodeViewJournal_RemoveSplit:
+        case QNodeViewJournal_MoveSplit:
+        {
+            if (record.index < 0 || record.index >= connection->splits().size())
+                return false;
+
+            QNodeViewConnectionSplit* split = connection->splits()[record.index];
+
+            if (record.operation == QNodeViewJournal_MoveSplit)
+            {
+                split->setSplitPosition(record.position);
+                connection->updatePath();
+                return true;
+            }
+
+            connection->splits().removeAt(record.index);
+            delete split;
+            connection->updatePath();
+            return true;
+        }
+
+        default:
+            return false;
     }
 }
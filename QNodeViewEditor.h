@@ -21,13 +21,23 @@
 
 #pragma once
 
+#include <QHash>
 #include <QObject>
+#include <QPointF>
+#include <QRectF>
+#include <QSet>
+#include <QVector>
 
 class QPointF;
 class QGraphicsScene;
 class QGraphicsItem;
 class QNodeViewBlock;
+class QNodeViewPort;
+class QNodeViewGraph;
 class QNodeViewConnection;
+class QNodeViewConnectionSplit;
+class QNodeViewJournal;
+struct QNodeViewJournalRecord;
 
 class QNodeViewEditor : public QObject
 {
@@ -40,15 +50,84 @@ public:
     bool eventFilter(QObject* object, QEvent* event);
 
     void save(QDataStream& stream);
-    void load(QDataStream& stream);
+    bool load(QDataStream& stream);
+
+    // Walks the whole scene on the calling thread, in time linear in the graph size, see QNodeViewBench save
+    void save(QNodeViewGraph& graph);
+    bool load(const QNodeViewGraph& graph);
+
+    // Deletes every item and closes the journal, a cleared scene has no save to journal against
+    void clear();
+
+    // Every edit made through the editor is appended to the journal, if one is set
+    void setJournal(QNodeViewJournal* journal);
+    QNodeViewJournal* journal() const { return m_journal; }
+
+    // An empty title keeps the node type's own
+    QNodeViewBlock* createBlock(quint16 nodeTypeId, const QPointF& position, const QString& title = QString());
+
+    // Reapplies journaled edits over the graph they were logged against, returns how many applied
+    qint32 replay(const QVector<QNodeViewJournalRecord>& records);
 
 private:
+    bool canConnect(QNodeViewPort* startPort, QNodeViewPort* endPort) const;
+
+    void updateHighlights();
+    void clearHighlights();
+
+    // The wire being dragged out of a port is only a canvas overlay until it is dropped
+    void updatePendingWire(const QPointF& endPosition);
+    void clearPendingWire();
+
     QGraphicsItem* itemAt(const QPointF& point);
+    QList<QNodeViewBlock*> selectedBlocks();
 
     void showBlockMenu(const QPoint& point, QNodeViewBlock* block);
-    void showConnectionMenu(const QPoint& point, QNodeViewConnection* connection);
+    void showConnectionMenu(const QPoint& point, const QPointF& scenePoint, QNodeViewConnection* connection);
+
+    void removeSplit(QNodeViewConnectionSplit* split);
+
+    void log(const QNodeViewJournalRecord& record);
+    void logBlock(qint32 operation, QNodeViewBlock* block);
+    void logConnection(qint32 operation, QNodeViewConnection* connection);
+    void logSplit(qint32 operation, QNodeViewConnectionSplit* split);
+
+    // Drops the wire, move and drag in progress, before the items they refer to are deleted
+    void abandonInteraction();
+
+    // Ends the interaction in progress when its release will not arrive, moves are kept and logged
+    void finishInteraction();
+    void cancelWire();
+
+    void beginMove(QGraphicsItem* item);
+    void finishMove();
+
+    // Dragging several blocks moves them as one rigid group, see beginGroupDrag()
+    bool beginGroupDrag();
+    void dragGroup(const QPointF& scenePosition);
+    void finishGroupDrag();
+
+    bool apply(const QNodeViewJournalRecord& record, QHash<quint64, QNodeViewPort*>& ports);
 
 private:
     QGraphicsScene* m_scene;
-    QNodeViewConnection* m_connection;
+    QNodeViewPort* m_wireStart;
+    QPointF m_wireOrigin;
+    QSet<QNodeViewPort*> m_highlightedPorts;
+    QRectF m_highlightRect;
+
+    QNodeViewJournal* m_journal;
+    QHash<QNodeViewBlock*, QPointF> m_moveStart;
+    QNodeViewConnectionSplit* m_movedSplit;
+    QPointF m_splitMoveStart;
+
+    QGraphicsItem* m_dragItem;
+    QPointF m_dragOrigin;
+    QPointF m_dragOffset;
+    bool m_groupDrag;
+    QList<QNodeViewBlock*> m_dragBlocks;
+    QList<QNodeViewConnectionSplit*> m_dragSplits;
+    QHash<QNodeViewConnectionSplit*, QPointF> m_splitDragStart;
+    QSet<QNodeViewConnection*> m_internalConnections;
+    QSet<QNodeViewConnection*> m_boundaryConnections;
 };
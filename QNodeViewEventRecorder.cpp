@@ -0,0 +1,212 @@
+/*!
+  @file    QNodeViewEventRecorder.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QDataStream>
+#include <QFile>
+#include <QGraphicsView>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QScrollBar>
+#include <QWheelEvent>
+
+#include <QNodeViewEventRecorder.h>
+
+namespace
+{
+    const quint32 s_recordingMagic = 0x514E5652; // "QNVR"
+    const qint32 s_recordingVersion = 1;
+}
+
+bool QNodeViewEventRecording::save(const QString& fileName, QString* errorString) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        if (errorString)
+            *errorString = file.errorString();
+
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << s_recordingMagic << s_recordingVersion;
+    stream << viewportSize << transform << sceneRect << scrollPosition;
+    stream << qint32(events.size());
+
+    Q_FOREACH (const QNodeViewRecordedEvent& event, events)
+    {
+        stream << event.time << event.type << event.position;
+        stream << event.button << event.buttons << event.modifiers << event.data;
+    }
+
+    return true;
+}
+
+bool QNodeViewEventRecording::load(const QString& fileName, QString* errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (errorString)
+            *errorString = file.errorString();
+
+        return false;
+    }
+
+    QDataStream stream(&file);
+
+    quint32 magic;
+    qint32 version;
+    stream >> magic >> version;
+
+    if (magic != s_recordingMagic || version != s_recordingVersion)
+    {
+        if (errorString)
+            *errorString = QObject::tr("Not a supported event recording");
+
+        return false;
+    }
+
+    qint32 count;
+    stream >> viewportSize >> transform >> sceneRect >> scrollPosition;
+    stream >> count;
+
+    if (stream.status() != QDataStream::Ok || count < 0)
+    {
+        if (errorString)
+            *errorString = QObject::tr("Truncated event recording");
+
+        return false;
+    }
+
+    events.resize(count);
+
+    for (qint32 index = 0; index < count; ++index)
+    {
+        QNodeViewRecordedEvent& event = events[index];
+        stream >> event.time >> event.type >> event.position;
+        stream >> event.button >> event.buttons >> event.modifiers >> event.data;
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        if (errorString)
+            *errorString = QObject::tr("Truncated event recording");
+
+        return false;
+    }
+
+    return true;
+}
+
+QNodeViewEventRecorder::QNodeViewEventRecorder(QObject* parent)
+: QObject(parent)
+{
+}
+
+void QNodeViewEventRecorder::start(QGraphicsView* view)
+{
+    stop();
+
+    m_recording = QNodeViewEventRecording();
+    m_recording.viewportSize = view->viewport()->size();
+    m_recording.transform = view->transform();
+    m_recording.sceneRect = view->sceneRect();
+    m_recording.scrollPosition = QPoint(view->horizontalScrollBar()->value(), view->verticalScrollBar()->value());
+
+    // Mouse input arrives on the viewport, keys on the view itself
+    m_view = view;
+    view->viewport()->installEventFilter(this);
+    view->installEventFilter(this);
+
+    m_clock.start();
+}
+
+void QNodeViewEventRecorder::stop()
+{
+    if (m_view.isNull())
+        return;
+
+    m_view->viewport()->removeEventFilter(this);
+    m_view->removeEventFilter(this);
+    m_view = NULL;
+}
+
+bool QNodeViewEventRecorder::eventFilter(QObject* object, QEvent* event)
+{
+    QNodeViewRecordedEvent record;
+    record.time = m_clock.nsecsElapsed();
+    record.type = event->type();
+    record.button = Qt::NoButton;
+    record.buttons = Qt::NoButton;
+    record.modifiers = Qt::NoModifier;
+    record.data = 0;
+
+    switch (event->type())
+    {
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseButtonRelease:
+        case QEvent::MouseButtonDblClick:
+        case QEvent::MouseMove:
+        {
+            if (object != m_view->viewport())
+                return false;
+
+            QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
+            record.position = mouseEvent->localPos();
+            record.button = mouseEvent->button();
+            record.buttons = mouseEvent->buttons();
+            record.modifiers = mouseEvent->modifiers();
+            break;
+        }
+
+        case QEvent::Wheel:
+        {
+            if (object != m_view->viewport())
+                return false;
+
+            QWheelEvent* wheelEvent = static_cast<QWheelEvent*>(event);
+            record.position = wheelEvent->posF();
+            record.buttons = wheelEvent->buttons();
+            record.modifiers = wheelEvent->modifiers();
+            record.data = wheelEvent->angleDelta().y();
+            break;
+        }
+
+        case QEvent::KeyPress:
+        case QEvent::KeyRelease:
+        {
+            QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
+            if (object != m_view || keyEvent->isAutoRepeat())
+                return false;
+
+            record.modifiers = keyEvent->modifiers();
+            record.data = keyEvent->key();
+            break;
+        }
+
+        default:
+            return false;
+    }
+
+    m_recording.events.append(record);
+    return false;
+}
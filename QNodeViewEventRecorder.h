@@ -0,0 +1,86 @@
+/*!
+  @file    QNodeViewEventRecorder.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QTransform>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include <QSize>
+
+class QEvent;
+class QGraphicsView;
+
+struct QNodeViewRecordedEvent
+{
+    qint64 time;        // Nanoseconds since recording started
+    qint32 type;        // QEvent::Type
+    QPointF position;   // Viewport coordinates
+    qint32 button;
+    qint32 buttons;
+    qint32 modifiers;
+    qint32 data;        // Wheel angle delta or key code
+};
+
+/*!
+    A recorded interaction session along with the view state it started from,
+    so that it can be replayed against the same graph.
+*/
+struct QNodeViewEventRecording
+{
+    QSize viewportSize;
+    QTransform transform;
+    QRectF sceneRect;
+    QPoint scrollPosition;
+    QVector<QNodeViewRecordedEvent> events;
+
+    bool save(const QString& fileName, QString* errorString = NULL) const;
+    bool load(const QString& fileName, QString* errorString = NULL);
+};
+
+/*!
+    Captures the input a canvas sees: mouse presses, moves, releases and wheel
+    events on the viewport, and the space key that toggles panning.
+*/
+class QNodeViewEventRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QNodeViewEventRecorder(QObject* parent = NULL);
+
+    void start(QGraphicsView* view);
+    void stop();
+    bool isRecording() const { return !m_view.isNull(); }
+
+    const QNodeViewEventRecording& recording() const { return m_recording; }
+
+    bool eventFilter(QObject* object, QEvent* event);
+
+private:
+    QPointer<QGraphicsView> m_view;
+    QElapsedTimer m_clock;
+    QNodeViewEventRecording m_recording;
+};
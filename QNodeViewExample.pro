@@ -0,0 +1,39 @@
+#/*!  @file    QNodeViewExample.pro
+#
+#  Copyright (c) 2014 Graham Wihlidal
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+#  @author  Graham Wihlidal
+#  @date    January 19, 2014
+#*/
+
+TARGET = QNodeView
+TEMPLATE = app
+
+CONFIG += c++11
+QT += core gui widgets concurrent
+
+qnodeview_tracing: DEFINES += QNODEVIEW_TRACING
+
+LIBS += -L$$OUT_PWD -lQNodeViewWidgets -lQNodeViewCore
+
+win32-msvc*: PRE_TARGETDEPS += $$OUT_PWD/QNodeViewWidgets.lib $$OUT_PWD/QNodeViewCore.lib
+else: PRE_TARGETDEPS += $$OUT_PWD/libQNodeViewWidgets.a $$OUT_PWD/libQNodeViewCore.a
+
+SOURCES +=  \
+            Example.cpp
+
+HEADERS  += \
+            Example.h \
+            ExampleTypes.h
@@ -0,0 +1,430 @@
+/*!
+  @file    QNodeViewFocus.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QTimer>
+
+#include <QNodeViewFocus.h>
+#include <QNodeViewBlock.h>
+#include <QNodeViewConnection.h>
+#include <QNodeViewPort.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewTrace.h>
+
+// GW-TODO: Expose to QStyle
+static const qreal s_dimOpacity = 0.15;
+
+QNodeViewFocus::QNodeViewFocus(QObject* parent)
+: QObject(parent)
+, m_scene(NULL)
+, m_root(NULL)
+, m_hops(1)
+, m_mode(QNodeViewFocus_Dim)
+, m_enabled(false)
+, m_applied(false)
+, m_refreshPending(false)
+{
+    m_downstream.downstream = true;
+}
+
+QNodeViewFocus::~QNodeViewFocus()
+{
+}
+
+void QNodeViewFocus::install(QNodeViewScene* scene)
+{
+    Q_ASSERT(m_scene == NULL);
+
+    m_scene = scene;
+
+    connect(scene, SIGNAL(selectionChanged()), this, SLOT(selectionChanged()));
+    connect(scene, SIGNAL(nodeItemAdded(QGraphicsItem*)), this, SLOT(itemAdded(QGraphicsItem*)));
+    connect(scene, SIGNAL(nodeItemRemoved(QGraphicsItem*)), this, SLOT(itemRemoved(QGraphicsItem*)));
+}
+
+void QNodeViewFocus::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+
+    m_enabled = enabled;
+
+    if (m_enabled)
+        selectionChanged();
+
+    restart();
+}
+
+void QNodeViewFocus::setMode(qint32 mode)
+{
+    if (m_mode == mode)
+        return;
+
+    m_mode = mode;
+
+    // Every hidden item changes, so this is a full pass
+    if (m_applied)
+        applyAll();
+}
+
+void QNodeViewFocus::setHops(qint32 hops)
+{
+    hops = qMax(0, hops);
+
+    if (m_hops == hops)
+        return;
+
+    // Pending edits may have left deleted blocks in the walks
+    if (m_refreshPending)
+        refresh();
+
+    m_hops = hops;
+
+    if (!isActive())
+        return;
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewFocus::setHops");
+
+    trim(m_upstream);
+    trim(m_downstream);
+    extend(m_upstream);
+    extend(m_downstream);
+
+    apply(neighborhood());
+}
+
+void QNodeViewFocus::setBlock(QNodeViewBlock* block)
+{
+    if (m_root == block)
+        return;
+
+    m_root = block;
+    restart();
+}
+
+void QNodeViewFocus::selectionChanged()
+{
+    if (!m_enabled || !m_scene)
+        return;
+
+    const QList<QGraphicsItem*> selection = m_scene->selectedItems();
+
+    if (selection.isEmpty())
+    {
+        setBlock(NULL);
+        return;
+    }
+
+    // Multiple selections keep the current focus, e.g. while rubber banding inside it
+    if (selection.size() == 1 && (selection.first()->type() == QNodeViewType_Block || selection.first()->type() == QNodeViewType_Group))
+        setBlock(static_cast<QNodeViewBlock*>(selection.first()));
+}
+
+void QNodeViewFocus::itemAdded(QGraphicsItem* item)
+{
+    if (!m_applied)
+        return;
+
+    // New items start hidden, the rebuild reveals the ones that turn out to be in focus
+    item->setOpacity(itemOpacity(item));
+    scheduleRefresh();
+}
+
+void QNodeViewFocus::itemRemoved(QGraphicsItem* item)
+{
+    if (item->type() == QNodeViewType_Block || item->type() == QNodeViewType_Group)
+    {
+        QNodeViewBlock* block = static_cast<QNodeViewBlock*>(item);
+
+        if (block == m_root)
+            m_root = NULL;
+
+        m_focused.remove(block);
+        m_upstream.distance.remove(block);
+        m_downstream.distance.remove(block);
+    }
+
+    if (m_applied)
+        scheduleRefresh();
+}
+
+void QNodeViewFocus::refresh()
+{
+    if (!m_refreshPending)
+        return;
+
+    m_refreshPending = false;
+
+    if (!isActive())
+    {
+        restart();
+        return;
+    }
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewFocus::refresh");
+
+    const QSet<QNodeViewBlock*> previous = m_focused;
+
+    m_upstream.levels.clear();
+    m_upstream.distance.clear();
+    m_downstream.levels.clear();
+    m_downstream.distance.clear();
+
+    extend(m_upstream);
+    extend(m_downstream);
+
+    apply(neighborhood());
+
+    // Connections edited between focused blocks may not have changed any block's state
+    Q_FOREACH (QNodeViewBlock* block, previous | m_focused)
+        updateConnections(block);
+}
+
+void QNodeViewFocus::restart()
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewFocus::restart");
+
+    m_refreshPending = false;
+
+    m_upstream.levels.clear();
+    m_upstream.distance.clear();
+    m_downstream.levels.clear();
+    m_downstream.distance.clear();
+
+    if (isActive())
+    {
+        extend(m_upstream);
+        extend(m_downstream);
+    }
+
+    const QSet<QNodeViewBlock*> focused = neighborhood();
+
+    if (isActive() != m_applied)
+    {
+        m_focused = focused;
+        m_applied = isActive();
+        applyAll();
+    }
+    else if (m_applied)
+    {
+        apply(focused);
+    }
+}
+
+void QNodeViewFocus::extend(Walk& walk)
+{
+    if (walk.levels.isEmpty())
+    {
+        walk.levels.append(QVector<QNodeViewBlock*>() << m_root);
+        walk.distance.insert(m_root, 0);
+    }
+
+    while (walk.levels.size() <= m_hops && !walk.levels.last().isEmpty())
+    {
+        const qint32 distance = walk.levels.size();
+        QVector<QNodeViewBlock*> next;
+
+        Q_FOREACH (QNodeViewBlock* block, walk.levels.last())
+        {
+            Q_FOREACH (QNodeViewPort* port, block->ports())
+            {
+                // Downstream leaves through outputs, upstream through inputs
+                if (port->isOutput() != walk.downstream)
+                    continue;
+
+                Q_FOREACH (QNodeViewPort* other, connectedPorts(port))
+                {
+                    // Blocks hidden in a collapsed group are reached through the group
+                    QNodeViewBlock* neighbor = other->anchor()->block();
+
+                    if (!neighbor || walk.distance.contains(neighbor))
+                        continue;
+
+                    walk.distance.insert(neighbor, distance);
+                    next.append(neighbor);
+                }
+            }
+        }
+
+        walk.levels.append(next);
+    }
+}
+
+void QNodeViewFocus::trim(Walk& walk)
+{
+    while (walk.levels.size() > m_hops + 1)
+    {
+        Q_FOREACH (QNodeViewBlock* block, walk.levels.last())
+            walk.distance.remove(block);
+
+        walk.levels.removeLast();
+    }
+}
+
+void QNodeViewFocus::scheduleRefresh()
+{
+    if (m_refreshPending)
+        return;
+
+    m_refreshPending = true;
+    QTimer::singleShot(0, this, SLOT(refresh()));
+}
+
+QSet<QNodeViewBlock*> QNodeViewFocus::neighborhood() const
+{
+    QSet<QNodeViewBlock*> focused;
+
+    for (QHash<QNodeViewBlock*, qint32>::const_iterator entry = m_upstream.distance.constBegin(); entry != m_upstream.distance.constEnd(); ++entry)
+        focused.insert(entry.key());
+
+    for (QHash<QNodeViewBlock*, qint32>::const_iterator entry = m_downstream.distance.constBegin(); entry != m_downstream.distance.constEnd(); ++entry)
+        focused.insert(entry.key());
+
+    return focused;
+}
+
+void QNodeViewFocus::apply(const QSet<QNodeViewBlock*>& focused)
+{
+    QSet<QNodeViewBlock*> changed = m_focused;
+    changed.unite(focused);
+    changed.subtract(m_focused & focused);
+
+    m_focused = focused;
+
+    Q_FOREACH (QNodeViewBlock* block, changed)
+    {
+        block->setOpacity(itemOpacity(block));
+        updateConnections(block);
+    }
+}
+
+void QNodeViewFocus::applyAll()
+{
+    if (!m_scene)
+        return;
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewFocus::applyAll");
+
+    Q_FOREACH (QGraphicsItem* item, m_scene->items())
+    {
+        switch (item->type())
+        {
+            case QNodeViewType_Block:
+            case QNodeViewType_Group:
+            case QNodeViewType_Connection:
+            case QNodeViewType_ConnectionSplit:
+            {
+                const qreal opacity = itemOpacity(item);
+                if (item->opacity() != opacity)
+                    item->setOpacity(opacity);
+
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+}
+
+qreal QNodeViewFocus::hiddenOpacity() const
+{
+    return (m_mode == QNodeViewFocus_Cull) ? 0.0 : s_dimOpacity;
+}
+
+qreal QNodeViewFocus::itemOpacity(QGraphicsItem* item) const
+{
+    if (!m_applied)
+        return 1.0;
+
+    switch (item->type())
+    {
+        case QNodeViewType_Block:
+        case QNodeViewType_Group:
+            return m_focused.contains(static_cast<QNodeViewBlock*>(item)) ? 1.0 : hiddenOpacity();
+
+        case QNodeViewType_Connection:
+        {
+            // Shown only when both ends are, wires out of the neighborhood lead nowhere visible
+            const QNodeViewConnection* connection = static_cast<QNodeViewConnection*>(item);
+            if (!connection->startPort() || !connection->endPort())
+                return hiddenOpacity();
+
+            const bool shown = m_focused.contains(connection->startPort()->anchor()->block()) &&
+                               m_focused.contains(connection->endPort()->anchor()->block());
+
+            return shown ? 1.0 : hiddenOpacity();
+        }
+
+        case QNodeViewType_ConnectionSplit:
+            return itemOpacity(static_cast<QNodeViewConnectionSplit*>(item)->connection());
+
+        default:
+            return 1.0;
+    }
+}
+
+void QNodeViewFocus::updateConnections(QNodeViewBlock* block)
+{
+    Q_FOREACH (QNodeViewPort* port, block->ports())
+    {
+        QVector<QNodeViewConnection*> connections = port->connections();
+
+        Q_FOREACH (QNodeViewPort* proxied, port->proxiedPorts())
+            connections += proxied->connections();
+
+        Q_FOREACH (QNodeViewConnection* connection, connections)
+        {
+            const qreal opacity = itemOpacity(connection);
+            if (connection->opacity() == opacity)
+                continue;
+
+            connection->setOpacity(opacity);
+
+            Q_FOREACH (QNodeViewConnectionSplit* split, connection->splits())
+                split->setOpacity(opacity);
+        }
+    }
+}
+
+QVector<QNodeViewPort*> QNodeViewFocus::connectedPorts(QNodeViewPort* port)
+{
+    QVector<QNodeViewConnection*> connections = port->connections();
+
+    // A group's proxy port carries the connections of the member ports behind it
+    Q_FOREACH (QNodeViewPort* proxied, port->proxiedPorts())
+        connections += proxied->connections();
+
+    QVector<QNodeViewPort*> ports;
+    ports.reserve(connections.size());
+
+    Q_FOREACH (QNodeViewConnection* connection, connections)
+    {
+        QNodeViewPort* start = connection->startPort();
+        QNodeViewPort* end = connection->endPort();
+
+        if (!start || !end)
+            continue;
+
+        ports.append((start == port || start->proxy() == port) ? end : start);
+    }
+
+    return ports;
+}
@@ -0,0 +1,122 @@
+/*!
+  @file    QNodeViewFocus.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QVector>
+
+class QGraphicsItem;
+class QNodeViewBlock;
+class QNodeViewPort;
+class QNodeViewScene;
+
+enum QNodeViewFocusMode
+{
+    QNodeViewFocus_Dim,
+    QNodeViewFocus_Cull
+};
+
+/*!
+    Focus mode, showing only the neighborhood of one block.
+
+    The neighborhood is every block within a number of hops upstream or
+    downstream of the focused block, found by a breadth first walk over port
+    connections. Everything outside it is dimmed, or made fully transparent,
+    which Qt skips while painting and QNodeViewScene skips while hit testing.
+
+    Each walk keeps its levels, so raising the hop count only walks the new
+    levels and lowering it drops levels, and only items whose state changed
+    are touched. Edits to the graph are batched into one rebuild per event
+    loop pass.
+*/
+class QNodeViewFocus : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QNodeViewFocus(QObject* parent = NULL);
+    virtual ~QNodeViewFocus();
+
+    void install(QNodeViewScene* scene);
+
+    // While enabled the focus follows the selection, a single selected block becomes the focused one
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    void setMode(qint32 mode);
+    qint32 mode() const { return m_mode; }
+
+    void setHops(qint32 hops);
+    qint32 hops() const { return m_hops; }
+
+    void setBlock(QNodeViewBlock* block);
+    QNodeViewBlock* block() const { return m_root; }
+
+    bool isActive() const { return m_enabled && m_root; }
+    bool contains(QNodeViewBlock* block) const { return m_focused.contains(block); }
+    qint32 focusedCount() const { return m_focused.size(); }
+
+private slots:
+    void selectionChanged();
+    void itemAdded(QGraphicsItem* item);
+    void itemRemoved(QGraphicsItem* item);
+    void refresh();
+
+private:
+    struct Walk
+    {
+        Walk() : downstream(false) {}
+
+        bool downstream;
+        QVector<QVector<QNodeViewBlock*> > levels;
+        QHash<QNodeViewBlock*, qint32> distance;
+    };
+
+    void restart();
+    void extend(Walk& walk);
+    void trim(Walk& walk);
+    void scheduleRefresh();
+
+    QSet<QNodeViewBlock*> neighborhood() const;
+    void apply(const QSet<QNodeViewBlock*>& focused);
+    void applyAll();
+
+    qreal hiddenOpacity() const;
+    qreal itemOpacity(QGraphicsItem* item) const;
+    void updateConnections(QNodeViewBlock* block);
+
+    static QVector<QNodeViewPort*> connectedPorts(QNodeViewPort* port);
+
+private:
+    QNodeViewScene* m_scene;
+    QNodeViewBlock* m_root;
+    Walk m_upstream;
+    Walk m_downstream;
+    QSet<QNodeViewBlock*> m_focused;
+    qint32 m_hops;
+    qint32 m_mode;
+    bool m_enabled;
+    bool m_applied;
+    bool m_refreshPending;
+};
@@ -0,0 +1,769 @@
+/*!
+  @file    QNodeViewGraph.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QSaveFile>
+#include <QSet>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <QNodeViewGraph.h>
+
+namespace
+{
+    bool loadBlock(QDataStream& stream, QNodeViewGraphBlock& block, qint32 version)
+    {
+        stream >> block.position;
+
+        if (version >= 3)
+            stream >> block.nodeType;
+
+        if (version >= 4 && block.nodeType != 0)
+            stream >> block.title;
+
+        qint32 count;
+        stream >> count;
+
+        if (count < 0)
+            return false;
+
+        for (qint32 iter = 0; iter < count && stream.status() == QDataStream::Ok; iter++)
+        {
+            QNodeViewGraphPort port;
+            stream >> port.id;
+
+            if (block.nodeType == 0)
+            {
+                stream >> port.name;
+                stream >> port.isOutput;
+                stream >> port.flags;
+
+                if (version >= 2)
+                    stream >> port.typeId;
+            }
+
+            block.ports.append(port);
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    void saveBlock(QDataStream& stream, const QNodeViewGraphBlock& block, qint32 version)
+    {
+        stream << block.position;
+
+        if (version >= 3)
+            stream << block.nodeType;
+
+        if (version >= 4 && block.nodeType != 0)
+            stream << block.title;
+
+        const qint32 count = block.ports.size();
+        stream << count;
+
+        Q_FOREACH (const QNodeViewGraphPort& port, block.ports)
+        {
+            stream << port.id;
+
+            if (block.nodeType != 0)
+                continue;
+
+            stream << port.name;
+            stream << port.isOutput;
+            stream << port.flags;
+
+            if (version >= 2)
+                stream << port.typeId;
+        }
+    }
+
+    bool loadGroup(QDataStream& stream, QNodeViewGraphGroup& group, qint32 version)
+    {
+        stream >> group.position;
+        stream >> group.name;
+        stream >> group.collapsed;
+
+        qint32 count;
+        stream >> count;
+
+        if (count < 0)
+            return false;
+
+        for (qint32 iter = 0; iter < count && stream.status() == QDataStream::Ok; iter++)
+        {
+            QNodeViewGraphBlock block;
+            if (!loadBlock(stream, block, version))
+                return false;
+
+            group.members.append(block);
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    void saveGroup(QDataStream& stream, const QNodeViewGraphGroup& group, qint32 version)
+    {
+        stream << group.position;
+        stream << group.name;
+        stream << group.collapsed;
+
+        const qint32 count = group.members.size();
+        stream << count;
+
+        Q_FOREACH (const QNodeViewGraphBlock& block, group.members)
+            saveBlock(stream, block, version);
+    }
+
+    bool loadConnection(QDataStream& stream, QNodeViewGraphConnection& connection)
+    {
+        stream >> connection.startPort;
+        stream >> connection.endPort;
+
+        qint32 splitCount;
+        stream >> splitCount;
+
+        if (splitCount < 0)
+            return false;
+
+        for (qint32 splitIndex = 0; splitIndex < splitCount && stream.status() == QDataStream::Ok; splitIndex++)
+        {
+            QPointF splitPosition;
+            stream >> splitPosition;
+            connection.splits.append(splitPosition);
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    void saveConnection(QDataStream& stream, const QNodeViewGraphConnection& connection)
+    {
+        stream << connection.startPort;
+        stream << connection.endPort;
+
+        const qint32 splitCount = connection.splits.size();
+        stream << splitCount;
+
+        Q_FOREACH (const QPointF& splitPosition, connection.splits)
+            stream << splitPosition;
+    }
+
+    // Records per chunk, small enough to spread a large graph over all cores
+    const qint32 s_chunkRecords = 2048;
+
+    struct ChunkRange
+    {
+        ChunkRange() : graph(NULL), recordType(0), begin(0), end(0), version(0) {}
+        ChunkRange(const QNodeViewGraph* graph, qint32 recordType, qint32 begin, qint32 end, qint32 version)
+        : graph(graph), recordType(recordType), begin(begin), end(end), version(version) {}
+
+        const QNodeViewGraph* graph;
+        qint32 recordType;
+        qint32 begin;
+        qint32 end;
+        qint32 version;
+    };
+
+    struct RawChunk
+    {
+        QNodeViewGraphChunk chunk;
+        QByteArray data;
+        qint32 version;
+    };
+
+    struct DecodedChunk
+    {
+        QVector<QNodeViewGraphBlock> blocks;
+        QVector<QNodeViewGraphGroup> groups;
+        QVector<QNodeViewGraphConnection> connections;
+        QString error;
+    };
+
+    bool fail(QString* errorString, const QString& message)
+    {
+        if (errorString)
+            *errorString = message;
+
+        return false;
+    }
+
+    // Older formats have no way to describe a typed block's ports or its own title
+    bool canSaveBlock(const QNodeViewGraphBlock& block, qint32 saveVersion, QString* errorString)
+    {
+        if (saveVersion < 3 && block.nodeType != 0)
+            return fail(errorString, QString("node types need file version 3"));
+
+        if (saveVersion < 4 && !block.title.isEmpty())
+            return fail(errorString, QString("block titles need file version 4"));
+
+        return true;
+    }
+
+    QByteArray encodeChunk(const ChunkRange& range)
+    {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+
+        for (qint32 index = range.begin; index < range.end; ++index)
+        {
+            if (range.recordType == QNodeViewRecord_Block)
+                saveBlock(stream, range.graph->blocks[index], range.version);
+            else if (range.recordType == QNodeViewRecord_Group)
+                saveGroup(stream, range.graph->groups[index], range.version);
+            else
+                saveConnection(stream, range.graph->connections[index]);
+        }
+
+        return qCompress(data);
+    }
+
+    DecodedChunk decodeChunk(const RawChunk& rawChunk)
+    {
+        DecodedChunk result;
+
+        const QByteArray data = qUncompress(rawChunk.data);
+        if (data.isEmpty() && rawChunk.chunk.recordCount > 0)
+        {
+            result.error = "corrupt compressed chunk";
+            return result;
+        }
+
+        QDataStream stream(data);
+        bool valid = true;
+
+        for (qint32 index = 0; index < rawChunk.chunk.recordCount && valid; ++index)
+        {
+            if (rawChunk.chunk.recordType == QNodeViewRecord_Block)
+            {
+                result.blocks.append(QNodeViewGraphBlock());
+                valid = loadBlock(stream, result.blocks.last(), rawChunk.version);
+            }
+            else if (rawChunk.chunk.recordType == QNodeViewRecord_Group)
+            {
+                result.groups.append(QNodeViewGraphGroup());
+                valid = loadGroup(stream, result.groups.last(), rawChunk.version);
+            }
+            else if (rawChunk.chunk.recordType == QNodeViewRecord_Connection)
+            {
+                result.connections.append(QNodeViewGraphConnection());
+                valid = loadConnection(stream, result.connections.last());
+            }
+            else
+            {
+                result.error = QString("unknown record type %1").arg(rawChunk.chunk.recordType);
+                return result;
+            }
+        }
+
+        if (!valid)
+            result.error = "truncated or corrupt chunk";
+
+        return result;
+    }
+}
+
+QNodeViewGraph::QNodeViewGraph()
+: version(QNodeViewFile_Version)
+{
+}
+
+void QNodeViewGraph::clear()
+{
+    blocks.clear();
+    groups.clear();
+    connections.clear();
+    portTypes.clear();
+    nodeTypes.clear();
+    version = QNodeViewFile_Version;
+}
+
+bool QNodeViewGraph::load(QDataStream& stream, QString* errorString)
+{
+    clear();
+
+    qint32 type = 0;
+    bool pendingType = false;
+
+    if (stream.atEnd())
+        return true;
+
+    stream >> type;
+
+    if (type == QNodeViewFile_Magic)
+    {
+        stream >> version;
+
+        if (version < 2 || version > QNodeViewFile_Version)
+            return fail(errorString, QString("unsupported file version %1").arg(version));
+
+        stream >> portTypes;
+
+        if (version >= 3)
+            stream >> nodeTypes;
+    }
+    else
+    {
+        // Files written before the header start directly with a record
+        version = 1;
+        pendingType = true;
+    }
+
+    while (pendingType || !stream.atEnd())
+    {
+        if (!pendingType)
+            stream >> type;
+
+        pendingType = false;
+
+        bool valid = false;
+
+        if (type == QNodeViewRecord_Block)
+        {
+            blocks.append(QNodeViewGraphBlock());
+            valid = loadBlock(stream, blocks.last(), version);
+        }
+        else if (type == QNodeViewRecord_Group)
+        {
+            groups.append(QNodeViewGraphGroup());
+            valid = loadGroup(stream, groups.last(), version);
+        }
+        else if (type == QNodeViewRecord_Connection)
+        {
+            connections.append(QNodeViewGraphConnection());
+            valid = loadConnection(stream, connections.last());
+        }
+        else
+        {
+            return fail(errorString, QString("unknown record type %1").arg(type));
+        }
+
+        if (!valid)
+            return fail(errorString, "truncated or corrupt record");
+    }
+
+    return true;
+}
+
+bool QNodeViewGraph::save(QDataStream& stream, qint32 saveVersion, QString* errorString) const
+{
+    if (!canSave(saveVersion, errorString))
+        return false;
+
+    if (saveVersion >= 2)
+    {
+        stream << static_cast<qint32>(QNodeViewFile_Magic);
+        stream << saveVersion;
+        stream << portTypes;
+
+        if (saveVersion >= 3)
+            stream << nodeTypes;
+    }
+
+    Q_FOREACH (const QNodeViewGraphBlock& block, blocks)
+    {
+        stream << static_cast<qint32>(QNodeViewRecord_Block);
+        saveBlock(stream, block, saveVersion);
+    }
+
+    Q_FOREACH (const QNodeViewGraphGroup& group, groups)
+    {
+        stream << static_cast<qint32>(QNodeViewRecord_Group);
+        saveGroup(stream, group, saveVersion);
+    }
+
+    Q_FOREACH (const QNodeViewGraphConnection& connection, connections)
+    {
+        stream << static_cast<qint32>(QNodeViewRecord_Connection);
+        saveConnection(stream, connection);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+        return fail(errorString, "write failed");
+
+    return true;
+}
+
+bool QNodeViewGraph::canSave(qint32 saveVersion, QString* errorString) const
+{
+    if (saveVersion < 1 || saveVersion > QNodeViewFile_Version)
+        return fail(errorString, QString("unsupported file version %1").arg(saveVersion));
+
+    if (saveVersion >= QNodeViewFile_Version)
+        return true;
+
+    Q_FOREACH (const QNodeViewGraphBlock& block, blocks)
+    {
+        if (!canSaveBlock(block, saveVersion, errorString))
+            return false;
+    }
+
+    Q_FOREACH (const QNodeViewGraphGroup& group, groups)
+    {
+        Q_FOREACH (const QNodeViewGraphBlock& block, group.members)
+        {
+            if (!canSaveBlock(block, saveVersion, errorString))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+QStringList QNodeViewGraph::validate() const
+{
+    QStringList problems;
+
+    struct PortInfo
+    {
+        qint32 block;
+        bool typed;
+        bool isOutput;
+    };
+
+    QHash<quint64, PortInfo> ports;
+    qint32 blockIndex = 0;
+
+    QVector<const QNodeViewGraphBlock*> allBlocks;
+    Q_FOREACH (const QNodeViewGraphBlock& block, blocks)
+        allBlocks.append(&block);
+
+    Q_FOREACH (const QNodeViewGraphGroup& group, groups)
+    {
+        if (group.members.isEmpty())
+            problems.append(QString("group '%1' has no members").arg(group.name));
+
+        Q_FOREACH (const QNodeViewGraphBlock& block, group.members)
+            allBlocks.append(&block);
+    }
+
+    Q_FOREACH (const QNodeViewGraphBlock* block, allBlocks)
+    {
+        if (block->nodeType != 0 && block->nodeType >= nodeTypes.size())
+            problems.append(QString("block %1 has unknown node type %2").arg(blockIndex).arg(block->nodeType));
+
+        Q_FOREACH (const QNodeViewGraphPort& port, block->ports)
+        {
+            if (ports.contains(port.id))
+                problems.append(QString("port id %1 is used more than once").arg(port.id));
+
+            if (version >= 2 && port.typeId >= portTypes.size())
+                problems.append(QString("port '%1' has unknown type %2").arg(port.name).arg(port.typeId));
+
+            PortInfo info = { blockIndex, block->nodeType != 0, port.isOutput };
+            ports.insert(port.id, info);
+        }
+
+        ++blockIndex;
+    }
+
+    QSet<QPair<quint64, quint64> > links;
+
+    Q_FOREACH (const QNodeViewGraphConnection& connection, connections)
+    {
+        const QString name = QString("connection %1 -> %2").arg(connection.startPort).arg(connection.endPort);
+
+        if (!ports.contains(connection.startPort) || !ports.contains(connection.endPort))
+        {
+            problems.append(name + " references a missing port");
+            continue;
+        }
+
+        const PortInfo start = ports.value(connection.startPort);
+        const PortInfo end = ports.value(connection.endPort);
+
+        if (start.block == end.block)
+            problems.append(name + " connects a block to itself");
+
+        // Directions of typed ports are only known to the node type
+        if (!start.typed && !end.typed && start.isOutput == end.isOutput)
+            problems.append(name + " connects two ports of the same direction");
+
+        const QPair<quint64, quint64> link(qMin(connection.startPort, connection.endPort), qMax(connection.startPort, connection.endPort));
+        if (links.contains(link))
+            problems.append(name + " is duplicated");
+
+        links.insert(link);
+    }
+
+    return problems;
+}
+
+QNodeViewGraphStatistics QNodeViewGraph::statistics() const
+{
+    QNodeViewGraphStatistics result;
+
+    result.blocks = blocks.size();
+    result.groups = groups.size();
+    result.connections = connections.size();
+
+    Q_FOREACH (const QNodeViewGraphBlock& block, blocks)
+        result.ports += block.ports.size();
+
+    Q_FOREACH (const QNodeViewGraphGroup& group, groups)
+    {
+        result.blocks += group.members.size();
+
+        Q_FOREACH (const QNodeViewGraphBlock& block, group.members)
+            result.ports += block.ports.size();
+    }
+
+    Q_FOREACH (const QNodeViewGraphConnection& connection, connections)
+        result.splits += connection.splits.size();
+
+    return result;
+}
+
+bool QNodeViewGraph::loadFile(const QString& fileName, QString* errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return fail(errorString, file.errorString());
+
+    const QByteArray header = file.peek(sizeof(qint32));
+    const qint32 magic = header.size() == sizeof(qint32) ? qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(header.constData())) : 0;
+
+    if (magic == QNodeViewFile_ChunkedMagic)
+        return loadChunks(file, QVector<qint32>(), errorString);
+
+    // Compressed files from before chunking hold the whole graph in one stream
+    if (magic == QNodeViewFile_CompressedMagic)
+    {
+        QDataStream stream(&file);
+        stream.skipRawData(sizeof(qint32));
+
+        QByteArray compressed;
+        stream >> compressed;
+
+        const QByteArray data = qUncompress(compressed);
+        if (data.isEmpty())
+            return fail(errorString, "corrupt compressed data");
+
+        QDataStream dataStream(data);
+        return load(dataStream, errorString);
+    }
+
+    // Binary files start with the magic, so a leading brace can only be JSON
+    const QByteArray start = file.peek(64).trimmed();
+    if (start.startsWith('{'))
+        return loadJson(file.readAll(), errorString);
+
+    QDataStream stream(&file);
+    return load(stream, errorString);
+}
+
+bool QNodeViewGraph::loadFile(const QString& fileName, const QVector<qint32>& chunks, QString* errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return fail(errorString, file.errorString());
+
+    return loadChunks(file, chunks, errorString);
+}
+
+bool QNodeViewGraph::saveFile(const QString& fileName, qint32 saveVersion, bool compressed, QString* errorString) const
+{
+    QSaveFile file(fileName);
+    if (!file.open(QFile::WriteOnly))
+        return fail(errorString, file.errorString());
+
+    if (fileName.endsWith(".json", Qt::CaseInsensitive))
+    {
+        if (!saveJson(file, saveVersion, errorString))
+            return false;
+    }
+    else if (compressed)
+    {
+        if (!saveChunks(file, saveVersion, errorString))
+            return false;
+    }
+    else
+    {
+        QDataStream stream(&file);
+        if (!save(stream, saveVersion, errorString))
+            return false;
+    }
+
+    if (!file.commit())
+        return fail(errorString, file.errorString());
+
+    return true;
+}
+
+bool QNodeViewGraph::readChunkIndex(const QString& fileName, QVector<QNodeViewGraphChunk>& index, QString* errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return fail(errorString, file.errorString());
+
+    QDataStream stream(&file);
+    QNodeViewGraph header;
+    qint64 payloadStart;
+
+    return header.loadChunkHeader(stream, index, payloadStart, errorString);
+}
+
+bool QNodeViewGraph::loadChunkHeader(QDataStream& stream, QVector<QNodeViewGraphChunk>& index, qint64& payloadStart, QString* errorString)
+{
+    clear();
+
+    qint32 magic;
+    stream >> magic;
+
+    if (magic != QNodeViewFile_ChunkedMagic)
+        return fail(errorString, "not a chunked graph file");
+
+    stream >> version;
+
+    if (version < 1 || version > QNodeViewFile_Version)
+        return fail(errorString, QString("unsupported file version %1").arg(version));
+
+    stream >> portTypes;
+    stream >> nodeTypes;
+
+    qint32 chunkCount;
+    stream >> chunkCount;
+
+    if (chunkCount < 0)
+        return fail(errorString, "corrupt chunk index");
+
+    index.clear();
+
+    for (qint32 chunkIndex = 0; chunkIndex < chunkCount && stream.status() == QDataStream::Ok; ++chunkIndex)
+    {
+        QNodeViewGraphChunk chunk;
+        stream >> chunk.recordType;
+        stream >> chunk.recordCount;
+        stream >> chunk.offset;
+        stream >> chunk.size;
+        index.append(chunk);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+        return fail(errorString, "truncated chunk index");
+
+    payloadStart = stream.device()->pos();
+    return true;
+}
+
+bool QNodeViewGraph::loadChunks(QIODevice& device, const QVector<qint32>& selection, QString* errorString)
+{
+    QDataStream stream(&device);
+
+    QVector<QNodeViewGraphChunk> index;
+    qint64 payloadStart;
+
+    if (!loadChunkHeader(stream, index, payloadStart, errorString))
+        return false;
+
+    QVector<qint32> chunkIndices = selection;
+    if (chunkIndices.isEmpty())
+    {
+        for (qint32 chunkIndex = 0; chunkIndex < index.size(); ++chunkIndex)
+            chunkIndices.append(chunkIndex);
+    }
+
+    // Reading stays on this thread, decompressing and parsing scale across cores
+    QVector<RawChunk> rawChunks;
+    rawChunks.reserve(chunkIndices.size());
+
+    Q_FOREACH (qint32 chunkIndex, chunkIndices)
+    {
+        if (chunkIndex < 0 || chunkIndex >= index.size())
+            return fail(errorString, QString("chunk %1 out of range").arg(chunkIndex));
+
+        const QNodeViewGraphChunk& chunk = index[chunkIndex];
+
+        RawChunk rawChunk;
+        rawChunk.chunk = chunk;
+        rawChunk.version = version;
+
+        if (!device.seek(payloadStart + chunk.offset))
+            return fail(errorString, device.errorString());
+
+        rawChunk.data = device.read(chunk.size);
+        if (rawChunk.data.size() != chunk.size)
+            return fail(errorString, "truncated chunk data");
+
+        rawChunks.append(rawChunk);
+    }
+
+    const QVector<DecodedChunk> decoded = QtConcurrent::blockingMapped<QVector<DecodedChunk> >(rawChunks, decodeChunk);
+
+    Q_FOREACH (const DecodedChunk& chunk, decoded)
+    {
+        if (!chunk.error.isEmpty())
+            return fail(errorString, chunk.error);
+
+        blocks += chunk.blocks;
+        groups += chunk.groups;
+        connections += chunk.connections;
+    }
+
+    return true;
+}
+
+bool QNodeViewGraph::saveChunks(QIODevice& device, qint32 saveVersion, QString* errorString) const
+{
+    if (!canSave(saveVersion, errorString))
+        return false;
+
+    // Each record type is cut into runs small enough to spread over all cores
+    QVector<ChunkRange> ranges;
+
+    for (qint32 begin = 0; begin < blocks.size(); begin += s_chunkRecords)
+        ranges.append(ChunkRange(this, QNodeViewRecord_Block, begin, qMin(begin + s_chunkRecords, blocks.size()), saveVersion));
+
+    for (qint32 begin = 0; begin < groups.size(); begin += s_chunkRecords)
+        ranges.append(ChunkRange(this, QNodeViewRecord_Group, begin, qMin(begin + s_chunkRecords, groups.size()), saveVersion));
+
+    for (qint32 begin = 0; begin < connections.size(); begin += s_chunkRecords)
+        ranges.append(ChunkRange(this, QNodeViewRecord_Connection, begin, qMin(begin + s_chunkRecords, connections.size()), saveVersion));
+
+    const QVector<QByteArray> encoded = QtConcurrent::blockingMapped<QVector<QByteArray> >(ranges, encodeChunk);
+
+    QDataStream stream(&device);
+    stream << static_cast<qint32>(QNodeViewFile_ChunkedMagic);
+    stream << saveVersion;
+    stream << portTypes;
+    stream << nodeTypes;
+    stream << static_cast<qint32>(ranges.size());
+
+    qint64 offset = 0;
+
+    for (qint32 chunkIndex = 0; chunkIndex < ranges.size(); ++chunkIndex)
+    {
+        stream << ranges[chunkIndex].recordType;
+        stream << static_cast<qint32>(ranges[chunkIndex].end - ranges[chunkIndex].begin);
+        stream << offset;
+        stream << static_cast<qint32>(encoded[chunkIndex].size());
+
+        offset += encoded[chunkIndex].size();
+    }
+
+    Q_FOREACH (const QByteArray& data, encoded)
+        stream.writeRawData(data.constData(), data.size());
+
+    if (stream.status() != QDataStream::Ok)
+        return fail(errorString, device.errorString());
+
+    return true;
+}
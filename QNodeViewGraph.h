@@ -0,0 +1,175 @@
+/*!
+  @file    QNodeViewGraph.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QDataStream>
+#include <QIODevice>
+#include <QPointF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+enum QNodeViewFile
+{
+    QNodeViewFile_Magic             = 0x514E5646, // "QNVF"
+    QNodeViewFile_CompressedMagic   = 0x514E565A, // "QNVZ", single compressed stream, read only
+    QNodeViewFile_ChunkedMagic      = 0x514E5643, // "QNVC"
+    QNodeViewFile_Version           = 4
+};
+
+// Record tags, equal to the QNodeViewType of the item each record describes
+enum QNodeViewRecord
+{
+    QNodeViewRecord_Connection  = 0x10000 + 2,
+    QNodeViewRecord_Block       = 0x10000 + 4,
+    QNodeViewRecord_Group       = 0x10000 + 5
+};
+
+/*!
+    Ports of a typed block only carry their id, the rest comes from the node
+    type when the block is instantiated.
+*/
+struct QNodeViewGraphPort
+{
+    QNodeViewGraphPort() : id(0), isOutput(false), flags(0), typeId(0) {}
+
+    quint64 id;
+    QString name;
+    bool isOutput;
+    qint32 flags;
+    quint16 typeId;
+};
+
+/*!
+    Typed blocks take their title from the node type unless the block
+    overrides it; custom blocks carry theirs in their name port.
+*/
+struct QNodeViewGraphBlock
+{
+    QNodeViewGraphBlock() : nodeType(0) {}
+
+    QPointF position;
+    quint16 nodeType;
+    QString title;
+    QVector<QNodeViewGraphPort> ports;
+};
+
+struct QNodeViewGraphGroup
+{
+    QNodeViewGraphGroup() : collapsed(false) {}
+
+    QPointF position;
+    QString name;
+    bool collapsed;
+    QVector<QNodeViewGraphBlock> members;
+};
+
+struct QNodeViewGraphConnection
+{
+    QNodeViewGraphConnection() : startPort(0), endPort(0) {}
+
+    quint64 startPort;
+    quint64 endPort;
+    QVector<QPointF> splits;
+};
+
+/*!
+    Entry in the index of a chunked file.
+
+    Each chunk is an independently compressed run of records of one type,
+    so chunks can be decompressed in parallel or loaded on their own.
+    Offsets are relative to the end of the index.
+*/
+struct QNodeViewGraphChunk
+{
+    QNodeViewGraphChunk() : recordType(0), recordCount(0), offset(0), size(0) {}
+
+    qint32 recordType;
+    qint32 recordCount;
+    qint64 offset;
+    qint32 size;
+};
+
+struct QNodeViewGraphStatistics
+{
+    QNodeViewGraphStatistics() : blocks(0), groups(0), ports(0), connections(0), splits(0) {}
+
+    qint32 blocks;
+    qint32 groups;
+    qint32 ports;
+    qint32 connections;
+    qint32 splits;
+};
+
+/*!
+    Widget-free model of a saved node graph.
+
+    This is the on-disk format in memory: port and node type ids index the
+    graph's own type tables, not the process wide registries, so graphs can
+    be loaded, checked and rewritten without a scene or a display. All data
+    is held in implicitly shared containers, so copying a graph to hand it
+    to another thread is cheap and later edits never touch the copy.
+*/
+class QNodeViewGraph
+{
+public:
+    QNodeViewGraph();
+
+    void clear();
+
+    bool load(QDataStream& stream, QString* errorString = NULL);
+    bool save(QDataStream& stream, qint32 version = QNodeViewFile_Version, QString* errorString = NULL) const;
+
+    QStringList validate() const;
+    QNodeViewGraphStatistics statistics() const;
+
+    // Compressed files are written chunked, single stream ones from older versions still load
+    // Saving goes through a temporary file that replaces the target on success
+    bool loadFile(const QString& fileName, QString* errorString = NULL);
+    bool saveFile(const QString& fileName, qint32 version = QNodeViewFile_Version, bool compressed = false, QString* errorString = NULL) const;
+
+    // JSON with the same content as the binary format, picked by a ".json" suffix when saving and detected when loading
+    bool loadJson(const QByteArray& data, QString* errorString = NULL);
+    bool saveJson(QIODevice& device, qint32 version = QNodeViewFile_Version, QString* errorString = NULL) const;
+
+    // Random access into chunked files, loading only the listed chunks or all of them if none are listed
+    static bool readChunkIndex(const QString& fileName, QVector<QNodeViewGraphChunk>& index, QString* errorString = NULL);
+    bool loadFile(const QString& fileName, const QVector<qint32>& chunks, QString* errorString = NULL);
+
+public:
+    QVector<QNodeViewGraphBlock> blocks;
+    QVector<QNodeViewGraphGroup> groups;
+    QVector<QNodeViewGraphConnection> connections;
+
+    QStringList portTypes;
+    QStringList nodeTypes;
+
+    // Format version the graph was loaded from
+    qint32 version;
+
+private:
+    bool canSave(qint32 version, QString* errorString) const;
+
+    bool loadChunkHeader(QDataStream& stream, QVector<QNodeViewGraphChunk>& index, qint64& payloadStart, QString* errorString);
+    bool loadChunks(QIODevice& device, const QVector<qint32>& selection, QString* errorString);
+    bool saveChunks(QIODevice& device, qint32 version, QString* errorString) const;
+};
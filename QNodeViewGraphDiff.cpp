@@ -0,0 +1,644 @@
+/*!
+  @file    QNodeViewGraphDiff.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QHash>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+
+#include <QNodeViewGraphDiff.h>
+
+namespace
+{
+    // 4096 buckets keep a single changed item from dirtying more than a sliver of a large graph
+    const qint32 s_bucketBits = 12;
+    const qint32 s_bucketCount = 1 << s_bucketBits;
+
+    // Items hashed per task
+    const qint32 s_hashBatch = 4096;
+
+    const qint32 s_itemKinds = 3;
+
+    // SplitMix64 finalizer
+    inline quint64 mix(quint64 value)
+    {
+        value = (value ^ (value >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+        value = (value ^ (value >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+        return value ^ (value >> 31);
+    }
+
+    class Hasher
+    {
+    public:
+        Hasher() : m_state(Q_UINT64_C(0x9E3779B97F4A7C15)) {}
+
+        void addValue(quint64 value)
+        {
+            m_state = mix(m_state ^ value) + Q_UINT64_C(0x9E3779B97F4A7C15);
+        }
+
+        void addReal(double value)
+        {
+            quint64 bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            addValue(bits);
+        }
+
+        void addString(const QString& value)
+        {
+            const ushort* data = value.utf16();
+            const qint32 size = value.size();
+            addValue(size);
+
+            // Four UTF-16 units per step
+            for (qint32 index = 0; index < size; index += 4)
+            {
+                quint64 word = 0;
+                for (qint32 unit = 0; unit < 4 && index + unit < size; ++unit)
+                    word |= quint64(data[index + unit]) << (16 * unit);
+
+                addValue(word);
+            }
+        }
+
+        quint64 result() const { return mix(m_state); }
+
+    private:
+        quint64 m_state;
+    };
+
+    struct ItemState
+    {
+        quint64 key;
+        quint64 endKey;
+        quint64 content;
+        quint64 position;
+        const QNodeViewGraph* graph;
+        const void* record;
+    };
+
+    typedef QPair<quint64, quint64> ItemKey;
+
+    struct ItemIndex
+    {
+        QVector<QVector<ItemState> > buckets;
+        QVector<quint64> bucketHashes;
+    };
+
+    struct GraphIndex
+    {
+        ItemIndex items[s_itemKinds];
+        quint64 root;
+    };
+
+    // Content and position picked from possibly different sides of a merge
+    struct Pick
+    {
+        const ItemState* content;
+        const ItemState* position;
+    };
+
+    QString portTypeName(const QNodeViewGraph& graph, quint16 typeId)
+    {
+        const QString name = graph.portTypes.value(typeId);
+        return name.isEmpty() ? QString("Any") : name;
+    }
+
+    QString nodeTypeName(const QNodeViewGraph& graph, quint16 nodeType)
+    {
+        return nodeType ? graph.nodeTypes.value(nodeType) : QString();
+    }
+
+    quint64 positionHash(const QPointF& position)
+    {
+        Hasher hasher;
+        hasher.addReal(position.x());
+        hasher.addReal(position.y());
+        return hasher.result();
+    }
+
+    ItemState blockState(const QNodeViewGraph& graph, const QNodeViewGraphBlock& block)
+    {
+        Hasher hasher;
+        hasher.addString(nodeTypeName(graph, block.nodeType));
+        hasher.addString(block.title);
+        hasher.addValue(block.ports.size());
+
+        Q_FOREACH (const QNodeViewGraphPort& port, block.ports)
+        {
+            hasher.addValue(port.id);
+            hasher.addString(port.name);
+            hasher.addValue(port.isOutput);
+            hasher.addValue(port.flags);
+            hasher.addString(portTypeName(graph, port.typeId));
+        }
+
+        ItemState state;
+        state.content = hasher.result();
+        state.position = positionHash(block.position);
+        state.key = block.ports.isEmpty() ? state.content : block.ports.first().id;
+        state.endKey = 0;
+        state.graph = &graph;
+        state.record = &block;
+        return state;
+    }
+
+    quint64 blockKey(const QNodeViewGraph& graph, const QNodeViewGraphBlock& block)
+    {
+        return block.ports.isEmpty() ? blockState(graph, block).key : block.ports.first().id;
+    }
+
+    ItemState groupState(const QNodeViewGraph& graph, const QNodeViewGraphGroup& group)
+    {
+        // Members are items of their own, the group only records which ones it holds
+        Hasher hasher;
+        hasher.addString(group.name);
+        hasher.addValue(group.collapsed);
+        hasher.addValue(group.members.size());
+
+        Q_FOREACH (const QNodeViewGraphBlock& member, group.members)
+            hasher.addValue(blockKey(graph, member));
+
+        ItemState state;
+        state.content = hasher.result();
+        state.position = positionHash(group.position);
+        state.key = group.members.isEmpty() ? state.content : blockKey(graph, group.members.first());
+        state.endKey = 0;
+        state.graph = &graph;
+        state.record = &group;
+        return state;
+    }
+
+    ItemState connectionState(const QNodeViewGraph& graph, const QNodeViewGraphConnection& connection)
+    {
+        Hasher hasher;
+        hasher.addValue(connection.splits.size());
+
+        Q_FOREACH (const QPointF& split, connection.splits)
+        {
+            hasher.addReal(split.x());
+            hasher.addReal(split.y());
+        }
+
+        ItemState state;
+        state.content = hasher.result();
+        state.position = 0;
+        state.key = connection.startPort;
+        state.endKey = connection.endPort;
+        state.graph = &graph;
+        state.record = &connection;
+        return state;
+    }
+
+    template <typename Record, typename Function>
+    QVector<ItemState> hashItems(const QVector<const Record*>& records, Function function)
+    {
+        QVector<ItemState> states(records.size());
+        ItemState* output = states.data();
+
+        QVector<qint32> batches;
+        for (qint32 first = 0; first < records.size(); first += s_hashBatch)
+            batches.append(first);
+
+        QtConcurrent::blockingMap(batches, [&](const qint32& first)
+        {
+            const qint32 last = qMin(first + s_hashBatch, records.size());
+
+            for (qint32 index = first; index < last; ++index)
+                output[index] = function(*records[index]);
+        });
+
+        return states;
+    }
+
+    qint32 bucketOf(const ItemState& state)
+    {
+        return qint32(mix(state.key ^ mix(state.endKey)) >> (64 - s_bucketBits));
+    }
+
+    ItemIndex buildIndex(const QVector<ItemState>& states)
+    {
+        ItemIndex index;
+        index.buckets.resize(s_bucketCount);
+        index.bucketHashes.fill(0, s_bucketCount);
+
+        // Summing keeps bucket hashes independent of item order
+        Q_FOREACH (const ItemState& state, states)
+        {
+            const qint32 bucket = bucketOf(state);
+            index.buckets[bucket].append(state);
+            index.bucketHashes[bucket] += mix(state.key ^ mix(state.endKey ^ mix(state.content ^ mix(state.position))));
+        }
+
+        return index;
+    }
+
+    GraphIndex buildGraphIndex(const QNodeViewGraph& graph)
+    {
+        QVector<const QNodeViewGraphBlock*> blocks;
+        QVector<const QNodeViewGraphGroup*> groups;
+        QVector<const QNodeViewGraphConnection*> connections;
+
+        Q_FOREACH (const QNodeViewGraphBlock& block, graph.blocks)
+            blocks.append(&block);
+
+        Q_FOREACH (const QNodeViewGraphGroup& group, graph.groups)
+        {
+            groups.append(&group);
+
+            Q_FOREACH (const QNodeViewGraphBlock& member, group.members)
+                blocks.append(&member);
+        }
+
+        Q_FOREACH (const QNodeViewGraphConnection& connection, graph.connections)
+            connections.append(&connection);
+
+        GraphIndex index;
+        index.items[QNodeViewGraphItem_Block] = buildIndex(hashItems(blocks, [&graph](const QNodeViewGraphBlock& block) { return blockState(graph, block); }));
+        index.items[QNodeViewGraphItem_Group] = buildIndex(hashItems(groups, [&graph](const QNodeViewGraphGroup& group) { return groupState(graph, group); }));
+        index.items[QNodeViewGraphItem_Connection] = buildIndex(hashItems(connections, [&graph](const QNodeViewGraphConnection& connection) { return connectionState(graph, connection); }));
+
+        Hasher root;
+        for (qint32 kind = 0; kind < s_itemKinds; ++kind)
+        {
+            Q_FOREACH (quint64 bucketHash, index.items[kind].bucketHashes)
+                root.addValue(bucketHash);
+        }
+
+        index.root = root.result();
+        return index;
+    }
+
+    QPointF positionOf(qint32 kind, const ItemState& state)
+    {
+        if (kind == QNodeViewGraphItem_Block)
+            return static_cast<const QNodeViewGraphBlock*>(state.record)->position;
+
+        if (kind == QNodeViewGraphItem_Group)
+            return static_cast<const QNodeViewGraphGroup*>(state.record)->position;
+
+        return QPointF();
+    }
+
+    QNodeViewGraphChange makeChange(qint32 kind, qint32 change, const ItemState& state)
+    {
+        QNodeViewGraphChange result;
+        result.item = kind;
+        result.change = change;
+        result.key = state.key;
+        result.endKey = state.endKey;
+        return result;
+    }
+
+    QString describe(qint32 kind, const ItemState& state)
+    {
+        if (kind == QNodeViewGraphItem_Connection)
+            return QString("connection %1 -> %2").arg(state.key).arg(state.endKey);
+
+        return QString(kind == QNodeViewGraphItem_Block ? "block %1" : "group %1").arg(state.key);
+    }
+
+    bool sameState(const ItemState* first, const ItemState* second, bool position)
+    {
+        if (!first || !second)
+            return first == second;
+
+        return position ? first->position == second->position : first->content == second->content;
+    }
+
+    // Classic three-way rule for one aspect of an item, ours wins a conflict
+    const ItemState* pick(const ItemState* base, const ItemState* ours, const ItemState* theirs, bool position, bool& conflict)
+    {
+        if (sameState(ours, theirs, position) || sameState(theirs, base, position))
+            return ours;
+
+        if (sameState(ours, base, position))
+            return theirs;
+
+        conflict = true;
+        return ours;
+    }
+
+    struct Versions
+    {
+        Versions() : base(NULL), ours(NULL), theirs(NULL) {}
+
+        const ItemState* base;
+        const ItemState* ours;
+        const ItemState* theirs;
+    };
+
+    void mergeBucket(qint32 kind, const QVector<ItemState>& base, const QVector<ItemState>& ours, const QVector<ItemState>& theirs, QVector<Pick>& picks, QStringList& conflicts)
+    {
+        QHash<ItemKey, Versions> items;
+
+        Q_FOREACH (const ItemState& state, base)
+            items[ItemKey(state.key, state.endKey)].base = &state;
+
+        Q_FOREACH (const ItemState& state, ours)
+            items[ItemKey(state.key, state.endKey)].ours = &state;
+
+        Q_FOREACH (const ItemState& state, theirs)
+            items[ItemKey(state.key, state.endKey)].theirs = &state;
+
+        for (QHash<ItemKey, Versions>::const_iterator entry = items.constBegin(); entry != items.constEnd(); ++entry)
+        {
+            const Versions& versions = entry.value();
+
+            if (!versions.ours && !versions.theirs)
+                continue;
+
+            if (!versions.ours || !versions.theirs)
+            {
+                const ItemState* kept = versions.ours ? versions.ours : versions.theirs;
+
+                // Removing an item the other side left alone is a clean removal
+                if (versions.base && sameState(versions.base, kept, false) && sameState(versions.base, kept, true))
+                    continue;
+
+                if (versions.base)
+                    conflicts.append(describe(kind, *kept) + " was removed on one side and changed on the other");
+
+                const Pick keptPick = { kept, kept };
+                picks.append(keptPick);
+                continue;
+            }
+
+            bool contentConflict = false;
+            bool positionConflict = false;
+
+            const Pick merged =
+            {
+                pick(versions.base, versions.ours, versions.theirs, false, contentConflict),
+                pick(versions.base, versions.ours, versions.theirs, true, positionConflict)
+            };
+
+            if (contentConflict)
+                conflicts.append(describe(kind, *versions.ours) + " was changed on both sides");
+
+            if (positionConflict)
+                conflicts.append(describe(kind, *versions.ours) + " was moved on both sides");
+
+            picks.append(merged);
+        }
+    }
+
+    bool pickLessThan(const Pick& first, const Pick& second)
+    {
+        return ItemKey(first.content->key, first.content->endKey) < ItemKey(second.content->key, second.content->endKey);
+    }
+
+    bool changeLessThan(const QNodeViewGraphChange& first, const QNodeViewGraphChange& second)
+    {
+        if (first.item != second.item)
+            return first.item < second.item;
+
+        if (first.key != second.key)
+            return first.key < second.key;
+
+        if (first.endKey != second.endKey)
+            return first.endKey < second.endKey;
+
+        return first.change < second.change;
+    }
+
+    // Type ids index each graph's own tables, so merged records are mapped into the result's by name
+    class TypeRemap
+    {
+    public:
+        explicit TypeRemap(QNodeViewGraph& result) : m_result(result)
+        {
+            m_result.portTypes.append("Any");
+            m_result.nodeTypes.append(QString());
+            m_portTypes.insert("Any", 0);
+        }
+
+        QNodeViewGraphBlock block(const QNodeViewGraph& graph, const QNodeViewGraphBlock& source)
+        {
+            QNodeViewGraphBlock result = source;
+
+            if (source.nodeType)
+                result.nodeType = id(m_nodeTypes, m_result.nodeTypes, nodeTypeName(graph, source.nodeType));
+
+            for (qint32 index = 0; index < result.ports.size(); ++index)
+                result.ports[index].typeId = id(m_portTypes, m_result.portTypes, portTypeName(graph, source.ports[index].typeId));
+
+            return result;
+        }
+
+    private:
+        static quint16 id(QHash<QString, quint16>& ids, QStringList& names, const QString& name)
+        {
+            QHash<QString, quint16>::const_iterator existing = ids.constFind(name);
+            if (existing != ids.constEnd())
+                return existing.value();
+
+            const quint16 result = quint16(names.size());
+            names.append(name);
+            ids.insert(name, result);
+            return result;
+        }
+
+    private:
+        QNodeViewGraph& m_result;
+        QHash<QString, quint16> m_portTypes;
+        QHash<QString, quint16> m_nodeTypes;
+    };
+}
+
+quint64 QNodeViewGraphDiff::hash(const QNodeViewGraph& graph)
+{
+    return buildGraphIndex(graph).root;
+}
+
+QVector<QNodeViewGraphChange> QNodeViewGraphDiff::diff(const QNodeViewGraph& from, const QNodeViewGraph& to)
+{
+    const GraphIndex fromIndex = buildGraphIndex(from);
+    const GraphIndex toIndex = buildGraphIndex(to);
+
+    QVector<QNodeViewGraphChange> changes;
+    if (fromIndex.root == toIndex.root)
+        return changes;
+
+    for (qint32 kind = 0; kind < s_itemKinds; ++kind)
+    {
+        const ItemIndex& fromItems = fromIndex.items[kind];
+        const ItemIndex& toItems = toIndex.items[kind];
+
+        for (qint32 bucket = 0; bucket < s_bucketCount; ++bucket)
+        {
+            if (fromItems.bucketHashes[bucket] == toItems.bucketHashes[bucket])
+                continue;
+
+            QHash<ItemKey, const ItemState*> previous;
+            Q_FOREACH (const ItemState& state, fromItems.buckets[bucket])
+                previous.insert(ItemKey(state.key, state.endKey), &state);
+
+            Q_FOREACH (const ItemState& state, toItems.buckets[bucket])
+            {
+                QHash<ItemKey, const ItemState*>::iterator match = previous.find(ItemKey(state.key, state.endKey));
+                if (match == previous.end())
+                {
+                    changes.append(makeChange(kind, QNodeViewGraphChange_Added, state));
+                    continue;
+                }
+
+                const ItemState* old = match.value();
+                previous.erase(match);
+
+                if (old->content != state.content)
+                    changes.append(makeChange(kind, QNodeViewGraphChange_Modified, state));
+
+                if (old->position != state.position)
+                {
+                    QNodeViewGraphChange change = makeChange(kind, QNodeViewGraphChange_Moved, state);
+                    change.from = positionOf(kind, *old);
+                    change.to = positionOf(kind, state);
+                    changes.append(change);
+                }
+            }
+
+            Q_FOREACH (const ItemState* state, previous)
+                changes.append(makeChange(kind, QNodeViewGraphChange_Removed, *state));
+        }
+    }
+
+    std::sort(changes.begin(), changes.end(), changeLessThan);
+    return changes;
+}
+
+QNodeViewGraph QNodeViewGraphDiff::merge(const QNodeViewGraph& base, const QNodeViewGraph& ours, const QNodeViewGraph& theirs, QStringList* conflicts)
+{
+    const GraphIndex baseIndex = buildGraphIndex(base);
+    const GraphIndex oursIndex = buildGraphIndex(ours);
+    const GraphIndex theirsIndex = buildGraphIndex(theirs);
+
+    QVector<Pick> picks[s_itemKinds];
+    QStringList mergeConflicts;
+
+    for (qint32 kind = 0; kind < s_itemKinds; ++kind)
+    {
+        const ItemIndex& baseItems = baseIndex.items[kind];
+        const ItemIndex& oursItems = oursIndex.items[kind];
+        const ItemIndex& theirsItems = theirsIndex.items[kind];
+
+        for (qint32 bucket = 0; bucket < s_bucketCount; ++bucket)
+        {
+            const quint64 oursHash = oursItems.bucketHashes[bucket];
+            const quint64 theirsHash = theirsItems.bucketHashes[bucket];
+
+            // Buckets only one side touched are taken whole
+            const QVector<ItemState>* taken = NULL;
+            if (oursHash == theirsHash || theirsHash == baseItems.bucketHashes[bucket])
+                taken = &oursItems.buckets[bucket];
+            else if (oursHash == baseItems.bucketHashes[bucket])
+                taken = &theirsItems.buckets[bucket];
+
+            if (!taken)
+            {
+                mergeBucket(kind, baseItems.buckets[bucket], oursItems.buckets[bucket], theirsItems.buckets[bucket], picks[kind], mergeConflicts);
+                continue;
+            }
+
+            Q_FOREACH (const ItemState& state, *taken)
+            {
+                const Pick statePick = { &state, &state };
+                picks[kind].append(statePick);
+            }
+        }
+
+        // Bucket order is arbitrary, sort so merges are reproducible
+        std::sort(picks[kind].begin(), picks[kind].end(), pickLessThan);
+    }
+
+    QNodeViewGraph result;
+    TypeRemap remap(result);
+
+    QHash<quint64, QNodeViewGraphBlock> blocks;
+    QSet<quint64> portIds;
+
+    Q_FOREACH (const Pick& blockPick, picks[QNodeViewGraphItem_Block])
+    {
+        QNodeViewGraphBlock block = remap.block(*blockPick.content->graph, *static_cast<const QNodeViewGraphBlock*>(blockPick.content->record));
+        block.position = positionOf(QNodeViewGraphItem_Block, *blockPick.position);
+
+        Q_FOREACH (const QNodeViewGraphPort& port, block.ports)
+            portIds.insert(port.id);
+
+        blocks.insert(blockPick.content->key, block);
+    }
+
+    QSet<quint64> grouped;
+
+    Q_FOREACH (const Pick& groupPick, picks[QNodeViewGraphItem_Group])
+    {
+        const QNodeViewGraphGroup& source = *static_cast<const QNodeViewGraphGroup*>(groupPick.content->record);
+
+        QNodeViewGraphGroup group;
+        group.name = source.name;
+        group.collapsed = source.collapsed;
+        group.position = positionOf(QNodeViewGraphItem_Group, *groupPick.position);
+
+        Q_FOREACH (const QNodeViewGraphBlock& member, source.members)
+        {
+            const quint64 key = blockKey(*groupPick.content->graph, member);
+            if (!blocks.contains(key) || grouped.contains(key))
+                continue;
+
+            group.members.append(blocks.value(key));
+            grouped.insert(key);
+        }
+
+        if (group.members.isEmpty())
+        {
+            mergeConflicts.append(describe(QNodeViewGraphItem_Group, *groupPick.content) + " lost all of its members");
+            continue;
+        }
+
+        result.groups.append(group);
+    }
+
+    Q_FOREACH (const Pick& blockPick, picks[QNodeViewGraphItem_Block])
+    {
+        if (!grouped.contains(blockPick.content->key))
+            result.blocks.append(blocks.value(blockPick.content->key));
+    }
+
+    Q_FOREACH (const Pick& connectionPick, picks[QNodeViewGraphItem_Connection])
+    {
+        const QNodeViewGraphConnection& connection = *static_cast<const QNodeViewGraphConnection*>(connectionPick.content->record);
+
+        if (!portIds.contains(connection.startPort) || !portIds.contains(connection.endPort))
+        {
+            mergeConflicts.append(describe(QNodeViewGraphItem_Connection, *connectionPick.content) + " lost a port on the other side");
+            continue;
+        }
+
+        result.connections.append(connection);
+    }
+
+    if (conflicts)
+        *conflicts = mergeConflicts;
+
+    return result;
+}
@@ -0,0 +1,81 @@
+/*!
+  @file    QNodeViewGraphDiff.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QNodeViewGraph.h>
+
+enum QNodeViewGraphItem
+{
+    QNodeViewGraphItem_Block,
+    QNodeViewGraphItem_Group,
+    QNodeViewGraphItem_Connection
+};
+
+enum QNodeViewGraphChangeType
+{
+    QNodeViewGraphChange_Added,
+    QNodeViewGraphChange_Removed,
+    QNodeViewGraphChange_Modified,
+    QNodeViewGraphChange_Moved
+};
+
+/*!
+    Items are identified by port ids, which are kept across saves: blocks by
+    their first port, groups by their first member, and connections by their
+    start and end port.
+*/
+struct QNodeViewGraphChange
+{
+    QNodeViewGraphChange() : item(QNodeViewGraphItem_Block), change(QNodeViewGraphChange_Added), key(0), endKey(0) {}
+
+    qint32 item;
+    qint32 change;
+    quint64 key;
+    quint64 endKey;
+
+    // Only for moves
+    QPointF from;
+    QPointF to;
+};
+
+/*!
+    Structural comparison and three-way merge of graphs.
+
+    Every item is hashed once, in parallel, into a content hash and a
+    position hash. Items are spread over a fixed number of buckets by id and
+    each bucket is summarized by a hash of its items, Merkle style, so equal
+    buckets are skipped with a single comparison and only the items of
+    differing buckets are matched up. Port and node types are compared by
+    name, so graphs with different type tables still compare equal.
+*/
+class QNodeViewGraphDiff
+{
+public:
+    // Summary hash of the whole graph, equal for structurally equal graphs
+    static quint64 hash(const QNodeViewGraph& graph);
+
+    static QVector<QNodeViewGraphChange> diff(const QNodeViewGraph& from, const QNodeViewGraph& to);
+
+    // Content and position are merged separately, so a move on one side and an edit on the other merge cleanly.
+    // Conflicting items are taken from ours and described in conflicts.
+    static QNodeViewGraph merge(const QNodeViewGraph& base, const QNodeViewGraph& ours, const QNodeViewGraph& theirs, QStringList* conflicts = NULL);
+};
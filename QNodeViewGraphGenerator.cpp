@@ -0,0 +1,232 @@
+/*!
+  @file    QNodeViewGraphGenerator.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QtMath>
+
+#include <QNodeViewGraphGenerator.h>
+
+namespace
+{
+    // Same value as QNodeViewPortLabel_Name, which lives with the widgets
+    const qint32 s_titleFlags = 1;
+
+    // SplitMix64, small and identical on every platform unlike the std distributions
+    class Random
+    {
+    public:
+        explicit Random(quint64 seed) : m_state(seed) {}
+
+        quint64 next()
+        {
+            quint64 value = (m_state += Q_UINT64_C(0x9E3779B97F4A7C15));
+            value = (value ^ (value >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+            value = (value ^ (value >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+            return value ^ (value >> 31);
+        }
+
+        // Uniform in [0, 1)
+        qreal real()
+        {
+            return qreal(next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        // Uniform in [minimum, maximum]
+        qint32 range(qint32 minimum, qint32 maximum)
+        {
+            if (maximum <= minimum)
+                return minimum;
+
+            return minimum + qint32(next() % quint64(maximum - minimum + 1));
+        }
+
+    private:
+        quint64 m_state;
+    };
+
+    struct OutputSlot
+    {
+        quint64 portId;
+        qint32 connections;
+    };
+
+    struct BlockPorts
+    {
+        qint32 firstOutput;
+        qint32 outputCount;
+    };
+}
+
+QNodeViewGraph QNodeViewGraphGenerator::generate(const QNodeViewGraphGeneratorOptions& options)
+{
+    QNodeViewGraph graph;
+    graph.portTypes.append("Any");
+    graph.nodeTypes.append(QString());
+
+    const qint32 blockCount = qMax(0, options.blocks);
+    if (blockCount == 0)
+        return graph;
+
+    Random random(options.seed);
+
+    const qint32 depth = qBound(1, options.depth > 0 ? options.depth : qCeil(qSqrt(blockCount)), blockCount);
+    const qint32 width = (blockCount + depth - 1) / depth;
+
+    // A maximum below the minimum is raised to it, so the name lists always cover every port drawn
+    const qint32 minInputs = qMax(options.minInputs, 0);
+    const qint32 maxInputs = qMax(options.maxInputs, minInputs);
+    const qint32 minOutputs = qMax(options.minOutputs, 0);
+    const qint32 maxOutputs = qMax(options.maxOutputs, minOutputs);
+
+    // Port names are shared between blocks, so a million blocks do not mean millions of strings
+    QStringList inputNames;
+    QStringList outputNames;
+
+    for (qint32 index = 0; index < maxInputs; ++index)
+        inputNames.append(QString("In %1").arg(index + 1));
+
+    for (qint32 index = 0; index < maxOutputs; ++index)
+        outputNames.append(QString("Out %1").arg(index + 1));
+
+    graph.blocks.resize(blockCount);
+
+    QVector<OutputSlot> outputs;
+    QVector<BlockPorts> blockPorts(blockCount);
+    quint64 nextPortId = 1;
+
+    const qint32 gridColumns = qCeil(qSqrt(blockCount));
+    const QSizeF area(gridColumns * options.spacing.width(), gridColumns * options.spacing.height());
+
+    for (qint32 index = 0; index < blockCount; ++index)
+    {
+        QNodeViewGraphBlock& block = graph.blocks[index];
+
+        const qint32 layer = index / width;
+        const qint32 row = index % width;
+
+        switch (options.layout)
+        {
+            case QNodeViewGraphLayout_Layered:
+                block.position = QPointF(layer * options.spacing.width(), row * options.spacing.height());
+                break;
+
+            case QNodeViewGraphLayout_Grid:
+                block.position = QPointF((index % gridColumns) * options.spacing.width(), (index / gridColumns) * options.spacing.height());
+                break;
+
+            case QNodeViewGraphLayout_Random:
+                block.position = QPointF(random.real() * area.width(), random.real() * area.height());
+                break;
+        }
+
+        const qint32 inputCount = random.range(minInputs, maxInputs);
+        const qint32 outputCount = random.range(minOutputs, maxOutputs);
+
+        block.ports.resize(1 + inputCount + outputCount);
+
+        QNodeViewGraphPort& title = block.ports[0];
+        title.id = nextPortId++;
+        title.name = QString("Block %1").arg(index);
+        title.flags = s_titleFlags;
+
+        for (qint32 port = 0; port < inputCount; ++port)
+        {
+            QNodeViewGraphPort& input = block.ports[1 + port];
+            input.id = nextPortId++;
+            input.name = inputNames[port];
+        }
+
+        blockPorts[index].firstOutput = outputs.size();
+        blockPorts[index].outputCount = outputCount;
+
+        for (qint32 port = 0; port < outputCount; ++port)
+        {
+            QNodeViewGraphPort& output = block.ports[1 + inputCount + port];
+            output.id = nextPortId++;
+            output.name = outputNames[port];
+            output.isOutput = true;
+
+            const OutputSlot slot = { output.id, 0 };
+            outputs.append(slot);
+        }
+    }
+
+    // Inputs only connect to outputs in earlier layers, which keeps the graph acyclic
+    QVector<quint64> sources;
+
+    for (qint32 index = width; index < blockCount; ++index)
+    {
+        const QNodeViewGraphBlock& block = graph.blocks[index];
+        const qint32 layer = index / width;
+        const qint32 span = qMin(qMax(options.maxLayerSpan, 1), layer);
+
+        for (qint32 port = 1; port < block.ports.size(); ++port)
+        {
+            const QNodeViewGraphPort& input = block.ports[port];
+            if (input.isOutput || random.real() >= options.connectedInputs)
+                continue;
+
+            const qint32 fanIn = random.range(1, qMax(options.maxFanIn, 1));
+            sources.clear();
+
+            for (qint32 attempt = 0; attempt < fanIn * 4 && sources.size() < fanIn; ++attempt)
+            {
+                const qint32 sourceLayer = layer - random.range(1, span);
+                const qint32 layerSize = qMin(width, blockCount - sourceLayer * width);
+
+                // Raising a uniform sample to a power favors the first blocks of each layer
+                const qint32 sourceRow = qMin(layerSize - 1, qint32(qPow(random.real(), qMax<qreal>(options.fanOutSkew, 1.0)) * layerSize));
+                const BlockPorts& source = blockPorts[sourceLayer * width + sourceRow];
+
+                if (source.outputCount == 0)
+                    continue;
+
+                OutputSlot& slot = outputs[source.firstOutput + random.range(0, source.outputCount - 1)];
+                if (slot.connections >= options.maxFanOut || sources.contains(slot.portId))
+                    continue;
+
+                ++slot.connections;
+                sources.append(slot.portId);
+
+                QNodeViewGraphConnection connection;
+                connection.startPort = slot.portId;
+                connection.endPort = input.id;
+
+                const QPointF start = graph.blocks[sourceLayer * width + sourceRow].position;
+                const QPointF end = block.position;
+
+                qint32 splitCount = qFloor(options.splitDensity);
+                if (random.real() < options.splitDensity - splitCount)
+                    ++splitCount;
+
+                for (qint32 split = 0; split < splitCount; ++split)
+                {
+                    const qreal along = qreal(split + 1) / (splitCount + 1);
+                    const QPointF jitter((random.real() - 0.5) * options.spacing.width() * 0.25, (random.real() - 0.5) * options.spacing.height() * 0.25);
+                    connection.splits.append(start + (end - start) * along + jitter);
+                }
+
+                graph.connections.append(connection);
+            }
+        }
+    }
+
+    return graph;
+}
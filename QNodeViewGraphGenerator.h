@@ -0,0 +1,96 @@
+/*!
+  @file    QNodeViewGraphGenerator.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QSizeF>
+
+#include <QNodeViewGraph.h>
+
+enum QNodeViewGraphLayout
+{
+    QNodeViewGraphLayout_Layered,   // One column per DAG layer
+    QNodeViewGraphLayout_Grid,      // Square grid in block order
+    QNodeViewGraphLayout_Random     // Uniformly scattered
+};
+
+struct QNodeViewGraphGeneratorOptions
+{
+    QNodeViewGraphGeneratorOptions()
+    : seed(1)
+    , blocks(1000)
+    , minInputs(1)
+    , maxInputs(4)
+    , minOutputs(1)
+    , maxOutputs(4)
+    , connectedInputs(0.8)
+    , maxFanIn(1)
+    , maxFanOut(8)
+    , fanOutSkew(1.0)
+    , depth(0)
+    , maxLayerSpan(1)
+    , splitDensity(0.1)
+    , layout(QNodeViewGraphLayout_Layered)
+    , spacing(250.0, 150.0)
+    {
+    }
+
+    quint32 seed;
+    qint32 blocks;
+
+    // Port counts per block, uniformly distributed in the inclusive range; a maximum below the minimum counts as the minimum
+    qint32 minInputs;
+    qint32 maxInputs;
+    qint32 minOutputs;
+    qint32 maxOutputs;
+
+    // Fraction of inputs with incoming connections, and how many each gets
+    qreal connectedInputs;
+    qint32 maxFanIn;
+
+    // Connections per output are capped; a skew above 1 concentrates them on a few hub blocks
+    qint32 maxFanOut;
+    qreal fanOutSkew;
+
+    // Number of DAG layers, or the square root of the block count if 0, and how far back connections may reach
+    qint32 depth;
+    qint32 maxLayerSpan;
+
+    // Average number of splits per connection
+    qreal splitDensity;
+
+    QNodeViewGraphLayout layout;
+    QSizeF spacing;
+};
+
+/*!
+    Builds reproducible synthetic graphs for scale testing.
+
+    Graphs are produced directly in the file model, without a scene, so even
+    very large fixtures only cost the time to fill the record vectors. Blocks
+    are arranged in DAG layers and only connect to earlier layers. The same
+    options and seed always produce the same graph on every platform.
+*/
+class QNodeViewGraphGenerator
+{
+public:
+    static QNodeViewGraph generate(const QNodeViewGraphGeneratorOptions& options);
+};
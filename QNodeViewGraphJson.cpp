@@ -0,0 +1,688 @@
+/*!
+  @file    QNodeViewGraphJson.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <QtConcurrent>
+
+#include <cstring>
+
+#include <QNodeViewGraph.h>
+
+/*
+    JSON representation of a graph, equivalent to the binary format:
+
+    {
+        "format": "qnodeview",
+        "version": 4,
+        "portTypes": ["Any", "Float"],
+        "nodeTypes": ["", "TestEntity"],
+        "blocks": [
+            { "x": 0, "y": 0, "nodeType": 1, "title": "Mixer", "ports": [ { "id": "17" }, ... ] },
+            { "x": 150, "y": 0, "nodeType": 0, "ports": [
+                { "id": "18", "name": "Input", "output": false, "flags": 0, "type": 1 }, ... ] }
+        ],
+        "groups": [
+            { "x": 0, "y": 0, "name": "Group", "collapsed": true, "members": [ <blocks> ] }
+        ],
+        "connections": [
+            { "start": "19", "end": "18", "splits": [ [ 75, 20 ], ... ] }
+        ]
+    }
+
+    Port ids are 64 bit and written as decimal strings, since JSON numbers
+    are doubles in most readers. "type" and "nodeType" index the type tables
+    of the same document, and typed blocks only list their port ids and an
+    optional title, exactly as in the binary format.
+*/
+
+namespace
+{
+    // Elements of the large arrays parsed per task
+    const qint32 s_batchElements = 1024;
+
+    // Output is handed to the device in pieces of this size
+    const qint32 s_writeBuffer = 256 * 1024;
+
+    bool fail(QString* errorString, const QString& message)
+    {
+        if (errorString)
+            *errorString = message;
+
+        return false;
+    }
+
+    class JsonWriter
+    {
+    public:
+        explicit JsonWriter(QIODevice& device)
+        : m_device(device)
+        , m_ok(true)
+        {
+            m_buffer.reserve(s_writeBuffer + 4096);
+        }
+
+        void raw(const char* text)
+        {
+            m_buffer.append(text);
+            flushIfFull();
+        }
+
+        void string(const QString& value)
+        {
+            static const char s_hex[] = "0123456789abcdef";
+
+            // Bytes of multi-byte UTF-8 sequences never need escaping
+            const QByteArray utf8 = value.toUtf8();
+            m_buffer.append('"');
+
+            Q_FOREACH (char character, utf8)
+            {
+                const uchar byte = uchar(character);
+
+                if (byte == '"' || byte == '\\')
+                {
+                    m_buffer.append('\\');
+                    m_buffer.append(character);
+                }
+                else if (byte < 0x20)
+                {
+                    m_buffer.append("\\u00");
+                    m_buffer.append(s_hex[byte >> 4]);
+                    m_buffer.append(s_hex[byte & 0xf]);
+                }
+                else
+                {
+                    m_buffer.append(character);
+                }
+            }
+
+            m_buffer.append('"');
+            flushIfFull();
+        }
+
+        void number(qint64 value)
+        {
+            m_buffer.append(QByteArray::number(value));
+        }
+
+        void number(double value)
+        {
+            // Shortest text that reads back to the same double
+            m_buffer.append(QByteArray::number(qIsFinite(value) ? value : 0.0, 'g', QLocale::FloatingPointShortest));
+        }
+
+        void id(quint64 value)
+        {
+            m_buffer.append('"');
+            m_buffer.append(QByteArray::number(value));
+            m_buffer.append('"');
+        }
+
+        void boolean(bool value)
+        {
+            m_buffer.append(value ? "true" : "false");
+        }
+
+        bool finish()
+        {
+            flush();
+            return m_ok;
+        }
+
+    private:
+        void flushIfFull()
+        {
+            if (m_buffer.size() >= s_writeBuffer)
+                flush();
+        }
+
+        void flush()
+        {
+            if (m_ok && m_device.write(m_buffer) != m_buffer.size())
+                m_ok = false;
+
+            // Keeps the capacity, the buffer is reused for the next piece
+            m_buffer.resize(0);
+        }
+
+    private:
+        QIODevice& m_device;
+        QByteArray m_buffer;
+        bool m_ok;
+    };
+
+    void writeStrings(JsonWriter& writer, const QStringList& values)
+    {
+        writer.raw("[");
+
+        for (qint32 index = 0; index < values.size(); ++index)
+        {
+            if (index)
+                writer.raw(", ");
+
+            writer.string(values[index]);
+        }
+
+        writer.raw("]");
+    }
+
+    // Fields are gated on the version like in the binary format, so a document only holds what its version describes
+    void writeBlock(JsonWriter& writer, const QNodeViewGraphBlock& block, qint32 version)
+    {
+        writer.raw("{ \"x\": ");
+        writer.number(block.position.x());
+        writer.raw(", \"y\": ");
+        writer.number(block.position.y());
+
+        if (version >= 3)
+        {
+            writer.raw(", \"nodeType\": ");
+            writer.number(qint64(block.nodeType));
+        }
+
+        if (version >= 4 && !block.title.isEmpty())
+        {
+            writer.raw(", \"title\": ");
+            writer.string(block.title);
+        }
+
+        writer.raw(", \"ports\": [");
+
+        for (qint32 index = 0; index < block.ports.size(); ++index)
+        {
+            const QNodeViewGraphPort& port = block.ports[index];
+
+            writer.raw(index ? ", { \"id\": " : " { \"id\": ");
+            writer.id(port.id);
+
+            if (block.nodeType == 0)
+            {
+                writer.raw(", \"name\": ");
+                writer.string(port.name);
+                writer.raw(", \"output\": ");
+                writer.boolean(port.isOutput);
+                writer.raw(", \"flags\": ");
+                writer.number(qint64(port.flags));
+
+                if (version >= 2)
+                {
+                    writer.raw(", \"type\": ");
+                    writer.number(qint64(port.typeId));
+                }
+            }
+
+            writer.raw(" }");
+        }
+
+        writer.raw(" ] }");
+    }
+
+    void writeGroup(JsonWriter& writer, const QNodeViewGraphGroup& group, qint32 version)
+    {
+        writer.raw("{ \"x\": ");
+        writer.number(group.position.x());
+        writer.raw(", \"y\": ");
+        writer.number(group.position.y());
+        writer.raw(", \"name\": ");
+        writer.string(group.name);
+        writer.raw(", \"collapsed\": ");
+        writer.boolean(group.collapsed);
+        writer.raw(", \"members\": [");
+
+        for (qint32 index = 0; index < group.members.size(); ++index)
+        {
+            writer.raw(index ? ",\n            " : "\n            ");
+            writeBlock(writer, group.members[index], version);
+        }
+
+        writer.raw(" ] }");
+    }
+
+    void writeConnection(JsonWriter& writer, const QNodeViewGraphConnection& connection)
+    {
+        writer.raw("{ \"start\": ");
+        writer.id(connection.startPort);
+        writer.raw(", \"end\": ");
+        writer.id(connection.endPort);
+        writer.raw(", \"splits\": [");
+
+        for (qint32 index = 0; index < connection.splits.size(); ++index)
+        {
+            writer.raw(index ? ", [ " : " [ ");
+            writer.number(connection.splits[index].x());
+            writer.raw(", ");
+            writer.number(connection.splits[index].y());
+            writer.raw(" ]");
+        }
+
+        writer.raw(" ] }");
+    }
+
+    // Locating values without parsing them, so the large arrays can be cut into batches
+    class JsonScanner
+    {
+    public:
+        JsonScanner(const QByteArray& data) : m_data(data.constData()), m_size(data.size()), m_position(0) {}
+
+        qint32 position() const { return m_position; }
+        void setPosition(qint32 position) { m_position = position; }
+
+        void skipSpace()
+        {
+            while (m_position < m_size && (m_data[m_position] == ' ' || m_data[m_position] == '\n' || m_data[m_position] == '\r' || m_data[m_position] == '\t'))
+                ++m_position;
+        }
+
+        bool expect(char character)
+        {
+            skipSpace();
+
+            if (m_position >= m_size || m_data[m_position] != character)
+                return false;
+
+            ++m_position;
+            return true;
+        }
+
+        bool peek(char character)
+        {
+            skipSpace();
+            return m_position < m_size && m_data[m_position] == character;
+        }
+
+        // Raw key bytes, keys of this format never contain escapes
+        bool key(QByteArray& result)
+        {
+            skipSpace();
+
+            if (m_position >= m_size || m_data[m_position] != '"')
+                return false;
+
+            const qint32 begin = ++m_position;
+            if (!skipString())
+                return false;
+
+            result = QByteArray(m_data + begin, m_position - begin - 1);
+            return expect(':');
+        }
+
+        // Moves past one value of any kind, reporting where it starts
+        bool skipValue(qint32& begin)
+        {
+            skipSpace();
+            begin = m_position;
+
+            if (m_position >= m_size)
+                return false;
+
+            if (m_data[m_position] == '"')
+            {
+                ++m_position;
+                return skipString();
+            }
+
+            if (m_data[m_position] != '{' && m_data[m_position] != '[')
+            {
+                while (m_position < m_size && !strchr(",}] \n\r\t", m_data[m_position]))
+                    ++m_position;
+
+                return m_position > begin;
+            }
+
+            qint32 depth = 0;
+
+            while (m_position < m_size)
+            {
+                const char character = m_data[m_position++];
+
+                if (character == '"')
+                {
+                    if (!skipString())
+                        return false;
+                }
+                else if (character == '{' || character == '[')
+                {
+                    ++depth;
+                }
+                else if (character == '}' || character == ']')
+                {
+                    if (--depth == 0)
+                        return true;
+                }
+            }
+
+            return false;
+        }
+
+    private:
+        // Expects to be just past the opening quote
+        bool skipString()
+        {
+            while (m_position < m_size)
+            {
+                const char character = m_data[m_position++];
+
+                if (character == '\\')
+                    ++m_position;
+                else if (character == '"')
+                    return true;
+            }
+
+            return false;
+        }
+
+    private:
+        const char* m_data;
+        qint32 m_size;
+        qint32 m_position;
+    };
+
+    struct JsonBatch
+    {
+        qint32 recordType;
+        QByteArray text;
+    };
+
+    struct DecodedBatch
+    {
+        QVector<QNodeViewGraphBlock> blocks;
+        QVector<QNodeViewGraphGroup> groups;
+        QVector<QNodeViewGraphConnection> connections;
+        QString error;
+    };
+
+    quint64 readId(const QJsonValue& value)
+    {
+        return value.isString() ? value.toString().toULongLong() : quint64(value.toDouble());
+    }
+
+    QNodeViewGraphBlock readBlock(const QJsonObject& object)
+    {
+        QNodeViewGraphBlock block;
+        block.position = QPointF(object.value("x").toDouble(), object.value("y").toDouble());
+        block.nodeType = quint16(object.value("nodeType").toInt());
+        block.title = object.value("title").toString();
+
+        const QJsonArray ports = object.value("ports").toArray();
+        block.ports.resize(ports.size());
+
+        for (qint32 index = 0; index < ports.size(); ++index)
+        {
+            const QJsonObject portObject = ports[index].toObject();
+            QNodeViewGraphPort& port = block.ports[index];
+
+            port.id = readId(portObject.value("id"));
+            port.name = portObject.value("name").toString();
+            port.isOutput = portObject.value("output").toBool();
+            port.flags = portObject.value("flags").toInt();
+            port.typeId = quint16(portObject.value("type").toInt());
+        }
+
+        return block;
+    }
+
+    QNodeViewGraphGroup readGroup(const QJsonObject& object)
+    {
+        QNodeViewGraphGroup group;
+        group.position = QPointF(object.value("x").toDouble(), object.value("y").toDouble());
+        group.name = object.value("name").toString();
+        group.collapsed = object.value("collapsed").toBool();
+
+        Q_FOREACH (const QJsonValue& member, object.value("members").toArray())
+            group.members.append(readBlock(member.toObject()));
+
+        return group;
+    }
+
+    QNodeViewGraphConnection readConnection(const QJsonObject& object)
+    {
+        QNodeViewGraphConnection connection;
+        connection.startPort = readId(object.value("start"));
+        connection.endPort = readId(object.value("end"));
+
+        Q_FOREACH (const QJsonValue& split, object.value("splits").toArray())
+        {
+            const QJsonArray point = split.toArray();
+            connection.splits.append(QPointF(point.at(0).toDouble(), point.at(1).toDouble()));
+        }
+
+        return connection;
+    }
+
+    DecodedBatch decodeBatch(const JsonBatch& batch)
+    {
+        DecodedBatch decoded;
+
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson(batch.text, &error);
+
+        if (error.error != QJsonParseError::NoError)
+        {
+            decoded.error = error.errorString();
+            return decoded;
+        }
+
+        const QJsonArray elements = document.array();
+
+        Q_FOREACH (const QJsonValue& element, elements)
+        {
+            switch (batch.recordType)
+            {
+                case QNodeViewRecord_Block:
+                    decoded.blocks.append(readBlock(element.toObject()));
+                    break;
+
+                case QNodeViewRecord_Group:
+                    decoded.groups.append(readGroup(element.toObject()));
+                    break;
+
+                case QNodeViewRecord_Connection:
+                    decoded.connections.append(readConnection(element.toObject()));
+                    break;
+            }
+        }
+
+        return decoded;
+    }
+
+    // Cuts an array into batches of whole elements, each a small JSON array of its own
+    bool splitArray(const QByteArray& data, JsonScanner& scanner, qint32 recordType, QVector<JsonBatch>& batches)
+    {
+        if (!scanner.expect('['))
+            return false;
+
+        qint32 batchBegin = -1;
+        qint32 batchEnd = 0;
+        qint32 elements = 0;
+
+        while (!scanner.peek(']'))
+        {
+            qint32 begin;
+            if (!scanner.skipValue(begin))
+                return false;
+
+            if (batchBegin < 0)
+                batchBegin = begin;
+
+            batchEnd = scanner.position();
+
+            if (++elements == s_batchElements)
+            {
+                JsonBatch batch = { recordType, '[' + data.mid(batchBegin, batchEnd - batchBegin) + ']' };
+                batches.append(batch);
+                batchBegin = -1;
+                elements = 0;
+            }
+
+            if (!scanner.peek(']') && !scanner.expect(','))
+                return false;
+        }
+
+        if (elements)
+        {
+            JsonBatch batch = { recordType, '[' + data.mid(batchBegin, batchEnd - batchBegin) + ']' };
+            batches.append(batch);
+        }
+
+        return scanner.expect(']');
+    }
+
+    QStringList readStrings(const QJsonValue& array)
+    {
+        QStringList result;
+
+        Q_FOREACH (const QJsonValue& value, array.toArray())
+            result.append(value.toString());
+
+        return result;
+    }
+}
+
+bool QNodeViewGraph::saveJson(QIODevice& device, qint32 saveVersion, QString* errorString) const
+{
+    if (!canSave(saveVersion, errorString))
+        return false;
+
+    JsonWriter writer(device);
+
+    writer.raw("{\n    \"format\": \"qnodeview\",\n    \"version\": ");
+    writer.number(qint64(saveVersion));
+
+    if (saveVersion >= 2)
+    {
+        writer.raw(",\n    \"portTypes\": ");
+        writeStrings(writer, portTypes);
+    }
+
+    if (saveVersion >= 3)
+    {
+        writer.raw(",\n    \"nodeTypes\": ");
+        writeStrings(writer, nodeTypes);
+    }
+
+    // One element per line keeps the output friendly to line based tools
+    writer.raw(",\n    \"blocks\": [");
+    for (qint32 index = 0; index < blocks.size(); ++index)
+    {
+        writer.raw(index ? ",\n        " : "\n        ");
+        writeBlock(writer, blocks[index], saveVersion);
+    }
+
+    writer.raw("\n    ],\n    \"groups\": [");
+    for (qint32 index = 0; index < groups.size(); ++index)
+    {
+        writer.raw(index ? ",\n        " : "\n        ");
+        writeGroup(writer, groups[index], saveVersion);
+    }
+
+    writer.raw("\n    ],\n    \"connections\": [");
+    for (qint32 index = 0; index < connections.size(); ++index)
+    {
+        writer.raw(index ? ",\n        " : "\n        ");
+        writeConnection(writer, connections[index]);
+    }
+
+    writer.raw("\n    ]\n}\n");
+
+    if (!writer.finish())
+        return fail(errorString, device.errorString());
+
+    return true;
+}
+
+bool QNodeViewGraph::loadJson(const QByteArray& data, QString* errorString)
+{
+    clear();
+
+    JsonScanner scanner(data);
+    QVector<JsonBatch> batches;
+
+    if (!scanner.expect('{'))
+        return fail(errorString, "not a JSON graph");
+
+    bool first = true;
+
+    while (!scanner.peek('}'))
+    {
+        if (!first && !scanner.expect(','))
+            return fail(errorString, QString("expected ',' at offset %1").arg(scanner.position()));
+
+        first = false;
+
+        QByteArray key;
+        if (!scanner.key(key))
+            return fail(errorString, QString("expected a key at offset %1").arg(scanner.position()));
+
+        const qint32 valueStart = scanner.position();
+
+        if (key == "blocks" || key == "groups" || key == "connections")
+        {
+            const qint32 recordType = (key == "blocks") ? QNodeViewRecord_Block : (key == "groups") ? QNodeViewRecord_Group : QNodeViewRecord_Connection;
+
+            if (!splitArray(data, scanner, recordType, batches))
+                return fail(errorString, QString("malformed %1 array after offset %2").arg(QString(key)).arg(valueStart));
+
+            continue;
+        }
+
+        qint32 begin;
+        if (!scanner.skipValue(begin))
+            return fail(errorString, QString("malformed value at offset %1").arg(begin));
+
+        // The header values are small, so they go through the regular parser
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson('[' + data.mid(begin, scanner.position() - begin) + ']', &error);
+
+        if (error.error != QJsonParseError::NoError)
+            return fail(errorString, QString("%1 at offset %2").arg(error.errorString()).arg(begin));
+
+        const QJsonValue value = document.array().at(0);
+
+        if (key == "format" && value.toString() != "qnodeview")
+            return fail(errorString, "not a JSON graph");
+        else if (key == "version")
+            version = value.toInt();
+        else if (key == "portTypes")
+            portTypes = readStrings(value);
+        else if (key == "nodeTypes")
+            nodeTypes = readStrings(value);
+    }
+
+    if (version < 1 || version > QNodeViewFile_Version)
+        return fail(errorString, QString("unsupported file version %1").arg(version));
+
+    const QVector<DecodedBatch> decoded = QtConcurrent::blockingMapped<QVector<DecodedBatch> >(batches, decodeBatch);
+
+    Q_FOREACH (const DecodedBatch& batch, decoded)
+    {
+        if (!batch.error.isEmpty())
+            return fail(errorString, QString("malformed record: %1").arg(batch.error));
+
+        blocks += batch.blocks;
+        groups += batch.groups;
+        connections += batch.connections;
+    }
+
+    return true;
+}
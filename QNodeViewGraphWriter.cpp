@@ -0,0 +1,61 @@
+/*!
+  @file    QNodeViewGraphWriter.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QtConcurrent>
+
+#include <QNodeViewGraphWriter.h>
+
+QNodeViewGraphWriter::QNodeViewGraphWriter(QObject* parent)
+: QObject(parent)
+{
+    // A single worker keeps saves to the same file in order
+    m_pool.setMaxThreadCount(1);
+}
+
+QNodeViewGraphWriter::~QNodeViewGraphWriter()
+{
+    waitForDone();
+}
+
+void QNodeViewGraphWriter::save(const QNodeViewGraph& graph, const QString& fileName, bool compressed)
+{
+    m_pending.ref();
+
+    QtConcurrent::run(&m_pool, [this, graph, fileName, compressed]()
+    {
+        QString errorString;
+        const bool success = graph.saveFile(fileName, QNodeViewFile_Version, compressed, &errorString);
+        m_pending.deref();
+
+        // Queued to the receivers' threads
+        emit saved(fileName, success, errorString);
+    });
+}
+
+bool QNodeViewGraphWriter::isBusy() const
+{
+    return m_pending.load() > 0;
+}
+
+void QNodeViewGraphWriter::waitForDone()
+{
+    m_pool.waitForDone();
+}
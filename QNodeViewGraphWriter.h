@@ -0,0 +1,59 @@
+/*!
+  @file    QNodeViewGraphWriter.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QThreadPool>
+
+#include <QNodeViewGraph.h>
+
+/*!
+    Writes graph snapshots to disk on a worker thread.
+
+    save() only copies the implicitly shared graph it is given, so the GUI
+    thread can keep editing while serialization, compression and the final
+    rename run in the background. Building that graph from a scene with
+    QNodeViewEditor::save() is not part of this and still walks every item
+    on the calling thread. Saves are written one at a time in request order, and
+    saved() is emitted as each one completes.
+*/
+class QNodeViewGraphWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QNodeViewGraphWriter(QObject* parent = NULL);
+    virtual ~QNodeViewGraphWriter();
+
+    void save(const QNodeViewGraph& graph, const QString& fileName, bool compressed = false);
+
+    bool isBusy() const;
+    void waitForDone();
+
+signals:
+    void saved(const QString& fileName, bool success, const QString& errorString);
+
+private:
+    QThreadPool m_pool;
+    QAtomicInt m_pending;
+};
@@ -0,0 +1,243 @@
+/*!
+  @file    QNodeViewGroup.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QGraphicsScene>
+#include <QSet>
+
+#include <QNodeViewGroup.h>
+#include <QNodeViewGraph.h>
+#include <QNodeViewPort.h>
+#include <QNodeViewConnection.h>
+
+QNodeViewGroup::QNodeViewGroup(QGraphicsItem* parent)
+: QNodeViewBlock(parent)
+, m_titlePort(NULL)
+, m_collapsed(false)
+, m_loadedCollapsed(false)
+{
+    // An expanded group has no visual of its own, the members are shown instead
+    setVisible(false);
+}
+
+QNodeViewGroup::~QNodeViewGroup()
+{
+    clearProxyPorts();
+
+    Q_FOREACH (QNodeViewBlock* block, m_members)
+    {
+        block->setGroup(NULL);
+
+        // Collapsed members are not owned by the scene, so release them here
+        if (m_collapsed)
+            delete block;
+    }
+}
+
+void QNodeViewGroup::setName(const QString& name)
+{
+    m_name = name;
+
+    if (m_titlePort)
+    {
+        m_titlePort->setName(name);
+        updateLayout();
+    }
+    else
+    {
+        m_titlePort = addPort(name, false, QNodeViewPortLabel_Name);
+    }
+}
+
+void QNodeViewGroup::addMember(QNodeViewBlock* block)
+{
+    Q_ASSERT(!m_collapsed);
+    Q_ASSERT(block->group() == NULL);
+
+    m_members.append(block);
+    block->setGroup(this);
+}
+
+void QNodeViewGroup::removeMember(QNodeViewBlock* block)
+{
+    m_members.removeAll(block);
+    block->setGroup(NULL);
+}
+
+void QNodeViewGroup::collapse()
+{
+    if (m_collapsed || m_members.isEmpty())
+        return;
+
+    QGraphicsScene* groupScene = scene();
+    Q_ASSERT(groupScene);
+
+    const QSet<QNodeViewBlock*> memberSet = m_members.toSet();
+
+    QPointF center;
+    Q_FOREACH (QNodeViewBlock* block, m_members)
+        center += block->pos();
+
+    center /= m_members.size();
+    m_collapsedPosition = center;
+    setPos(center);
+
+    QSet<QNodeViewConnection*> hiddenConnections;
+
+    Q_FOREACH (QNodeViewBlock* block, m_members)
+    {
+        Q_FOREACH (QNodeViewPort* port, block->ports())
+        {
+            bool boundary = false;
+
+            Q_FOREACH (QNodeViewConnection* connection, port->connections())
+            {
+                QNodeViewPort* other = (connection->startPort() == port) ? connection->endPort() : connection->startPort();
+
+                if (other && memberSet.contains(other->block()))
+                    hiddenConnections.insert(connection);
+                else
+                    boundary = true;
+            }
+
+            if (boundary)
+            {
+                QNodeViewPort* proxy = createPort(port->portName(), port->isOutput(), port->portFlags(), 0, port->typeId());
+                port->setProxy(proxy);
+                m_proxyPorts.append(proxy);
+            }
+        }
+    }
+
+    m_hiddenConnections = hiddenConnections.toList();
+
+    // Pull everything inside the group out of the scene index entirely
+    Q_FOREACH (QNodeViewConnection* connection, m_hiddenConnections)
+    {
+        Q_FOREACH (QNodeViewConnectionSplit* split, connection->splits())
+            groupScene->removeItem(split);
+
+        groupScene->removeItem(connection);
+    }
+
+    Q_FOREACH (QNodeViewBlock* block, m_members)
+        groupScene->removeItem(block);
+
+    m_collapsed = true;
+    setVisible(true);
+    updateLayout();
+
+    Q_FOREACH (QNodeViewPort* proxy, m_proxyPorts)
+        proxy->updateConnections();
+}
+
+void QNodeViewGroup::expand()
+{
+    if (!m_collapsed)
+        return;
+
+    QGraphicsScene* groupScene = scene();
+    Q_ASSERT(groupScene);
+
+    // Members follow the group if it was moved while collapsed
+    const QPointF offset = pos() - m_collapsedPosition;
+
+    clearProxyPorts();
+
+    Q_FOREACH (QNodeViewBlock* block, m_members)
+    {
+        block->moveBy(offset.x(), offset.y());
+        groupScene->addItem(block);
+    }
+
+    Q_FOREACH (QNodeViewConnection* connection, m_hiddenConnections)
+    {
+        groupScene->addItem(connection);
+
+        Q_FOREACH (QNodeViewConnectionSplit* split, connection->splits())
+        {
+            groupScene->addItem(split);
+            split->setSplitPosition(split->splitPosition() + offset);
+        }
+    }
+
+    m_hiddenConnections.clear();
+    m_collapsed = false;
+    setVisible(false);
+
+    Q_FOREACH (QNodeViewBlock* block, m_members)
+    {
+        // Hidden rows of virtualized members go back to their own "more" anchors
+        block->updatePortRows();
+
+        Q_FOREACH (QNodeViewPort* port, block->ports())
+            port->updateConnections();
+    }
+}
+
+void QNodeViewGroup::save(QNodeViewGraphGroup& record)
+{
+    record.position = pos();
+    record.name = m_name;
+    record.collapsed = m_collapsed;
+
+    record.members.resize(m_members.size());
+
+    for (qint32 index = 0; index < m_members.size(); ++index)
+        m_members[index]->save(record.members[index]);
+}
+
+void QNodeViewGroup::load(const QNodeViewGraphGroup& record, QMap<quint64, QNodeViewPort*>& portMap, const QVector<quint16>& typeMap, const QVector<quint16>& nodeTypeMap, const QSet<quint64>& connectedPorts)
+{
+    m_loadedPosition = record.position;
+    m_loadedCollapsed = record.collapsed;
+    setName(record.name);
+
+    Q_FOREACH (const QNodeViewGraphBlock& blockRecord, record.members)
+    {
+        QNodeViewBlock* block = new QNodeViewBlock(NULL);
+        scene()->addItem(block);
+        block->load(blockRecord, portMap, typeMap, nodeTypeMap, connectedPorts);
+        addMember(block);
+    }
+}
+
+void QNodeViewGroup::completeLoad()
+{
+    // Collapsing needs the connections, which are loaded after all blocks
+    if (m_loadedCollapsed)
+    {
+        collapse();
+        setPos(m_loadedPosition);
+    }
+}
+
+void QNodeViewGroup::clearProxyPorts()
+{
+    Q_FOREACH (QNodeViewPort* proxy, m_proxyPorts)
+    {
+        Q_FOREACH (QNodeViewPort* port, proxy->proxiedPorts())
+            port->setProxy(NULL);
+
+        delete proxy;
+    }
+
+    m_proxyPorts.clear();
+}
@@ -0,0 +1,78 @@
+/*!
+  @file    QNodeViewGroup.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QNodeViewBlock.h>
+
+class QNodeViewConnection;
+struct QNodeViewGraphGroup;
+
+/*!
+    A group is a proxy block standing in for a set of member blocks.
+
+    While collapsed, the members and the connections between them are removed
+    from the scene entirely, and every member port with a connection leaving
+    the group is exposed through a proxy port on the group. While expanded,
+    the group itself is hidden and the members are live scene items again.
+*/
+class QNodeViewGroup : public QNodeViewBlock
+{
+public:
+    QNodeViewGroup(QGraphicsItem* parent = NULL);
+    virtual ~QNodeViewGroup();
+
+    void setName(const QString& name);
+    const QString& name() const { return m_name; }
+
+    void addMember(QNodeViewBlock* block);
+    void removeMember(QNodeViewBlock* block);
+    const QList<QNodeViewBlock*>& members() const { return m_members; }
+
+    void collapse();
+    void expand();
+    bool isCollapsed() const { return m_collapsed; }
+
+    const QList<QNodeViewConnection*>& hiddenConnections() const { return m_hiddenConnections; }
+
+public:
+    void save(QNodeViewGraphGroup& record);
+    void load(const QNodeViewGraphGroup& record, QMap<quint64, QNodeViewPort*>& portMap, const QVector<quint16>& typeMap, const QVector<quint16>& nodeTypeMap, const QSet<quint64>& connectedPorts);
+    void completeLoad();
+
+public:
+    // QGraphicsItem
+    int type() const { return QNodeViewType_Group; }
+
+private:
+    void clearProxyPorts();
+
+private:
+    QList<QNodeViewBlock*> m_members;
+    QList<QNodeViewConnection*> m_hiddenConnections;
+    QList<QNodeViewPort*> m_proxyPorts;
+    QNodeViewPort* m_titlePort;
+    QString m_name;
+    QPointF m_collapsedPosition;
+    QPointF m_loadedPosition;
+    bool m_collapsed;
+    bool m_loadedCollapsed;
+};
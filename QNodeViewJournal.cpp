@@ -0,0 +1,407 @@
+/*!
+  @file    QNodeViewJournal.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <QNodeViewJournal.h>
+
+namespace
+{
+    const quint32 s_journalMagic = 0x514E564A; // "QNVJ"
+    const qint32 s_journalVersion = 2;
+    const qint64 s_headerSize = 4 + 4 + 8 + 8;
+    const qint64 s_frameHeaderSize = 4 + 2;
+
+    // Identifies the exact snapshot file a journal applies to
+    struct SnapshotStamp
+    {
+        qint64 size;
+        qint64 modified;
+    };
+
+    SnapshotStamp snapshotStamp(const QString& fileName)
+    {
+        const QFileInfo info(fileName);
+        SnapshotStamp stamp = { -1, 0 };
+
+        if (info.exists())
+        {
+            stamp.size = info.size();
+            stamp.modified = info.lastModified().toMSecsSinceEpoch();
+        }
+
+        return stamp;
+    }
+
+    QByteArray encodeHeader(const SnapshotStamp& stamp)
+    {
+        QByteArray header;
+        QDataStream stream(&header, QIODevice::WriteOnly);
+        stream << s_journalMagic << s_journalVersion << stamp.size << stamp.modified;
+        return header;
+    }
+
+    QByteArray encodeFrame(const QNodeViewJournalRecord& record)
+    {
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream << record.operation << record.startPort << record.endPort << record.index << record.position;
+
+        if (record.operation == QNodeViewJournal_AddBlock)
+        {
+            stream << record.nodeType << record.title << qint32(record.ports.size());
+
+            for (qint32 index = 0; index < record.ports.size(); ++index)
+            {
+                const QNodeViewGraphPort& port = record.ports[index];
+                stream << port.id << port.name << port.isOutput << port.flags << record.portTypes.value(index);
+            }
+        }
+
+        // Length and checksum let a torn write at the end be told apart from a record
+        QByteArray frame;
+        QDataStream frameStream(&frame, QIODevice::WriteOnly);
+        frameStream << quint32(payload.size()) << qChecksum(payload.constData(), payload.size());
+        frame.append(payload);
+        return frame;
+    }
+
+    bool decodeRecord(const QByteArray& payload, QNodeViewJournalRecord& record, qint32 version)
+    {
+        QDataStream stream(payload);
+        stream >> record.operation >> record.startPort >> record.endPort >> record.index >> record.position;
+
+        if (record.operation == QNodeViewJournal_AddBlock)
+        {
+            qint32 count;
+            stream >> record.nodeType;
+
+            // Version 1 journals predate block titles
+            if (version >= 2)
+                stream >> record.title;
+
+            stream >> count;
+
+            if (stream.status() != QDataStream::Ok || count < 0)
+                return false;
+
+            record.ports.resize(count);
+
+            for (qint32 index = 0; index < count; ++index)
+            {
+                QNodeViewGraphPort& port = record.ports[index];
+                QString typeName;
+                stream >> port.id >> port.name >> port.isOutput >> port.flags >> typeName;
+                record.portTypes.append(typeName);
+            }
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    // Reads every intact record, reporting how much of the file they cover
+    bool scan(QIODevice& device, const SnapshotStamp& expected, qint32 oldestVersion, QVector<QNodeViewJournalRecord>* records, qint64& validSize, QString* errorString)
+    {
+        QDataStream stream(&device);
+
+        quint32 magic;
+        qint32 version;
+        SnapshotStamp stamp;
+        stream >> magic >> version >> stamp.size >> stamp.modified;
+
+        if (stream.status() != QDataStream::Ok || magic != s_journalMagic || version < oldestVersion || version > s_journalVersion)
+        {
+            if (errorString)
+                *errorString = QObject::tr("Not a supported journal");
+
+            return false;
+        }
+
+        if (stamp.size != expected.size || stamp.modified != expected.modified)
+        {
+            if (errorString)
+                *errorString = QObject::tr("Journal belongs to a different version of the file");
+
+            return false;
+        }
+
+        validSize = s_headerSize;
+
+        while (!device.atEnd())
+        {
+            quint32 size;
+            quint16 checksum;
+            stream >> size >> checksum;
+
+            if (stream.status() != QDataStream::Ok)
+                break;
+
+            const QByteArray payload = device.read(size);
+            if (quint32(payload.size()) != size || qChecksum(payload.constData(), payload.size()) != checksum)
+                break;
+
+            QNodeViewJournalRecord record;
+            if (!decodeRecord(payload, record, version))
+                break;
+
+            if (records)
+                records->append(record);
+
+            validSize += s_frameHeaderSize + size;
+        }
+
+        return true;
+    }
+
+    bool syncFile(QFileDevice& file)
+    {
+        if (!file.flush())
+            return false;
+
+#ifdef Q_OS_WIN
+        return _commit(file.handle()) == 0;
+#else
+        return fsync(file.handle()) == 0;
+#endif
+    }
+}
+
+QNodeViewJournal::QNodeViewJournal()
+: m_writeScheduled(false)
+, m_sequence(0)
+{
+    // A single worker keeps records and compactions in order
+    m_pool.setMaxThreadCount(1);
+}
+
+QNodeViewJournal::~QNodeViewJournal()
+{
+    close();
+}
+
+QString QNodeViewJournal::fileName(const QString& snapshotFileName)
+{
+    return snapshotFileName + ".journal";
+}
+
+bool QNodeViewJournal::read(const QString& snapshotFileName, QVector<QNodeViewJournalRecord>& records, QString* errorString)
+{
+    records.clear();
+
+    QFile file(fileName(snapshotFileName));
+    if (!file.exists())
+        return true;
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (errorString)
+            *errorString = file.errorString();
+
+        return false;
+    }
+
+    qint64 validSize = 0;
+    return scan(file, snapshotStamp(snapshotFileName), 1, &records, validSize, errorString);
+}
+
+bool QNodeViewJournal::open(const QString& snapshotFileName, QString* errorString)
+{
+    close();
+
+    m_file.setFileName(fileName(snapshotFileName));
+
+    qint64 validSize = 0;
+    bool resume = false;
+
+    // Older journals are still read, but new records are never appended to them
+    if (m_file.open(QIODevice::ReadWrite))
+        resume = scan(m_file, snapshotStamp(snapshotFileName), s_journalVersion, NULL, validSize, NULL);
+
+    if (resume)
+    {
+        // Drop whatever a crash left half written
+        resume = m_file.resize(validSize) && m_file.seek(validSize);
+    }
+    else if (m_file.isOpen())
+    {
+        const QByteArray header = encodeHeader(snapshotStamp(snapshotFileName));
+        resume = m_file.resize(0) && m_file.write(header) == header.size() && syncFile(m_file);
+    }
+
+    if (!resume)
+    {
+        if (errorString)
+            *errorString = m_file.errorString();
+
+        m_file.close();
+        return false;
+    }
+
+    m_snapshotFileName = snapshotFileName;
+    m_sequence = 0;
+    m_written.clear();
+    setError(QString());
+    return true;
+}
+
+void QNodeViewJournal::close()
+{
+    waitForDone();
+
+    m_file.close();
+    m_written.clear();
+    m_snapshotFileName.clear();
+    m_sequence = 0;
+}
+
+void QNodeViewJournal::append(const QNodeViewJournalRecord& record)
+{
+    if (!isOpen())
+        return;
+
+    const Frame frame(++m_sequence, encodeFrame(record));
+
+    QMutexLocker locker(&m_mutex);
+    m_pending.append(frame);
+
+    // Records that arrive while a write is in flight are picked up by that write
+    if (!m_writeScheduled)
+    {
+        m_writeScheduled = true;
+        QtConcurrent::run(&m_pool, [this]() { writePending(); });
+    }
+}
+
+void QNodeViewJournal::compact(const QString& snapshotFileName, qint64 sequence)
+{
+    if (!isOpen())
+        return;
+
+    const QString previousFileName = m_snapshotFileName;
+    m_snapshotFileName = snapshotFileName;
+
+    QtConcurrent::run(&m_pool, [this, snapshotFileName, previousFileName, sequence]()
+    {
+        rewrite(snapshotFileName, sequence);
+
+        // After a save under a new name the old journal's edits live in the new snapshot
+        if (previousFileName != snapshotFileName)
+            QFile::remove(fileName(previousFileName));
+    });
+}
+
+QString QNodeViewJournal::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+void QNodeViewJournal::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+void QNodeViewJournal::writePending()
+{
+    for (;;)
+    {
+        QVector<Frame> frames;
+
+        {
+            QMutexLocker locker(&m_mutex);
+            frames.swap(m_pending);
+
+            if (frames.isEmpty())
+            {
+                m_writeScheduled = false;
+                return;
+            }
+        }
+
+        QByteArray batch;
+        Q_FOREACH (const Frame& frame, frames)
+            batch.append(frame.second);
+
+        // One sync per batch keeps the cost independent of the edit rate
+        if (m_file.write(batch) != batch.size() || !syncFile(m_file))
+            setError(m_file.errorString());
+
+        m_written += frames;
+    }
+}
+
+void QNodeViewJournal::rewrite(const QString& snapshotFileName, qint64 sequence)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_written += m_pending;
+        m_pending.clear();
+    }
+
+    QVector<Frame> retained;
+    Q_FOREACH (const Frame& frame, m_written)
+    {
+        if (frame.first > sequence)
+            retained.append(frame);
+    }
+
+    m_written = retained;
+    m_file.close();
+
+    QSaveFile file(fileName(snapshotFileName));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        setError(file.errorString());
+        return;
+    }
+
+    file.write(encodeHeader(snapshotStamp(snapshotFileName)));
+
+    Q_FOREACH (const Frame& frame, m_written)
+        file.write(frame.second);
+
+    if (!syncFile(file) || !file.commit())
+    {
+        setError(file.errorString());
+        return;
+    }
+
+    m_file.setFileName(fileName(snapshotFileName));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append))
+        setError(m_file.errorString());
+}
+
+void QNodeViewJournal::setError(const QString& errorString)
+{
+    QMutexLocker locker(&m_mutex);
+    m_errorString = errorString;
+}
@@ -0,0 +1,131 @@
+/*!
+  @file    QNodeViewJournal.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QPair>
+#include <QThreadPool>
+
+#include <QNodeViewGraph.h>
+
+enum QNodeViewJournalOperation
+{
+    QNodeViewJournal_Connect        = 1,
+    QNodeViewJournal_Disconnect     = 2,
+    QNodeViewJournal_AddBlock       = 3,
+    QNodeViewJournal_DeleteBlock    = 4,
+    QNodeViewJournal_MoveBlock      = 5,
+    QNodeViewJournal_AddSplit       = 6,
+    QNodeViewJournal_RemoveSplit    = 7,
+    QNodeViewJournal_MoveSplit      = 8
+};
+
+/*!
+    One edit, addressed by stable port ids.
+
+    Connections are identified by their start and end port, splits by their
+    index along a connection, and blocks by the id of their first port since
+    blocks have no id of their own in the file format.
+*/
+struct QNodeViewJournalRecord
+{
+    QNodeViewJournalRecord() : operation(0), startPort(0), endPort(0), index(0) {}
+
+    qint32 operation;
+    quint64 startPort;      // Also the block for block operations
+    quint64 endPort;
+    qint32 index;
+    QPointF position;
+
+    // Only for AddBlock; port types are stored by name, custom ports only
+    QString nodeType;
+    QString title;
+    QVector<QNodeViewGraphPort> ports;
+    QStringList portTypes;
+};
+
+/*!
+    Append-only log of edits made since the last full save of a graph.
+
+    Records are encoded on the calling thread and written, flushed and synced
+    to disk in batches by a background worker, so edits never wait on the
+    disk. The journal is stamped with the size and modification time of the
+    snapshot it applies to, and a torn record at the end left by a crash is
+    ignored and truncated away on the next open.
+
+    compact() folds the journal into a newly written snapshot: only records
+    appended after the snapshot was taken are kept.
+*/
+class QNodeViewJournal
+{
+public:
+    QNodeViewJournal();
+    ~QNodeViewJournal();
+
+    static QString fileName(const QString& snapshotFileName);
+
+    // Records logged against the snapshot, none if there is no journal or it belongs to an older snapshot
+    static bool read(const QString& snapshotFileName, QVector<QNodeViewJournalRecord>& records, QString* errorString = NULL);
+
+    // Continues a journal that matches the snapshot, otherwise starts an empty one
+    bool open(const QString& snapshotFileName, QString* errorString = NULL);
+    void close();
+
+    bool isOpen() const { return !m_snapshotFileName.isEmpty(); }
+    const QString& snapshotFileName() const { return m_snapshotFileName; }
+
+    void append(const QNodeViewJournalRecord& record);
+
+    // Number of records appended since open, used to mark where a snapshot was taken
+    qint64 sequence() const { return m_sequence; }
+
+    // Call once a snapshot taken at the given sequence has been written
+    void compact(const QString& snapshotFileName, qint64 sequence);
+
+    QString errorString() const;
+    void waitForDone();
+
+private:
+    typedef QPair<qint64, QByteArray> Frame;
+
+    void writePending();
+    void rewrite(const QString& snapshotFileName, qint64 sequence);
+    void setError(const QString& errorString);
+
+private:
+    QThreadPool m_pool;
+
+    mutable QMutex m_mutex;
+    QVector<Frame> m_pending;
+    QString m_errorString;
+    bool m_writeScheduled;
+
+    // Caller thread
+    QString m_snapshotFileName;
+    qint64 m_sequence;
+
+    // Worker thread, records written since the last compaction
+    QFile m_file;
+    QVector<Frame> m_written;
+};
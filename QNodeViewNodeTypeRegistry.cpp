@@ -0,0 +1,176 @@
+/*!
+  @file    QNodeViewNodeTypeRegistry.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QFontMetrics>
+
+#include <QNodeViewNodeTypeRegistry.h>
+#include <QNodeViewPortTypeRegistry.h>
+#include <QNodeViewPort.h>
+
+// Space between the port labels and the block edge, and above the first row
+static const qint32 s_horizontalMargin = 20;
+static const qint32 s_verticalMargin = 5;
+
+QNodeViewNodeLayout::QNodeViewNodeLayout()
+: width(0)
+, height(0)
+{
+}
+
+void QNodeViewNodeLayout::build(const QFont& sceneFont, qint32 minimumWidth)
+{
+    QFontMetrics fontMetrics(sceneFont);
+    const qint32 rowHeight = fontMetrics.height();
+    const qint32 radius = QNodeViewPort::defaultRadius();
+
+    font   = sceneFont;
+    width  = minimumWidth;
+    height = s_verticalMargin;
+
+    for (qint32 index = 0; index < ports.size(); ++index)
+    {
+        const qint32 nameWidth = fontMetrics.width(ports[index].name);
+
+        if (nameWidth > width - s_horizontalMargin)
+            width = nameWidth + s_horizontalMargin;
+
+        height += rowHeight;
+    }
+
+    path = QPainterPath();
+    path.addRoundedRect(-(width >> 1), -(height >> 1), width, height, 5, 5);
+
+    qint32 y = -(height >> 1) + s_verticalMargin;
+
+    for (qint32 index = 0; index < ports.size(); ++index)
+    {
+        QNodeViewPortLayout& port = ports[index];
+
+        if (port.isOutput)
+            port.position = QPointF((width >> 1) + radius, y + radius);
+        else
+            port.position = QPointF(-(width >> 1) - radius, y + radius);
+
+        port.labelFont = QNodeViewPort::labelFont(port.flags, sceneFont);
+        port.labelRect = QNodeViewPort::labelGeometry(port.labelFont, port.name, port.isOutput);
+
+        y += rowHeight;
+    }
+}
+
+bool QNodeViewNodeLayout::fits(const QString& name) const
+{
+    return QFontMetrics(font).width(name) <= width - s_horizontalMargin;
+}
+
+QNodeViewNodeType::QNodeViewNodeType(quint16 id, const QNodeViewNodeDescriptor& descriptor)
+: m_name(QString::fromUtf8(descriptor.name))
+, m_id(id)
+, m_layoutValid(false)
+{
+    m_layout.ports.resize(descriptor.portCount);
+
+    for (qint32 index = 0; index < descriptor.portCount; ++index)
+    {
+        const QNodeViewPortDescriptor& portDescriptor = descriptor.ports[index];
+        QNodeViewPortLayout& port = m_layout.ports[index];
+
+        port.name     = QString::fromUtf8(portDescriptor.name);
+        port.isOutput = portDescriptor.isOutput;
+        port.flags    = portDescriptor.flags;
+        port.typeId   = portDescriptor.typeName ? QNodeViewPortTypeRegistry::registerType(QString::fromUtf8(portDescriptor.typeName)) : QNodeViewPortTypeRegistry::AnyType;
+
+        port.label.setTextFormat(Qt::PlainText);
+        port.label.setText(port.name);
+    }
+}
+
+const QNodeViewNodeLayout& QNodeViewNodeType::layout(const QFont& font)
+{
+    if (m_layoutValid && m_layout.font == font)
+        return m_layout;
+
+    m_layout.build(font, 100);
+
+    for (qint32 index = 0; index < m_layout.ports.size(); ++index)
+    {
+        QNodeViewPortLayout& port = m_layout.ports[index];
+        port.label.prepare(QTransform(), port.labelFont);
+    }
+
+    m_layoutValid = true;
+    return m_layout;
+}
+
+QNodeViewNodeTypeRegistry::QNodeViewNodeTypeRegistry()
+{
+    // Slot 0 stands for custom blocks and has no type behind it
+    m_types.append(NULL);
+}
+
+QNodeViewNodeTypeRegistry::~QNodeViewNodeTypeRegistry()
+{
+    qDeleteAll(m_types);
+}
+
+QNodeViewNodeTypeRegistry& QNodeViewNodeTypeRegistry::instance()
+{
+    static QNodeViewNodeTypeRegistry registry;
+    return registry;
+}
+
+quint16 QNodeViewNodeTypeRegistry::registerType(const QNodeViewNodeDescriptor& descriptor)
+{
+    QNodeViewNodeTypeRegistry& registry = instance();
+
+    const QString name = QString::fromUtf8(descriptor.name);
+
+    QHash<QString, quint16>::const_iterator existing = registry.m_ids.constFind(name);
+    if (existing != registry.m_ids.constEnd())
+        return existing.value();
+
+    Q_ASSERT(registry.m_types.size() < 0xffff);
+
+    const quint16 id = quint16(registry.m_types.size());
+    registry.m_types.append(new QNodeViewNodeType(id, descriptor));
+    registry.m_ids.insert(name, id);
+    return id;
+}
+
+quint16 QNodeViewNodeTypeRegistry::typeId(const QString& name)
+{
+    return instance().m_ids.value(name, CustomType);
+}
+
+QNodeViewNodeType* QNodeViewNodeTypeRegistry::nodeType(quint16 id)
+{
+    return instance().m_types.value(id);
+}
+
+QStringList QNodeViewNodeTypeRegistry::typeNames()
+{
+    QStringList names;
+
+    Q_FOREACH (QNodeViewNodeType* type, instance().m_types)
+        names.append(type ? type->name() : QString());
+
+    return names;
+}
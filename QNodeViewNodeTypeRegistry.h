@@ -0,0 +1,150 @@
+/*!
+  @file    QNodeViewNodeTypeRegistry.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QFont>
+#include <QHash>
+#include <QPainterPath>
+#include <QPointF>
+#include <QRectF>
+#include <QStaticText>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+    Compile-time description of a single port on a node type.
+
+    A null typeName declares an untyped port.
+*/
+struct QNodeViewPortDescriptor
+{
+    const char* name;
+    bool isOutput;
+    qint32 flags;
+    const char* typeName;
+};
+
+/*!
+    Compile-time description of a node type, declared as a constexpr table:
+
+        static constexpr QNodeViewPortDescriptor s_addPorts[] =
+        {
+            { "Add",    false, QNodeViewPortLabel_Name, nullptr },
+            { "A",      false, 0,                       "Float" },
+            { "B",      false, 0,                       "Float" },
+            { "Result", true,  0,                       "Float" }
+        };
+
+        static constexpr QNodeViewNodeDescriptor s_add = qNodeViewNodeDescriptor("Add", s_addPorts);
+*/
+struct QNodeViewNodeDescriptor
+{
+    const char* name;
+    const QNodeViewPortDescriptor* ports;
+    qint32 portCount;
+};
+
+template <qint32 PortCount>
+constexpr QNodeViewNodeDescriptor qNodeViewNodeDescriptor(const char* name, const QNodeViewPortDescriptor (&ports)[PortCount])
+{
+    return QNodeViewNodeDescriptor { name, ports, PortCount };
+}
+
+struct QNodeViewPortLayout
+{
+    QString name;
+    bool isOutput;
+    qint32 flags;
+    quint16 typeId;
+
+    QPointF position;
+    QFont labelFont;
+    QRectF labelRect;
+    QStaticText label;
+};
+
+/*!
+    Block geometry for an ordered list of ports.
+
+    QNodeViewBlock::updateLayout() builds one of these for hand-assembled
+    blocks; node types build theirs once per font and share it.
+*/
+struct QNodeViewNodeLayout
+{
+    QNodeViewNodeLayout();
+
+    void build(const QFont& font, qint32 minimumWidth);
+
+    // Whether a row renamed to name would still fit the built width
+    bool fits(const QString& name) const;
+
+    QVector<QNodeViewPortLayout> ports;
+    QPainterPath path;
+    QFont font;
+    qint32 width;
+    qint32 height;
+};
+
+class QNodeViewNodeType
+{
+public:
+    QNodeViewNodeType(quint16 id, const QNodeViewNodeDescriptor& descriptor);
+
+    quint16 id() const { return m_id; }
+    const QString& name() const { return m_name; }
+
+    // Built on first use and rebuilt only when the scene font changes
+    const QNodeViewNodeLayout& layout(const QFont& font);
+
+private:
+    QNodeViewNodeLayout m_layout;
+    QString m_name;
+    quint16 m_id;
+    bool m_layoutValid;
+};
+
+/*!
+    Registered node types, addressed by small integer ids.
+
+    Id 0 is reserved for blocks assembled port by port with addPort(), which
+    do not share a layout.
+*/
+class QNodeViewNodeTypeRegistry
+{
+public:
+    static const quint16 CustomType = 0;
+
+    static quint16 registerType(const QNodeViewNodeDescriptor& descriptor);
+    static quint16 typeId(const QString& name);
+    static QNodeViewNodeType* nodeType(quint16 id);
+    static QStringList typeNames();
+
+private:
+    QNodeViewNodeTypeRegistry();
+    ~QNodeViewNodeTypeRegistry();
+    static QNodeViewNodeTypeRegistry& instance();
+
+private:
+    QHash<QString, quint16> m_ids;
+    QVector<QNodeViewNodeType*> m_types;
+};
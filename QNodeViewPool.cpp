@@ -0,0 +1,55 @@
+/*!
+  @file    QNodeViewPool.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QNodeViewPool.h>
+
+QNodeViewPoolBase::QNodeViewPoolBase(const char* name)
+: m_name(name)
+{
+    pools().append(this);
+}
+
+QNodeViewPoolBase::~QNodeViewPoolBase()
+{
+    pools().removeAll(this);
+}
+
+void QNodeViewPoolBase::trimAll()
+{
+    Q_FOREACH (QNodeViewPoolBase* pool, pools())
+        pool->trim();
+}
+
+QVector<QNodeViewPoolBase::Statistics> QNodeViewPoolBase::allStatistics()
+{
+    QVector<Statistics> result;
+
+    Q_FOREACH (QNodeViewPoolBase* pool, pools())
+        result.append(pool->statistics());
+
+    return result;
+}
+
+QVector<QNodeViewPoolBase*>& QNodeViewPoolBase::pools()
+{
+    static QVector<QNodeViewPoolBase*> registry;
+    return registry;
+}
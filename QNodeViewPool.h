@@ -0,0 +1,172 @@
+/*!
+  @file    QNodeViewPool.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QVector>
+
+#include <new>
+#include <type_traits>
+
+/*!
+    Bookkeeping shared by all QNodeViewPool instances, so pools of
+    different types can be trimmed and inspected together.
+*/
+class QNodeViewPoolBase
+{
+public:
+    struct Statistics
+    {
+        const char* name;
+        qint64 allocations;
+        qint64 deallocations;
+        qint32 live;
+        qint32 slabs;
+        qint32 objectSize;
+    };
+
+    explicit QNodeViewPoolBase(const char* name);
+    virtual ~QNodeViewPoolBase();
+
+    virtual void trim() = 0;
+    virtual Statistics statistics() const = 0;
+
+    // Releases every pool with no live objects, e.g. after a scene clear
+    static void trimAll();
+    static QVector<Statistics> allStatistics();
+
+protected:
+    const char* m_name;
+
+private:
+    static QVector<QNodeViewPoolBase*>& pools();
+};
+
+/*!
+    Fixed size object pool for one class, used through class-level
+    operator new and delete.
+
+    Objects are carved out of slabs of SlabSize slots, so bulk creation and
+    destruction walk contiguous memory and never reach the global heap once
+    the pool is warm. Slabs are only returned to the heap by trim(), which
+    does nothing while any object is still alive. Requests for any other
+    size, such as from a derived class, go to the global heap. Pools are not
+    thread safe and belong to the GUI thread, like the items using them.
+*/
+template <typename T, qint32 SlabSize = 256>
+class QNodeViewPool : public QNodeViewPoolBase
+{
+public:
+    explicit QNodeViewPool(const char* name)
+    : QNodeViewPoolBase(name)
+    , m_freeList(NULL)
+    , m_allocations(0)
+    , m_deallocations(0)
+    , m_live(0)
+    {
+    }
+
+    ~QNodeViewPool()
+    {
+        // Objects outliving the pool keep their slabs
+        trim();
+    }
+
+    void* allocate(size_t size)
+    {
+        if (size != sizeof(T))
+            return ::operator new(size);
+
+        if (!m_freeList)
+            grow();
+
+        Slot* slot = m_freeList;
+        m_freeList = slot->next;
+
+        ++m_allocations;
+        ++m_live;
+        return slot;
+    }
+
+    void deallocate(void* pointer, size_t size)
+    {
+        if (!pointer)
+            return;
+
+        if (size != sizeof(T))
+        {
+            ::operator delete(pointer);
+            return;
+        }
+
+        Slot* slot = static_cast<Slot*>(pointer);
+        slot->next = m_freeList;
+        m_freeList = slot;
+
+        ++m_deallocations;
+        --m_live;
+    }
+
+    void trim()
+    {
+        if (m_live != 0)
+            return;
+
+        Q_FOREACH (Slot* slab, m_slabs)
+            ::operator delete(slab);
+
+        m_slabs.clear();
+        m_freeList = NULL;
+    }
+
+    Statistics statistics() const
+    {
+        Statistics result = { m_name, m_allocations, m_deallocations, m_live, m_slabs.size(), qint32(sizeof(T)) };
+        return result;
+    }
+
+private:
+    union Slot
+    {
+        Slot* next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    void grow()
+    {
+        Slot* slab = static_cast<Slot*>(::operator new(sizeof(Slot) * SlabSize));
+        m_slabs.append(slab);
+
+        // Thread the free list front to back so allocations walk the slab in order
+        for (qint32 index = SlabSize - 1; index >= 0; --index)
+        {
+            slab[index].next = m_freeList;
+            m_freeList = &slab[index];
+        }
+    }
+
+private:
+    QVector<Slot*> m_slabs;
+    Slot* m_freeList;
+    qint64 m_allocations;
+    qint64 m_deallocations;
+    qint32 m_live;
+};
@@ -22,22 +22,62 @@
 #include <QGraphicsScene>
 #include <QFontMetrics>
 #include <QPen>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QVarLengthArray>
+
+#include <random>
 
 #include <QNodeViewPort.h>
 #include <QNodeViewConnection.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewCanvas.h>
+#include <QNodeViewNodeTypeRegistry.h>
+#include <QNodeViewPool.h>
+#include <QNodeViewProbeSampler.h>
+#include <QNodeViewTrace.h>
+
+// Gap between the label and the port, matching the old text item document margin
+static const qreal s_labelMargin = 4.0;
+
+static const qint32 s_radius = 5;
+static const qint32 s_margin = 2;
+
+// Probe display outside the block, the sparkline draws one pixel per column
+static const qreal s_sparklineWidth = QNodeViewPortProbe::s_columns;
+static const qreal s_probeSpacing = 4.0;
+
+// New ids carry a random per session prefix, so ports added on separate branches of a file never collide
+static quint64 nextPortId()
+{
+    static const quint64 s_sessionPrefix = quint64(std::random_device()()) << 32;
+    static quint32 s_counter = 0;
+    return s_sessionPrefix | ++s_counter;
+}
+
+static QNodeViewPool<QNodeViewPort>& portPool()
+{
+    static QNodeViewPool<QNodeViewPort> pool("QNodeViewPort");
+    return pool;
+}
 
 QNodeViewPort::QNodeViewPort(QGraphicsItem* parent)
 : QGraphicsPathItem(parent)
-, m_radius(5)
-, m_margin(2)
+, m_proxy(NULL)
+, m_probe(NULL)
+, m_id(nextPortId())
+, m_radius(s_radius)
 , m_portFlags(0x0)
+, m_typeId(0)
+, m_isOutput(false)
+, m_highlighted(false)
 {
-    setCacheMode(DeviceCoordinateCache);
+    // Labels are drawn directly so they can be skipped while the canvas is navigating
+    setCacheMode(NoCache);
 
     setFlag(QGraphicsItem::ItemSendsScenePositionChanges);
 
-    m_label = new QGraphicsTextItem(this);
-    m_label->setCacheMode(DeviceCoordinateCache);
+    m_label.setTextFormat(Qt::PlainText);
 
     QPainterPath path;
     path.addEllipse(-m_radius, -m_radius, m_radius * 2, m_radius * 2);
@@ -49,10 +89,31 @@ QNodeViewPort::QNodeViewPort(QGraphicsItem* parent)
 
 QNodeViewPort::~QNodeViewPort()
 {
+    setProxy(NULL);
+
+    Q_FOREACH (QNodeViewPort* port, m_proxiedPorts)
+        port->setProxy(NULL);
+
+    // The sampler drops the probe on its next step
+    if (m_probe)
+        m_probe->port = NULL;
+
+    QNodeViewScene::itemDestroyed(this);
+
     Q_FOREACH (QNodeViewConnection* connection, m_connections)
         delete connection;
 }
 
+void* QNodeViewPort::operator new(size_t size)
+{
+    return portPool().allocate(size);
+}
+
+void QNodeViewPort::operator delete(void* pointer, size_t size)
+{
+    portPool().deallocate(pointer, size);
+}
+
 void QNodeViewPort::setBlock(QNodeViewBlock* block)
 {
     m_block = block;
@@ -61,42 +122,30 @@ void QNodeViewPort::setBlock(QNodeViewBlock* block)
 void QNodeViewPort::setName(const QString& name)
 {
     m_name = name;
-    m_label->setPlainText(name);
+    m_label.setText(name);
+    updateLabel();
+
+    QNodeViewScene::portRenamed(this);
 }
 
 void QNodeViewPort::setIsOutput(bool isOutput)
 {
     m_isOutput = isOutput;
-
-    const qreal boundingWidth = m_label->boundingRect().width();
-    const qreal boundingHalfHeight = m_label->boundingRect().height() / 2;
-
-    if (m_isOutput)
-        m_label->setPos(-m_radius - m_margin - boundingWidth, -boundingHalfHeight);
-	else
-        m_label->setPos(m_radius + m_margin, -boundingHalfHeight);
-
-    m_label->setDefaultTextColor(QColor(155, 155, 155)); // GW-TODO: Expose to QStyle
+    updateLabel();
 }
 
 void QNodeViewPort::setPortFlags(qint32 flags)
 {
     m_portFlags = flags;
 
-    if (m_portFlags & QNodeViewPortLabel_Type)
+    if (m_portFlags & (QNodeViewPortLabel_Type | QNodeViewPortLabel_Name))
     {
-        QFont font(scene()->font());
-        font.setItalic(true);
-        m_label->setFont(font);
-        setPath(QPainterPath());
-    }
-    else if (m_portFlags & QNodeViewPortLabel_Name)
-    {
-        QFont font(scene()->font());
-        font.setBold(true);
-        m_label->setFont(font);
+        m_labelFont = labelFont(m_portFlags, scene()->font());
         setPath(QPainterPath());
+        updateLabel();
     }
+
+    QNodeViewScene::portRenamed(this);
 }
 
 void QNodeViewPort::setIndex(quint64 index)
@@ -104,6 +153,86 @@ void QNodeViewPort::setIndex(quint64 index)
     m_index = index;
 }
 
+void QNodeViewPort::setId(quint64 id)
+{
+    if (m_id == id)
+        return;
+
+    const quint64 previousId = m_id;
+    m_id = id;
+
+    QNodeViewScene::portIdChanged(this, previousId);
+}
+
+void QNodeViewPort::setLayout(const QNodeViewPortLayout& layout)
+{
+    prepareGeometryChange();
+
+    // Everything here is implicitly shared with the node type
+    m_name = layout.name;
+    m_isOutput = layout.isOutput;
+    m_portFlags = layout.flags;
+    m_typeId = layout.typeId;
+    m_labelFont = layout.labelFont;
+    m_labelRect = layout.labelRect;
+    m_label = layout.label;
+
+    if (m_portFlags & (QNodeViewPortLabel_Type | QNodeViewPortLabel_Name))
+        setPath(QPainterPath());
+
+    setPos(layout.position);
+}
+
+void QNodeViewPort::setProxy(QNodeViewPort* proxy)
+{
+    if (m_proxy)
+        m_proxy->m_proxiedPorts.remove(m_proxy->m_proxiedPorts.indexOf(this));
+
+    m_proxy = proxy;
+
+    if (m_proxy)
+        m_proxy->m_proxiedPorts.append(this);
+}
+
+void QNodeViewPort::setProbe(QNodeViewPortProbe* probe)
+{
+    prepareGeometryChange();
+
+    m_probe = probe;
+    m_probeRect = QRectF();
+
+    if (m_probe)
+    {
+        QFontMetricsF fontMetrics(m_labelFont);
+        const qreal width = s_sparklineWidth + s_probeSpacing + fontMetrics.width("-0.000e+00");
+        const qreal height = fontMetrics.height();
+        const qreal offset = s_radius + s_margin + s_labelMargin;
+
+        // Outside the block, on the side the wires come in
+        if (m_isOutput)
+            m_probeRect = QRectF(offset, -height / 2, width, height);
+        else
+            m_probeRect = QRectF(-offset - width, -height / 2, width, height);
+    }
+
+    // The probe widens the port's bounds, so the scene index must see the new rect
+    QNodeViewScene::itemGeometryChanged(this);
+}
+
+void QNodeViewPort::setTypeId(quint16 typeId)
+{
+    m_typeId = typeId;
+}
+
+void QNodeViewPort::setHighlighted(bool highlighted)
+{
+    if (m_highlighted == highlighted)
+        return;
+
+    m_highlighted = highlighted;
+    update();
+}
+
 bool QNodeViewPort::isConnected(QNodeViewPort* other)
 {
     Q_FOREACH (QNodeViewConnection* connection, m_connections)
@@ -141,17 +270,167 @@ quint64 QNodeViewPort::index()
     return m_index;
 }
 
+void QNodeViewPort::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewPort::paint");
+
+    Q_UNUSED(option);
+
+    if (m_highlighted)
+    {
+        painter->setPen(QPen(QColor(240, 200, 80), 2)); // GW-TODO: Expose to QStyle
+        painter->setBrush(QColor(200, 170, 90)); // GW-TODO: Expose to QStyle
+    }
+    else
+    {
+        painter->setPen(pen());
+        painter->setBrush(brush());
+    }
+
+    painter->drawPath(path());
+
+    if (QNodeViewCanvas::isInteracting(widget))
+        return;
+
+    painter->setFont(m_labelFont);
+    painter->setPen(QColor(155, 155, 155)); // GW-TODO: Expose to QStyle
+    painter->drawStaticText(m_labelRect.topLeft(), m_label);
+
+    if (m_probe && m_probe->hasValue)
+        paintProbe(painter);
+}
+
+QRectF QNodeViewPort::boundingRect() const
+{
+    return QGraphicsPathItem::boundingRect().united(m_labelRect).united(m_probeRect);
+}
+
+void QNodeViewPort::paintProbe(QPainter* painter)
+{
+    // The sparkline sits next to the port and the value beyond it
+    QRectF sparklineRect = m_probeRect;
+    QRectF textRect = m_probeRect;
+
+    if (m_isOutput)
+    {
+        sparklineRect.setWidth(s_sparklineWidth);
+        textRect.setLeft(sparklineRect.right() + s_probeSpacing);
+    }
+    else
+    {
+        sparklineRect.setLeft(sparklineRect.right() - s_sparklineWidth);
+        textRect.setRight(sparklineRect.left() - s_probeSpacing);
+    }
+
+    sparklineRect.adjust(0, 2, 0, -2);
+
+    const qint32 count = m_probe->columnCount;
+
+    if (count > 0)
+    {
+        float low = m_probe->minimum[m_probe->firstColumn];
+        float high = m_probe->maximum[m_probe->firstColumn];
+
+        for (qint32 index = 1; index < count; ++index)
+        {
+            const qint32 column = (m_probe->firstColumn + index) % QNodeViewPortProbe::s_columns;
+            low = qMin(low, m_probe->minimum[column]);
+            high = qMax(high, m_probe->maximum[column]);
+        }
+
+        const qreal scale = (high > low) ? sparklineRect.height() / (high - low) : 0.0;
+        const qreal middle = sparklineRect.center().y();
+
+        // Each column spans the minimum to the maximum of the samples decimated into it
+        QVarLengthArray<QLineF, QNodeViewPortProbe::s_columns> lines;
+
+        for (qint32 index = 0; index < count; ++index)
+        {
+            const qint32 column = (m_probe->firstColumn + index) % QNodeViewPortProbe::s_columns;
+            const qreal x = sparklineRect.right() - (count - 1 - index) - 0.5;
+
+            const qreal top = (scale > 0.0) ? sparklineRect.bottom() - (m_probe->maximum[column] - low) * scale : middle;
+            const qreal bottom = (scale > 0.0) ? sparklineRect.bottom() - (m_probe->minimum[column] - low) * scale : middle;
+
+            lines.append(QLineF(x, top, x, qMax(bottom, top + 1.0)));
+        }
+
+        QPen sparklinePen(QColor(110, 180, 120), 1); // GW-TODO: Expose to QStyle
+        sparklinePen.setCosmetic(true);
+        painter->setPen(sparklinePen);
+        painter->drawLines(lines.data(), lines.size());
+    }
+
+    painter->setPen(QColor(200, 200, 200)); // GW-TODO: Expose to QStyle
+    painter->drawText(textRect, (m_isOutput ? Qt::AlignLeft : Qt::AlignRight) | Qt::AlignVCenter, m_probe->text);
+}
+
+void QNodeViewPort::updateLabel()
+{
+    prepareGeometryChange();
+
+    m_labelRect = labelGeometry(m_labelFont, m_name, m_isOutput);
+    m_label.prepare(QTransform(), m_labelFont);
+}
+
+qint32 QNodeViewPort::defaultRadius()
+{
+    return s_radius;
+}
+
+QFont QNodeViewPort::labelFont(qint32 flags, const QFont& sceneFont)
+{
+    QFont font;
+
+    if (flags & QNodeViewPortLabel_Type)
+    {
+        font = sceneFont;
+        font.setItalic(true);
+    }
+    else if (flags & QNodeViewPortLabel_Name)
+    {
+        font = sceneFont;
+        font.setBold(true);
+    }
+
+    return font;
+}
+
+QRectF QNodeViewPort::labelGeometry(const QFont& font, const QString& name, bool isOutput)
+{
+    QFontMetricsF fontMetrics(font);
+    const qreal width = fontMetrics.width(name);
+    const qreal height = fontMetrics.height();
+
+    if (isOutput)
+        return QRectF(-s_radius - s_margin - s_labelMargin - width, -height / 2, width, height);
+
+    return QRectF(s_radius + s_margin + s_labelMargin, -height / 2, width, height);
+}
+
 QVariant QNodeViewPort::itemChange(GraphicsItemChange change, const QVariant &value)
 {
-	if (change == ItemScenePositionHasChanged)
-	{
-        Q_FOREACH (QNodeViewConnection* connection, m_connections)
-		{
-            connection->updatePosition();
-            connection->updatePath();
-            connection->updateSplits();
-		}
-	}
+    QNODEVIEW_TRACE_SCOPE("QNodeViewPort::itemChange");
+
+    QNodeViewScene::itemChanged(this, change);
+
+    // During a batch move the mover updates the connections itself
+	if (change == ItemScenePositionHasChanged && !QNodeViewScene::isBatchMoving(this))
+        updateConnections();
 
 	return value;
 }
+
+void QNodeViewPort::updateConnections()
+{
+    Q_FOREACH (QNodeViewConnection* connection, m_connections)
+    {
+        connection->updatePosition();
+        connection->updatePath();
+        connection->updateSplits();
+    }
+
+    // Ports hidden inside a collapsed group route their wires through this proxy
+    Q_FOREACH (QNodeViewPort* port, m_proxiedPorts)
+        port->updateConnections();
+}
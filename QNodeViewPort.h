@@ -22,10 +22,13 @@
 #pragma once
 
 #include <QGraphicsPathItem>
+#include <QStaticText>
 #include <QNodeViewCommon.h>
 
 class QNodeViewBlock;
 class QNodeViewConnection;
+struct QNodeViewPortLayout;
+struct QNodeViewPortProbe;
 
 class QNodeViewPort : public QGraphicsPathItem
 {
@@ -33,11 +36,20 @@ public:
     QNodeViewPort(QGraphicsItem* parent = NULL);
     virtual ~QNodeViewPort();
 
+    // Allocated from a QNodeViewPool, see QNodeViewPool.h
+    static void* operator new(size_t size);
+    static void operator delete(void* pointer, size_t size);
+
     void setBlock(QNodeViewBlock* block);
     void setName(const QString& name);
     void setIsOutput(bool isOutput);
     void setPortFlags(qint32 index);
     void setIndex(quint64);
+    void setId(quint64 id);
+    void setProxy(QNodeViewPort* proxy);
+    void setTypeId(quint16 typeId);
+    void setHighlighted(bool highlighted);
+    void setLayout(const QNodeViewPortLayout& layout);
 
     bool isConnected(QNodeViewPort*);
     bool isOutput();
@@ -47,26 +59,60 @@ public:
     QNodeViewBlock* block() const;
     quint64 index();
 
+    // Stable for the port's lifetime and kept across save and load, unlike its address
+    quint64 id() const { return m_id; }
+
+    QNodeViewPort* proxy() const { return m_proxy; }
+    QNodeViewPort* anchor() { return m_proxy ? m_proxy : this; }
+    const QVector<QNodeViewPort*>& proxiedPorts() const { return m_proxiedPorts; }
+
+    void updateConnections();
+
+    // Live value shown outside the block next to the port, owned by QNodeViewProbeSampler
+    void setProbe(QNodeViewPortProbe* probe);
+    QNodeViewPortProbe* probe() const { return m_probe; }
+
     const QString& portName() const { return m_name; }
 	int portFlags() const { return m_portFlags; }
+    quint16 typeId() const { return m_typeId; }
+    bool isHighlighted() const { return m_highlighted; }
+
+    static qint32 defaultRadius();
+    static QFont labelFont(qint32 flags, const QFont& sceneFont);
+    static QRectF labelGeometry(const QFont& font, const QString& name, bool isOutput);
 
 public:
     // QGraphicsItem
     int type() const { return QNodeViewType_Port; }
 
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
+    QRectF boundingRect() const;
+
 protected:
     QVariant itemChange(GraphicsItemChange change, const QVariant& value);
 
+private:
+    void updateLabel();
+    void paintProbe(QPainter* painter);
+
 private:
     QVector<QNodeViewConnection*> m_connections;
+    QVector<QNodeViewPort*> m_proxiedPorts;
+    QNodeViewPort* m_proxy;
+    QNodeViewPortProbe* m_probe;
     QString m_name;
     QNodeViewBlock* m_block;
-    QGraphicsTextItem* m_label;
+    QStaticText m_label;
+    QFont m_labelFont;
+    QRectF m_labelRect;
+    QRectF m_probeRect;
 
     quint64 m_index;
+    quint64 m_id;
     qint32 m_radius;
-    qint32 m_margin;
     qint32 m_portFlags;
+    quint16 m_typeId;
 
     bool m_isOutput;
+    bool m_highlighted;
 };
@@ -0,0 +1,90 @@
+/*!
+  @file    QNodeViewPortTypeRegistry.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QNodeViewPortTypeRegistry.h>
+
+QNodeViewPortTypeRegistry::QNodeViewPortTypeRegistry()
+{
+    m_names.append("Any");
+    m_ids.insert("Any", AnyType);
+    m_compatibility.append(QBitArray(1, true));
+}
+
+QNodeViewPortTypeRegistry& QNodeViewPortTypeRegistry::instance()
+{
+    static QNodeViewPortTypeRegistry registry;
+    return registry;
+}
+
+quint16 QNodeViewPortTypeRegistry::registerType(const QString& name)
+{
+    QNodeViewPortTypeRegistry& registry = instance();
+
+    QHash<QString, quint16>::const_iterator existing = registry.m_ids.constFind(name);
+    if (existing != registry.m_ids.constEnd())
+        return existing.value();
+
+    Q_ASSERT(registry.m_names.size() < 0xffff);
+
+    const quint16 id = quint16(registry.m_names.size());
+    registry.m_names.append(name);
+    registry.m_ids.insert(name, id);
+
+    const qint32 count = registry.m_names.size();
+    for (qint32 row = 0; row < registry.m_compatibility.size(); ++row)
+        registry.m_compatibility[row].resize(count);
+
+    // A type always connects to itself
+    registry.m_compatibility.append(QBitArray(count));
+    registry.m_compatibility[id].setBit(id);
+
+    return id;
+}
+
+quint16 QNodeViewPortTypeRegistry::typeId(const QString& name)
+{
+    return instance().m_ids.value(name, AnyType);
+}
+
+QString QNodeViewPortTypeRegistry::typeName(quint16 id)
+{
+    return instance().m_names.value(id);
+}
+
+QStringList QNodeViewPortTypeRegistry::typeNames()
+{
+    return instance().m_names;
+}
+
+qint32 QNodeViewPortTypeRegistry::typeCount()
+{
+    return instance().m_names.size();
+}
+
+void QNodeViewPortTypeRegistry::setCompatible(quint16 outputType, quint16 inputType, bool compatible)
+{
+    QNodeViewPortTypeRegistry& registry = instance();
+
+    Q_ASSERT(outputType < registry.m_compatibility.size());
+    Q_ASSERT(inputType < registry.m_compatibility.size());
+
+    registry.m_compatibility[outputType].setBit(inputType, compatible);
+}
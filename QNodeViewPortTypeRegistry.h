@@ -0,0 +1,68 @@
+/*!
+  @file    QNodeViewPortTypeRegistry.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QBitArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+    Interned port data types.
+
+    Type names map to small integer ids, and compatibility between an output
+    type and an input type is a precomputed bit matrix so that checks done
+    for every visible port during a drag are a single bit test. Id 0 is the
+    untyped "Any" port, which is compatible with everything.
+*/
+class QNodeViewPortTypeRegistry
+{
+public:
+    static const quint16 AnyType = 0;
+
+    static quint16 registerType(const QString& name);
+    static quint16 typeId(const QString& name);
+    static QString typeName(quint16 id);
+    static QStringList typeNames();
+    static qint32 typeCount();
+
+    static void setCompatible(quint16 outputType, quint16 inputType, bool compatible = true);
+
+    static bool isCompatible(quint16 outputType, quint16 inputType)
+    {
+        if (outputType == AnyType || inputType == AnyType)
+            return true;
+
+        const QVector<QBitArray>& matrix = instance().m_compatibility;
+        return outputType < matrix.size() && inputType < matrix.size() && matrix[outputType].testBit(inputType);
+    }
+
+private:
+    QNodeViewPortTypeRegistry();
+    static QNodeViewPortTypeRegistry& instance();
+
+private:
+    QHash<QString, quint16> m_ids;
+    QStringList m_names;
+    QVector<QBitArray> m_compatibility;
+};
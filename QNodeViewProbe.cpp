@@ -0,0 +1,70 @@
+/*!
+  @file    QNodeViewProbe.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#include <QNodeViewProbe.h>
+
+QNodeViewProbe::QNodeViewProbe(qint32 capacity)
+: m_data(NULL)
+, m_mask(0)
+, m_head(0)
+, m_tail(0)
+, m_dropped(0)
+{
+    quint32 size = 2;
+    while (size < quint32(qMax(capacity, 2)))
+        size *= 2;
+
+    m_samples.resize(size);
+    m_data = m_samples.data();
+    m_mask = size - 1;
+}
+
+bool QNodeViewProbe::push(double value)
+{
+    const quint32 head = m_head.load();
+    const quint32 tail = m_tail.loadAcquire();
+
+    // Indices run freely and wrap, only their difference matters
+    if (head - tail > m_mask)
+    {
+        m_dropped.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    m_data[head & m_mask] = value;
+    m_head.storeRelease(head + 1);
+    return true;
+}
+
+qint32 QNodeViewProbe::read(double* values, qint32 maxCount)
+{
+    const quint32 tail = m_tail.load();
+    const quint32 head = m_head.loadAcquire();
+
+    const qint32 count = qMin(qint32(head - tail), maxCount);
+
+    for (qint32 index = 0; index < count; ++index)
+        values[index] = m_data[(tail + index) & m_mask];
+
+    m_tail.storeRelease(tail + count);
+    return count;
+}
@@ -0,0 +1,65 @@
+/*!
+  @file    QNodeViewProbe.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <QVector>
+
+/*!
+    Lock-free ring of samples from one producer thread to one consumer thread.
+
+    The producer calls push() at any rate and the consumer drains the ring
+    with read(); neither side locks or allocates after construction. Each
+    index is only ever written by one side, and publishes the samples before
+    it with release ordering. A full ring drops new samples and counts them
+    instead of overwriting samples the consumer may be reading.
+*/
+class QNodeViewProbe
+{
+public:
+    // Rounded up to a power of two
+    explicit QNodeViewProbe(qint32 capacity = 4096);
+
+    // Producer thread
+    bool push(double value);
+
+    // Consumer thread, copies up to maxCount of the oldest samples and returns how many
+    qint32 read(double* values, qint32 maxCount);
+
+    qint32 capacity() const { return m_samples.size(); }
+    quint64 dropped() const { return m_dropped.load(); }
+
+private:
+    Q_DISABLE_COPY(QNodeViewProbe)
+
+    QVector<double> m_samples;
+    double* m_data;
+    quint32 m_mask;
+
+    // Padded onto separate cache lines, so the producer and consumer do not invalidate each other's index
+    QAtomicInteger<quint32> m_head;
+    char m_headPadding[64];
+    QAtomicInteger<quint32> m_tail;
+    char m_tailPadding[64];
+    QAtomicInteger<quint64> m_dropped;
+};
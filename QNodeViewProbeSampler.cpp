@@ -0,0 +1,256 @@
+/*!
+  @file    QNodeViewProbeSampler.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#include <QElapsedTimer>
+#include <QGraphicsView>
+#include <QGuiApplication>
+#include <QScreen>
+
+#include <QNodeViewProbeSampler.h>
+#include <QNodeViewPort.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewTrace.h>
+
+const qint32 QNodeViewPortProbe::s_columns;
+
+// Frames folded into one sparkline column, about three seconds of history at 60 Hz
+static const qint32 s_framesPerColumn = 4;
+
+// Samples copied out of a ring at a time
+static const qint32 s_readChunk = 512;
+
+QNodeViewProbeSampler::QNodeViewProbeSampler(QObject* parent)
+: QObject(parent)
+, m_scene(NULL)
+, m_lastSampleCount(0)
+, m_lastStepTime(0)
+, m_lastRepaintCount(0)
+, m_animated(true)
+{
+    // Sampling faster than the display refreshes would only repaint frames nobody sees
+    qreal refreshRate = 60.0;
+
+    QScreen* screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() > 0.0)
+        refreshRate = screen->refreshRate();
+
+    m_timer.setInterval(qMax(1, qRound(1000.0 / refreshRate)));
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(step()));
+}
+
+QNodeViewProbeSampler::~QNodeViewProbeSampler()
+{
+    Q_FOREACH (QNodeViewPortProbe* probe, m_probes)
+    {
+        if (probe->port)
+            probe->port->setProbe(NULL);
+
+        delete probe;
+    }
+}
+
+void QNodeViewProbeSampler::install(QNodeViewScene* scene)
+{
+    Q_ASSERT(m_scene == NULL);
+    m_scene = scene;
+}
+
+QSharedPointer<QNodeViewProbe> QNodeViewProbeSampler::attach(QNodeViewPort* port, qint32 capacity)
+{
+    if (port->probe())
+        return port->probe()->probe;
+
+    QNodeViewPortProbe* probe = new QNodeViewPortProbe();
+    probe->port = port;
+    probe->probe = QSharedPointer<QNodeViewProbe>(new QNodeViewProbe(capacity));
+
+    port->setProbe(probe);
+    m_probes.append(probe);
+
+    updateTimer();
+    return probe->probe;
+}
+
+void QNodeViewProbeSampler::detach(QNodeViewPort* port)
+{
+    QNodeViewPortProbe* probe = port->probe();
+    if (!probe)
+        return;
+
+    port->setProbe(NULL);
+    m_probes.remove(m_probes.indexOf(probe));
+    delete probe;
+
+    updateTimer();
+}
+
+void QNodeViewProbeSampler::setAnimated(bool animated)
+{
+    m_animated = animated;
+    updateTimer();
+}
+
+void QNodeViewProbeSampler::step()
+{
+    QNODEVIEW_TRACE_SCOPE("QNodeViewProbeSampler::step");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<QRectF> visibleRects;
+
+    if (m_scene)
+    {
+        Q_FOREACH (QGraphicsView* view, m_scene->views())
+        {
+            if (view->isVisible())
+                visibleRects.append(view->mapToScene(view->viewport()->rect()).boundingRect());
+        }
+    }
+
+    m_lastSampleCount = 0;
+    m_lastRepaintCount = 0;
+
+    qint32 kept = 0;
+
+    for (qint32 index = 0; index < m_probes.size(); ++index)
+    {
+        QNodeViewPortProbe* probe = m_probes[index];
+
+        // The port is gone, the producer still holds the ring until it lets go too
+        if (!probe->port)
+        {
+            delete probe;
+            continue;
+        }
+
+        m_probes[kept++] = probe;
+
+        if (!sample(probe))
+            continue;
+
+        QNodeViewPort* port = probe->port;
+
+        // Hidden rows, collapsed groups and culled blocks pick up the current data when shown again
+        if (!port->isVisible() || !port->scene() || port->effectiveOpacity() <= 0.0)
+            continue;
+
+        const QRectF bounds = port->sceneBoundingRect();
+
+        Q_FOREACH (const QRectF& visibleRect, visibleRects)
+        {
+            if (visibleRect.intersects(bounds))
+            {
+                port->update();
+                ++m_lastRepaintCount;
+                break;
+            }
+        }
+    }
+
+    m_probes.resize(kept);
+    updateTimer();
+
+    m_lastStepTime = timer.nsecsElapsed();
+}
+
+bool QNodeViewProbeSampler::sample(QNodeViewPortProbe* probe)
+{
+    double samples[s_readChunk];
+    qint32 total = 0;
+
+    for (;;)
+    {
+        const qint32 count = probe->probe->read(samples, s_readChunk);
+        if (count == 0)
+            break;
+
+        for (qint32 index = 0; index < count; ++index)
+        {
+            const float value = float(samples[index]);
+
+            if (!probe->columnOpen)
+            {
+                probe->openMinimum = value;
+                probe->openMaximum = value;
+                probe->columnOpen = true;
+            }
+            else
+            {
+                probe->openMinimum = qMin(probe->openMinimum, value);
+                probe->openMaximum = qMax(probe->openMaximum, value);
+            }
+        }
+
+        probe->value = samples[count - 1];
+        total += count;
+    }
+
+    m_lastSampleCount += total;
+
+    bool changed = false;
+
+    if (total > 0)
+    {
+        probe->hasValue = true;
+
+        // Only what is shown counts, a value changing in digits that are not displayed needs no repaint
+        const QString text = QString::number(probe->value, 'g', 4);
+        if (text != probe->text)
+        {
+            probe->text = text;
+            changed = true;
+        }
+    }
+
+    if (probe->columnOpen && ++probe->openFrames >= s_framesPerColumn)
+    {
+        const qint32 column = (probe->firstColumn + probe->columnCount) % QNodeViewPortProbe::s_columns;
+
+        probe->minimum[column] = probe->openMinimum;
+        probe->maximum[column] = probe->openMaximum;
+
+        if (probe->columnCount < QNodeViewPortProbe::s_columns)
+            ++probe->columnCount;
+        else
+            probe->firstColumn = (probe->firstColumn + 1) % QNodeViewPortProbe::s_columns;
+
+        probe->columnOpen = false;
+        probe->openFrames = 0;
+        changed = true;
+    }
+
+    return changed;
+}
+
+void QNodeViewProbeSampler::updateTimer()
+{
+    if (m_animated && !m_probes.isEmpty())
+    {
+        if (!m_timer.isActive())
+            m_timer.start();
+    }
+    else
+    {
+        m_timer.stop();
+    }
+}
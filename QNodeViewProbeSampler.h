@@ -0,0 +1,133 @@
+/*!
+  @file    QNodeViewProbeSampler.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+
+#pragma once
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include <QNodeViewProbe.h>
+
+class QNodeViewPort;
+class QNodeViewScene;
+
+/*!
+    What a probed port shows, the latest value and a decimated history.
+
+    Each sparkline column holds the minimum and maximum of all samples that
+    arrived while it was open, so short spikes stay visible however many
+    samples are folded into one column.
+*/
+struct QNodeViewPortProbe
+{
+    static const qint32 s_columns = 48;
+
+    QNodeViewPortProbe()
+    : port(NULL)
+    , minimum(s_columns)
+    , maximum(s_columns)
+    , firstColumn(0)
+    , columnCount(0)
+    , openMinimum(0.0f)
+    , openMaximum(0.0f)
+    , openFrames(0)
+    , value(0.0)
+    , columnOpen(false)
+    , hasValue(false)
+    {
+    }
+
+    // Cleared by the port when it is destroyed
+    QNodeViewPort* port;
+    QSharedPointer<QNodeViewProbe> probe;
+
+    // Ring of closed columns, oldest first from firstColumn
+    QVector<float> minimum;
+    QVector<float> maximum;
+    qint32 firstColumn;
+    qint32 columnCount;
+
+    // Column still collecting samples
+    float openMinimum;
+    float openMaximum;
+    qint32 openFrames;
+
+    double value;
+    QString text;
+    bool columnOpen;
+    bool hasValue;
+};
+
+/*!
+    Samples port probes at display rate and repaints what changed.
+
+    Producers feed a QNodeViewProbe per port from their own thread. Once per
+    frame the sampler drains every ring, folds the samples into the open
+    sparkline column, and closes a column every few frames. A port is only
+    repainted when its formatted value or its sparkline changed, and only
+    while it is visible and inside a view; ports off screen are still drained
+    so their producers never stall, and show current data once scrolled to.
+*/
+class QNodeViewProbeSampler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QNodeViewProbeSampler(QObject* parent = NULL);
+    virtual ~QNodeViewProbeSampler();
+
+    void install(QNodeViewScene* scene);
+
+    // The producer keeps its reference, so the ring stays valid after the port or the sampler let go of it
+    QSharedPointer<QNodeViewProbe> attach(QNodeViewPort* port, qint32 capacity = 4096);
+    void detach(QNodeViewPort* port);
+
+    qint32 probeCount() const { return m_probes.size(); }
+
+    // Without animation no timer runs and step() is called by hand, e.g. by QNodeViewBenchmarks::probes
+    void setAnimated(bool animated);
+    bool isAnimated() const { return m_animated; }
+
+    // Statistics of the last step
+    qint64 lastSampleCount() const { return m_lastSampleCount; }
+    qint32 lastRepaintCount() const { return m_lastRepaintCount; }
+    qint64 lastStepTime() const { return m_lastStepTime; }
+
+public slots:
+    void step();
+
+private:
+    bool sample(QNodeViewPortProbe* probe);
+    void updateTimer();
+
+private:
+    QNodeViewScene* m_scene;
+    QVector<QNodeViewPortProbe*> m_probes;
+    QTimer m_timer;
+    qint64 m_lastSampleCount;
+    qint64 m_lastStepTime;
+    qint32 m_lastRepaintCount;
+    bool m_animated;
+};
@@ -0,0 +1,367 @@
+/*!
+  @file    QNodeViewReplay.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QScrollBar>
+#include <QTextStream>
+#include <QTimer>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <ctime>
+
+#include <QNodeViewAnimator.h>
+#include <QNodeViewCanvas.h>
+#include <QNodeViewConnection.h>
+#include <QNodeViewEditor.h>
+#include <QNodeViewEventRecorder.h>
+#include <QNodeViewGraph.h>
+#include <QNodeViewScene.h>
+
+#include <ExampleTypes.h>
+
+/*!
+    Replays a recorded session against a graph and reports end to end latency.
+
+        QNodeViewReplay <graph> <recording>
+        QNodeViewReplay --animate 0.01 --duration 10 <graph>
+
+    Events are fed back one at a time as fast as possible, and after each one
+    all posted work and the resulting repaint are flushed synchronously. The
+    canvas runs without animation, so the outcome does not depend on timers
+    and every run processes the same frames. Runs on the offscreen platform
+    unless another one is requested.
+
+    With --animate, no recording is needed; the given fraction of the wires
+    is marked active and the event loop runs for the given time, reporting
+    the CPU time the wire animation costs over an idle run of the same scene.
+*/
+
+namespace
+{
+    struct Samples
+    {
+        QVector<qint64> processing;
+        QVector<qint64> rendering;
+        QVector<qint64> total;
+    };
+
+    qint64 percentile(QVector<qint64> values, qreal fraction)
+    {
+        if (values.isEmpty())
+            return 0;
+
+        std::sort(values.begin(), values.end());
+        const qint32 index = qBound(0, qint32(values.size() * fraction + 0.5) - 1, values.size() - 1);
+        return values[index];
+    }
+
+    QString formatLatency(const QVector<qint64>& values)
+    {
+        const qreal toMs = 1.0 / 1000000.0;
+
+        return QString("p50 %1 ms, p95 %2 ms, p99 %3 ms, max %4 ms")
+            .arg(percentile(values, 0.50) * toMs, 0, 'f', 3)
+            .arg(percentile(values, 0.95) * toMs, 0, 'f', 3)
+            .arg(percentile(values, 0.99) * toMs, 0, 'f', 3)
+            .arg(percentile(values, 1.00) * toMs, 0, 'f', 3);
+    }
+
+    QString eventName(qint32 type)
+    {
+        switch (type)
+        {
+            case QEvent::MouseButtonPress:      return "press";
+            case QEvent::MouseButtonRelease:    return "release";
+            case QEvent::MouseButtonDblClick:   return "double click";
+            case QEvent::MouseMove:             return "move";
+            case QEvent::Wheel:                 return "wheel";
+            case QEvent::KeyPress:              return "key press";
+            case QEvent::KeyRelease:            return "key release";
+            default:                            return "other";
+        }
+    }
+
+    bool sendRecordedEvent(QNodeViewCanvas* canvas, const QNodeViewRecordedEvent& record)
+    {
+        QWidget* viewport = canvas->viewport();
+        const QPointF globalPosition = viewport->mapToGlobal(record.position.toPoint());
+
+        const Qt::MouseButton button = Qt::MouseButton(record.button);
+        const Qt::MouseButtons buttons = Qt::MouseButtons(record.buttons);
+        const Qt::KeyboardModifiers modifiers = Qt::KeyboardModifiers(record.modifiers);
+
+        switch (record.type)
+        {
+            case QEvent::MouseButtonPress:
+            case QEvent::MouseButtonRelease:
+            case QEvent::MouseButtonDblClick:
+            case QEvent::MouseMove:
+            {
+                QMouseEvent event(QEvent::Type(record.type), record.position, record.position, globalPosition, button, buttons, modifiers);
+                QApplication::sendEvent(viewport, &event);
+                return true;
+            }
+
+            case QEvent::Wheel:
+            {
+                QWheelEvent event(record.position, globalPosition, QPoint(), QPoint(0, record.data), record.data, Qt::Vertical, buttons, modifiers);
+                QApplication::sendEvent(viewport, &event);
+                return true;
+            }
+
+            case QEvent::KeyPress:
+            case QEvent::KeyRelease:
+            {
+                QKeyEvent event(QEvent::Type(record.type), record.data, modifiers);
+                QApplication::sendEvent(canvas, &event);
+                return true;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    // CPU milliseconds spent while the event loop runs for the given time
+    qreal runEventLoop(qint32 seconds, qint64* wallMs)
+    {
+        QEventLoop loop;
+        QTimer::singleShot(seconds * 1000, &loop, SLOT(quit()));
+
+        QElapsedTimer wall;
+        wall.start();
+        const std::clock_t cpuStart = std::clock();
+
+        loop.exec();
+
+        *wallMs = qMax<qint64>(wall.elapsed(), 1);
+        return qreal(std::clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC;
+    }
+
+    int measureAnimation(QNodeViewScene& scene, QNodeViewCanvas& canvas, qreal fraction, qint32 seconds, QTextStream& out)
+    {
+        // The same scene with nothing active, so the animation's cost is what it adds on top
+        qint64 idleWallMs = 0;
+        const qreal idleCpuMs = runEventLoop(seconds, &idleWallMs);
+
+        QNodeViewAnimator animator;
+        animator.install(&scene);
+
+        qint32 connections = 0;
+
+        // Every n-th wire in stacking order, so runs over the same file animate the same wires
+        Q_FOREACH (QGraphicsItem* item, scene.items(Qt::AscendingOrder))
+        {
+            if (item->type() != QNodeViewType_Connection)
+                continue;
+
+            if (qint32((connections + 1) * fraction) != qint32(connections * fraction))
+                static_cast<QNodeViewConnection*>(item)->setActive(true);
+
+            ++connections;
+        }
+
+        qint64 frameTime = 0;
+        qint32 frames = 0;
+
+        QObject::connect(&canvas, &QNodeViewCanvas::frameRendered, [&frameTime, &frames](qint64 nanoseconds, bool)
+        {
+            frameTime += nanoseconds;
+            ++frames;
+        });
+
+        qint64 wallMs = 0;
+        const qreal cpuMs = runEventLoop(seconds, &wallMs);
+
+        out << animator.activeCount() << " of " << connections << " wires active, "
+            << animator.visibleCount() << " on screen" << endl;
+
+        out << frames << " frames in " << wallMs << " ms, "
+            << QString::number(frames > 0 ? frameTime / 1000000.0 / frames : 0.0, 'f', 3) << " ms per frame" << endl;
+
+        const qreal idleLoad = idleCpuMs * 100.0 / idleWallMs;
+        const qreal load = cpuMs * 100.0 / wallMs;
+
+        out << "cpu: " << QString::number(cpuMs, 'f', 0) << " ms, "
+            << QString::number(load, 'f', 1) << "% of one core, "
+            << QString::number(idleLoad, 'f', 1) << "% idle, "
+            << QString::number(load - idleLoad, 'f', 1) << "% for the animation" << endl;
+
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication application(argc, argv);
+    QApplication::setApplicationName("QNodeViewReplay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a recorded QNodeView session and reports per event latency.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("graph", "Graph file to load");
+    parser.addPositionalArgument("recording", "Session recording to replay");
+
+    QCommandLineOption animateOption("animate", "Instead of replaying, animate this fraction of the wires and report the CPU time.", "fraction");
+    QCommandLineOption durationOption("duration", "Seconds to animate for.", "seconds", "10");
+
+    parser.addOption(animateOption);
+    parser.addOption(durationOption);
+    parser.process(application);
+
+    const bool animate = parser.isSet(animateOption);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != (animate ? 1 : 2))
+        parser.showHelp(1);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    registerExampleTypes();
+
+    QNodeViewGraph graph;
+    QNodeViewEventRecording recording;
+    QString errorString;
+
+    if (!graph.loadFile(arguments[0], &errorString))
+    {
+        err << arguments[0] << ": " << errorString << endl;
+        return 1;
+    }
+
+    if (!animate && !recording.load(arguments[1], &errorString))
+    {
+        err << arguments[1] << ": " << errorString << endl;
+        return 1;
+    }
+
+    QNodeViewScene scene;
+    QNodeViewCanvas canvas(&scene);
+    canvas.setAnimated(false);
+
+    QNodeViewEditor editor;
+    editor.install(&scene);
+
+    if (!editor.load(graph))
+    {
+        err << arguments[0] << ": graph uses unknown node types" << endl;
+        return 1;
+    }
+
+    if (animate)
+    {
+        canvas.show();
+        canvas.resize(1280, 720);
+        canvas.centerOn(scene.itemsBoundingRect().center());
+
+        QApplication::sendPostedEvents();
+        canvas.viewport()->repaint();
+
+        return measureAnimation(scene, canvas, parser.value(animateOption).toDouble(), parser.value(durationOption).toInt(), out);
+    }
+
+    // Match the recorded viewport exactly, so the same items are under the same pixels
+    canvas.show();
+    canvas.resize(recording.viewportSize + canvas.size() - canvas.viewport()->size());
+    canvas.setSceneRect(recording.sceneRect);
+    canvas.setTransform(recording.transform);
+    canvas.horizontalScrollBar()->setValue(recording.scrollPosition.x());
+    canvas.verticalScrollBar()->setValue(recording.scrollPosition.y());
+    canvas.setFocus();
+
+    QApplication::sendPostedEvents();
+    canvas.viewport()->repaint();
+
+    qint64 frameTime = 0;
+    qint32 frames = 0;
+
+    QObject::connect(&canvas, &QNodeViewCanvas::frameRendered, [&frameTime, &frames](qint64 nanoseconds, bool)
+    {
+        frameTime += nanoseconds;
+        ++frames;
+    });
+
+    QMap<QString, Samples> samplesByEvent;
+    Samples all;
+    qint32 skipped = 0;
+
+    QElapsedTimer timer;
+    QElapsedTimer total;
+    total.start();
+
+    Q_FOREACH (const QNodeViewRecordedEvent& record, recording.events)
+    {
+        // Context menus run a modal loop that would never return without a user
+        if (record.button == Qt::RightButton || (record.buttons & Qt::RightButton))
+        {
+            ++skipped;
+            continue;
+        }
+
+        frameTime = 0;
+        timer.start();
+
+        if (!sendRecordedEvent(&canvas, record))
+        {
+            ++skipped;
+            continue;
+        }
+
+        // Deliver deferred scene updates, which in turn post the viewport repaint
+        QApplication::sendPostedEvents();
+        QApplication::sendPostedEvents();
+
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        Samples& samples = samplesByEvent[eventName(record.type)];
+        samples.processing.append(elapsed - frameTime);
+        samples.rendering.append(frameTime);
+        samples.total.append(elapsed);
+
+        all.processing.append(elapsed - frameTime);
+        all.rendering.append(frameTime);
+        all.total.append(elapsed);
+    }
+
+    const qint64 recorded = recording.events.isEmpty() ? 0 : recording.events.last().time;
+
+    out << all.total.size() << " events replayed, " << skipped << " skipped, " << frames << " frames in "
+        << total.elapsed() << " ms (recorded session " << recorded / 1000000 << " ms)" << endl;
+
+    out << "processing: " << formatLatency(all.processing) << endl;
+    out << "rendering:  " << formatLatency(all.rendering) << endl;
+    out << "total:      " << formatLatency(all.total) << endl;
+
+    for (QMap<QString, Samples>::const_iterator entry = samplesByEvent.constBegin(); entry != samplesByEvent.constEnd(); ++entry)
+        out << entry.key() << " (" << entry.value().total.size() << "): " << formatLatency(entry.value().total) << endl;
+
+    return 0;
+}
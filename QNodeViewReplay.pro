@@ -0,0 +1,40 @@
+#/*!  @file    QNodeViewReplay.pro
+#
+#  Copyright (c) 2014 Graham Wihlidal
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+#  @author  Graham Wihlidal
+#  @date    January 19, 2014
+#*/
+
+
+TARGET = QNodeViewReplay
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+QT += core gui widgets concurrent
+
+qnodeview_tracing: DEFINES += QNODEVIEW_TRACING
+
+LIBS += -L$$OUT_PWD -lQNodeViewWidgets -lQNodeViewCore
+
+win32-msvc*: PRE_TARGETDEPS += $$OUT_PWD/QNodeViewWidgets.lib $$OUT_PWD/QNodeViewCore.lib
+else: PRE_TARGETDEPS += $$OUT_PWD/libQNodeViewWidgets.a $$OUT_PWD/libQNodeViewCore.a
+
+SOURCES +=  \
+            QNodeViewReplay.cpp
+
+HEADERS  += \
+            ExampleTypes.h
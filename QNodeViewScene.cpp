@@ -0,0 +1,350 @@
+/*!
+  @file    QNodeViewScene.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QPainterPath>
+
+#include <QNodeViewScene.h>
+#include <QNodeViewBlock.h>
+#include <QNodeViewConnection.h>
+#include <QNodeViewPort.h>
+#include <QNodeViewPool.h>
+#include <QNodeViewTrace.h>
+
+QNodeViewScene::QNodeViewScene(QObject* parent)
+: QGraphicsScene(parent)
+, m_batchDepth(0)
+{
+}
+
+QNodeViewScene::~QNodeViewScene()
+{
+    // Items unregister themselves while being destroyed, so do it while the index still exists
+    clear();
+
+    QNodeViewPoolBase::trimAll();
+}
+
+QGraphicsItem* QNodeViewScene::nodeItemAt(const QRectF& area)
+{
+    QGraphicsItem* result = NULL;
+    qint32 resultPriority = 0;
+
+    QPainterPath areaPath;
+    areaPath.addRect(area);
+
+    // Ports sit on top of blocks, and everything sits on top of connections
+    // Qt's index only narrows by bounding rect, connections are tested through the segment index below
+    Q_FOREACH (QGraphicsItem* item, items(area, Qt::IntersectsItemBoundingRect))
+    {
+        // Fully transparent items are culled by a focus, see QNodeViewFocus
+        if (!item->isVisible() || item->effectiveOpacity() <= 0.0)
+            continue;
+
+        qint32 priority = 0;
+        switch (item->type())
+        {
+            case QNodeViewType_Port:            priority = 4; break;
+            case QNodeViewType_ConnectionSplit: priority = 3; break;
+            case QNodeViewType_Block:
+            case QNodeViewType_Group:           priority = 2; break;
+        }
+
+        if (priority <= resultPriority)
+            continue;
+
+        if (item->collidesWithPath(item->mapFromScene(areaPath)))
+        {
+            result = item;
+            resultPriority = priority;
+        }
+    }
+
+    if (result)
+        return result;
+
+    const qreal tolerance = qMax(area.width(), area.height()) * 0.5;
+
+    Q_FOREACH (QGraphicsItem* item, m_nodeIndex.segmentItems(area))
+    {
+        QNodeViewConnection* connection = static_cast<QNodeViewConnection*>(item);
+        if (connection->isVisible() && connection->effectiveOpacity() > 0.0 && connection->distanceTo(area.center()) <= tolerance + connection->pen().widthF() * 0.5)
+            return connection;
+    }
+
+    return NULL;
+}
+
+QVector<QNodeViewPort*> QNodeViewScene::findPorts(const QString& query, qint32 limit)
+{
+    QVector<QNodeViewPort*> ports;
+
+    // Released rows are left out, namedPort() gives them a port one at a time
+    Q_FOREACH (const QNodeViewSearchMatch& match, m_searchIndex.search(query, limit))
+    {
+        QNodeViewPort* port = m_namedPorts.value(match.key);
+        if (port)
+            ports.append(port);
+    }
+
+    return ports;
+}
+
+QNodeViewGraphPort QNodeViewScene::namedRecord(quint64 id) const
+{
+    QNodeViewPort* port = m_namedPorts.value(id);
+    if (!port)
+        return m_namedRows.value(id).record;
+
+    QNodeViewGraphPort record;
+    record.id = id;
+    record.name = port->portName();
+    record.isOutput = port->isOutput();
+    record.flags = port->portFlags();
+    record.typeId = port->typeId();
+    return record;
+}
+
+QNodeViewPort* QNodeViewScene::namedPort(quint64 id)
+{
+    QNodeViewPort* port = m_namedPorts.value(id);
+    if (port)
+        return port;
+
+    QHash<quint64, NamedRow>::const_iterator row = m_namedRows.constFind(id);
+    if (row == m_namedRows.constEnd())
+        return NULL;
+
+    // Scrolling releases other rows, so nothing from the hash is used afterwards
+    QNodeViewBlock* block = row.value().block;
+    return block->scrollToPort(id);
+}
+
+void QNodeViewScene::beginBatchMove()
+{
+    ++m_batchDepth;
+}
+
+void QNodeViewScene::endBatchMove()
+{
+    Q_ASSERT(m_batchDepth > 0);
+
+    if (m_batchDepth == 0 || --m_batchDepth > 0)
+        return;
+
+    QNODEVIEW_TRACE_SCOPE("QNodeViewScene::endBatchMove");
+
+    Q_FOREACH (QGraphicsItem* item, m_pendingIndex)
+        indexItem(item);
+
+    m_pendingIndex.clear();
+}
+
+bool QNodeViewScene::isBatchMoving(const QGraphicsItem* item)
+{
+    const QNodeViewScene* scene = qobject_cast<const QNodeViewScene*>(item->scene());
+    return scene && scene->isBatchMoving();
+}
+
+void QNodeViewScene::itemChanged(QGraphicsItem* item, QGraphicsItem::GraphicsItemChange change)
+{
+    switch (change)
+    {
+        case QGraphicsItem::ItemSceneChange:
+        {
+            // Called before the item leaves, so scene() is still the old scene
+            QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(item->scene());
+            if (scene)
+                scene->unindexItem(item);
+
+            break;
+        }
+
+        case QGraphicsItem::ItemSceneHasChanged:
+        {
+            if (item->type() == QNodeViewType_Port)
+                portRenamed(static_cast<QNodeViewPort*>(item));
+
+            itemGeometryChanged(item);
+
+            QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(item->scene());
+            if (scene && isGraphItem(item))
+                emit scene->nodeItemAdded(item);
+
+            break;
+        }
+
+        case QGraphicsItem::ItemPositionHasChanged:
+        case QGraphicsItem::ItemScenePositionHasChanged:
+        {
+            itemGeometryChanged(item);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void QNodeViewScene::itemGeometryChanged(QGraphicsItem* item)
+{
+    // Everything but connections is indexed by Qt alone
+    if (item->type() != QNodeViewType_Connection)
+        return;
+
+    QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(item->scene());
+    if (!scene)
+        return;
+
+    if (scene->isBatchMoving())
+        scene->m_pendingIndex.insert(item);
+    else
+        scene->indexItem(item);
+}
+
+void QNodeViewScene::itemDestroyed(QGraphicsItem* item)
+{
+    QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(item->scene());
+    if (scene)
+        scene->unindexItem(item);
+}
+
+void QNodeViewScene::connectionChanged(QGraphicsItem* connection)
+{
+    QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(connection->scene());
+    if (scene)
+        emit scene->nodeItemAdded(connection);
+}
+
+void QNodeViewScene::activityChanged(QGraphicsItem* connection)
+{
+    QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(connection->scene());
+    if (scene)
+        emit scene->connectionActivityChanged(connection);
+}
+
+void QNodeViewScene::portRenamed(QNodeViewPort* port)
+{
+    QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(port->scene());
+    if (scene)
+        scene->indexName(port);
+}
+
+void QNodeViewScene::portIdChanged(QNodeViewPort* port, quint64 previousId)
+{
+    QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(port->scene());
+    if (scene)
+    {
+        scene->unindexName(port, previousId);
+        scene->indexName(port);
+    }
+}
+
+void QNodeViewScene::rowReleased(QNodeViewBlock* block, const QNodeViewGraphPort& record)
+{
+    QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(block->scene());
+    if (scene)
+        scene->indexRow(block, record);
+}
+
+void QNodeViewScene::rowRemoved(QNodeViewBlock* block, quint64 id)
+{
+    QNodeViewScene* scene = qobject_cast<QNodeViewScene*>(block->scene());
+    if (scene)
+        scene->unindexRow(block, id);
+}
+
+void QNodeViewScene::indexItem(QGraphicsItem* item)
+{
+    m_nodeIndex.updateSegments(item, static_cast<QNodeViewConnection*>(item)->polyline());
+}
+
+void QNodeViewScene::indexName(QNodeViewPort* port)
+{
+    if (port->portName().isEmpty())
+    {
+        unindexName(port, port->id());
+        return;
+    }
+
+    m_namedPorts.insert(port->id(), port);
+    m_namedRows.remove(port->id());
+
+    // Block titles rank ahead of port names that match equally well
+    m_searchIndex.insert(port->id(), port->portName(), (port->portFlags() & QNodeViewPortLabel_Name) ? 1 : 0);
+}
+
+void QNodeViewScene::unindexName(QNodeViewPort* port, quint64 id)
+{
+    // Only the port an id resolves to owns its entry
+    QHash<quint64, QNodeViewPort*>::iterator entry = m_namedPorts.find(id);
+    if (entry == m_namedPorts.end() || entry.value() != port)
+        return;
+
+    m_namedPorts.erase(entry);
+    m_searchIndex.remove(id);
+}
+
+void QNodeViewScene::indexRow(QNodeViewBlock* block, const QNodeViewGraphPort& record)
+{
+    if (record.name.isEmpty() || m_namedPorts.contains(record.id))
+        return;
+
+    const NamedRow row = { block, record };
+    m_namedRows.insert(record.id, row);
+    m_searchIndex.insert(record.id, record.name, (record.flags & QNodeViewPortLabel_Name) ? 1 : 0);
+}
+
+void QNodeViewScene::unindexRow(QNodeViewBlock* block, quint64 id)
+{
+    QHash<quint64, NamedRow>::iterator entry = m_namedRows.find(id);
+    if (entry == m_namedRows.end() || entry.value().block != block)
+        return;
+
+    m_namedRows.erase(entry);
+    m_searchIndex.remove(id);
+}
+
+void QNodeViewScene::unindexItem(QGraphicsItem* item)
+{
+    m_nodeIndex.removeItem(item);
+    m_pendingIndex.remove(item);
+
+    if (item->type() == QNodeViewType_Port)
+        unindexName(static_cast<QNodeViewPort*>(item), static_cast<QNodeViewPort*>(item)->id());
+
+    if (isGraphItem(item))
+        emit nodeItemRemoved(item);
+}
+
+bool QNodeViewScene::isGraphItem(const QGraphicsItem* item)
+{
+    switch (item->type())
+    {
+        case QNodeViewType_Block:
+        case QNodeViewType_Group:
+        case QNodeViewType_Connection:
+        case QNodeViewType_ConnectionSplit:
+            return true;
+
+        default:
+            return false;
+    }
+}
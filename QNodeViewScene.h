@@ -0,0 +1,121 @@
+/*!
+  @file    QNodeViewScene.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QGraphicsScene>
+#include <QGraphicsItem>
+#include <QSet>
+#include <QNodeViewCommon.h>
+#include <QNodeViewGraph.h>
+#include <QNodeViewSceneIndex.h>
+#include <QNodeViewSearchIndex.h>
+
+class QNodeViewBlock;
+class QNodeViewPort;
+
+/*!
+    Scene that keeps a QNodeViewSceneIndex of connection segments next to
+    Qt's own item index.
+
+    Qt's index serves painting, items(), rubber band selection and the
+    blocks, ports and splits the editor hit tests, so moving those updates
+    nothing else. Only connections are also kept in the segment index, which
+    finds the wire under a point without testing every connection whose
+    bounding rect spans it. Node items report position, geometry and scene
+    membership changes through the static hooks below from their own
+    itemChange() overrides. Plain QGraphicsScene instances keep working, the hooks simply
+    do nothing for them.
+*/
+class QNodeViewScene : public QGraphicsScene
+{
+    Q_OBJECT
+
+public:
+    explicit QNodeViewScene(QObject* parent = NULL);
+    virtual ~QNodeViewScene();
+
+    QNodeViewSceneIndex& nodeIndex() { return m_nodeIndex; }
+
+    QGraphicsItem* nodeItemAt(const QRectF& area);
+
+    // Port names in the scene, block titles included, kept current as ports are renamed, added and removed
+    // Keys are port ids, pooled ports reuse the addresses of deleted ones
+    // Rows of virtualized blocks released back to records keep their names in the index
+    QNodeViewSearchIndex& searchIndex() { return m_searchIndex; }
+    QVector<QNodeViewPort*> findPorts(const QString& query, qint32 limit);
+
+    // Name and flags of a search result, without giving a released row its port back
+    QNodeViewGraphPort namedRecord(quint64 id) const;
+
+    // A released row is scrolled into view on its block, which gives it a port again
+    QNodeViewPort* namedPort(quint64 id);
+
+    // While a batch move runs, segment index updates are collected and applied once when it ends
+    // Batches nest, only the outermost endBatchMove() applies the updates
+    void beginBatchMove();
+    void endBatchMove();
+    bool isBatchMoving() const { return m_batchDepth > 0; }
+
+signals:
+    // Blocks, groups, connections and splits; a connection is announced again when its ports are set
+    void nodeItemAdded(QGraphicsItem* item);
+    void nodeItemRemoved(QGraphicsItem* item);
+
+    // A connection in the scene was marked active or idle, see QNodeViewConnection::setActive()
+    void connectionActivityChanged(QGraphicsItem* connection);
+
+public:
+    static void itemChanged(QGraphicsItem* item, QGraphicsItem::GraphicsItemChange change);
+    static void itemGeometryChanged(QGraphicsItem* item);
+    static void itemDestroyed(QGraphicsItem* item);
+    static void portRenamed(QNodeViewPort* port);
+    static void portIdChanged(QNodeViewPort* port, quint64 previousId);
+    static void rowReleased(QNodeViewBlock* block, const QNodeViewGraphPort& record);
+    static void rowRemoved(QNodeViewBlock* block, quint64 id);
+    static void connectionChanged(QGraphicsItem* connection);
+    static void activityChanged(QGraphicsItem* connection);
+    static bool isBatchMoving(const QGraphicsItem* item);
+
+private:
+    void indexItem(QGraphicsItem* item);
+    void indexName(QNodeViewPort* port);
+    void unindexName(QNodeViewPort* port, quint64 id);
+    void indexRow(QNodeViewBlock* block, const QNodeViewGraphPort& record);
+    void unindexRow(QNodeViewBlock* block, quint64 id);
+    void unindexItem(QGraphicsItem* item);
+
+    static bool isGraphItem(const QGraphicsItem* item);
+
+private:
+    struct NamedRow
+    {
+        QNodeViewBlock* block;
+        QNodeViewGraphPort record;
+    };
+
+    QNodeViewSceneIndex m_nodeIndex;
+    QNodeViewSearchIndex m_searchIndex;
+    QHash<quint64, QNodeViewPort*> m_namedPorts;
+    QHash<quint64, NamedRow> m_namedRows;
+    QSet<QGraphicsItem*> m_pendingIndex;
+    qint32 m_batchDepth;
+};
@@ -0,0 +1,178 @@
+/*!
+  @file    QNodeViewSceneIndex.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QSet>
+#include <QtMath>
+
+#include <algorithm>
+
+#include <QNodeViewSceneIndex.h>
+
+namespace
+{
+    void removeFromCell(QHash<quint64, QVector<QGraphicsItem*> >& cells, quint64 key, QGraphicsItem* item)
+    {
+        QHash<quint64, QVector<QGraphicsItem*> >::iterator cell = cells.find(key);
+        if (cell == cells.end())
+            return;
+
+        const qint32 index = cell.value().indexOf(item);
+        if (index >= 0)
+            cell.value().remove(index);
+
+        if (cell.value().isEmpty())
+            cells.erase(cell);
+    }
+
+    void collectCells(const QHash<quint64, QVector<QGraphicsItem*> >& cells, const QVector<quint64>& keys, QVector<QGraphicsItem*>& result)
+    {
+        QSet<QGraphicsItem*> seen;
+
+        Q_FOREACH (quint64 key, keys)
+        {
+            QHash<quint64, QVector<QGraphicsItem*> >::const_iterator cell = cells.constFind(key);
+            if (cell == cells.constEnd())
+                continue;
+
+            Q_FOREACH (QGraphicsItem* item, cell.value())
+            {
+                if (seen.contains(item))
+                    continue;
+
+                seen.insert(item);
+                result.append(item);
+            }
+        }
+    }
+}
+
+QNodeViewSceneIndex::QNodeViewSceneIndex(qreal cellSize)
+: m_cellSize(cellSize)
+{
+}
+
+void QNodeViewSceneIndex::clear()
+{
+    m_segments.clear();
+    m_segmentCells.clear();
+}
+
+void QNodeViewSceneIndex::updateSegments(QGraphicsItem* item, const QPolygonF& polyline)
+{
+    QVector<quint64> keys;
+
+    if (polyline.size() == 1)
+    {
+        const QRect range = cellRange(QRectF(polyline.first(), QSizeF(0, 0)));
+        keys.append(cellKey(range.left(), range.top()));
+    }
+
+    for (qint32 index = 0; index < polyline.size() - 1; ++index)
+    {
+        const QRect range = cellRange(QRectF(polyline[index], polyline[index + 1]).normalized());
+
+        for (qint32 y = range.top(); y <= range.bottom(); ++y)
+        {
+            for (qint32 x = range.left(); x <= range.right(); ++x)
+                keys.append(cellKey(x, y));
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    QHash<QGraphicsItem*, QVector<quint64> >::iterator entry = m_segmentCells.find(item);
+    if (entry != m_segmentCells.end())
+    {
+        if (entry.value() == keys)
+            return;
+
+        Q_FOREACH (quint64 key, entry.value())
+            removeFromCell(m_segments, key, item);
+
+        entry.value() = keys;
+    }
+    else
+    {
+        m_segmentCells.insert(item, keys);
+    }
+
+    Q_FOREACH (quint64 key, keys)
+        m_segments[key].append(item);
+}
+
+void QNodeViewSceneIndex::removeItem(QGraphicsItem* item)
+{
+    QHash<QGraphicsItem*, QVector<quint64> >::iterator entry = m_segmentCells.find(item);
+    if (entry == m_segmentCells.end())
+        return;
+
+    Q_FOREACH (quint64 key, entry.value())
+        removeFromCell(m_segments, key, item);
+
+    m_segmentCells.erase(entry);
+}
+
+QVector<QGraphicsItem*> QNodeViewSceneIndex::segmentItems(const QRectF& rect) const
+{
+    QVector<QGraphicsItem*> result;
+    collectCells(m_segments, occupiedKeys(m_segments, cellRange(rect)), result);
+    return result;
+}
+
+QVector<quint64> QNodeViewSceneIndex::occupiedKeys(const CellMap& cells, const QRect& range) const
+{
+    QVector<quint64> keys;
+
+    const qint64 cellCount = qint64(range.width()) * qint64(range.height());
+
+    if (cellCount > cells.size())
+    {
+        // Zoomed far out, walking the occupied cells is cheaper than the grid
+        for (CellMap::const_iterator cell = cells.constBegin(); cell != cells.constEnd(); ++cell)
+        {
+            if (range.contains(qint32(cell.key() >> 32), qint32(cell.key() & 0xffffffff)))
+                keys.append(cell.key());
+        }
+
+        return keys;
+    }
+
+    keys.reserve(cellCount);
+
+    for (qint32 y = range.top(); y <= range.bottom(); ++y)
+    {
+        for (qint32 x = range.left(); x <= range.right(); ++x)
+            keys.append(cellKey(x, y));
+    }
+
+    return keys;
+}
+
+QRect QNodeViewSceneIndex::cellRange(const QRectF& rect) const
+{
+    const qint32 left   = qFloor(rect.left()   / m_cellSize);
+    const qint32 top    = qFloor(rect.top()    / m_cellSize);
+    const qint32 right  = qFloor(rect.right()  / m_cellSize);
+    const qint32 bottom = qFloor(rect.bottom() / m_cellSize);
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
@@ -0,0 +1,70 @@
+/*!
+  @file    QNodeViewSceneIndex.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QVector>
+#include <QRect>
+#include <QRectF>
+#include <QPolygonF>
+
+class QGraphicsItem;
+
+/*!
+    Segment index for connections.
+
+    Connections are long and thin, so each one is rasterized segment by
+    segment into a uniform grid instead of being indexed by a bounding rect
+    that can span the whole scene. Blocks, ports and splits are left to Qt's
+    own item index.
+*/
+class QNodeViewSceneIndex
+{
+public:
+    explicit QNodeViewSceneIndex(qreal cellSize = 256.0);
+
+    void clear();
+
+    void updateSegments(QGraphicsItem* item, const QPolygonF& polyline);
+    void removeItem(QGraphicsItem* item);
+
+    QVector<QGraphicsItem*> segmentItems(const QRectF& rect) const;
+
+    qint32 segmentItemCount() const { return m_segmentCells.size(); }
+
+private:
+    typedef QHash<quint64, QVector<QGraphicsItem*> > CellMap;
+
+    QRect cellRange(const QRectF& rect) const;
+    QVector<quint64> occupiedKeys(const CellMap& cells, const QRect& range) const;
+
+    static quint64 cellKey(qint32 x, qint32 y)
+    {
+        return (quint64(quint32(x)) << 32) | quint32(y);
+    }
+
+private:
+    CellMap m_segments;
+    QHash<QGraphicsItem*, QVector<quint64> > m_segmentCells;
+
+    qreal m_cellSize;
+};
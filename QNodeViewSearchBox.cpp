@@ -0,0 +1,196 @@
+/*!
+  @file    QNodeViewSearchBox.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QNodeViewSearchBox.h>
+#include <QNodeViewCanvas.h>
+#include <QNodeViewScene.h>
+#include <QNodeViewBlock.h>
+#include <QNodeViewPort.h>
+
+static const qint32 s_resultLimit = 20;
+static const qint32 s_boxWidth = 280;
+static const qint32 s_boxMargin = 8;
+
+QNodeViewSearchBox::QNodeViewSearchBox(QNodeViewCanvas* canvas)
+: QFrame(canvas)
+, m_canvas(canvas)
+, m_lastSearchTime(0)
+{
+    setFrameShape(QFrame::StyledPanel);
+    setAutoFillBackground(true);
+
+    m_edit = new QLineEdit(this);
+    m_edit->setPlaceholderText(tr("Find block or port"));
+    m_edit->installEventFilter(this);
+
+    m_results = new QListWidget(this);
+    m_results->setVisible(false);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 4, 4, 4);
+    layout->setSpacing(4);
+    layout->addWidget(m_edit);
+    layout->addWidget(m_results);
+
+    connect(m_edit, SIGNAL(textEdited(const QString&)), this, SLOT(search(const QString&)));
+    connect(m_edit, SIGNAL(returnPressed()), this, SLOT(activate()));
+    connect(m_results, SIGNAL(itemActivated(QListWidgetItem*)), this, SLOT(activate()));
+
+    QShortcut* shortcut = new QShortcut(QKeySequence::Find, canvas, NULL, NULL, Qt::WidgetWithChildrenShortcut);
+    connect(shortcut, SIGNAL(activated()), this, SLOT(open()));
+
+    canvas->installEventFilter(this);
+    setVisible(false);
+}
+
+QNodeViewSearchBox::~QNodeViewSearchBox()
+{
+}
+
+void QNodeViewSearchBox::open()
+{
+    reposition();
+    show();
+    raise();
+
+    m_edit->setFocus();
+    m_edit->selectAll();
+
+    if (!m_edit->text().isEmpty())
+        search(m_edit->text());
+}
+
+void QNodeViewSearchBox::dismiss()
+{
+    hide();
+    m_canvas->setFocus();
+}
+
+bool QNodeViewSearchBox::eventFilter(QObject* object, QEvent* event)
+{
+    if (object == m_canvas && event->type() == QEvent::Resize)
+    {
+        reposition();
+    }
+    else if (object == m_edit && event->type() == QEvent::KeyPress)
+    {
+        QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
+
+        // Results are picked with the arrow keys while typing continues in the edit
+        switch (keyEvent->key())
+        {
+            case Qt::Key_Escape:
+                dismiss();
+                return true;
+
+            case Qt::Key_Down:
+            case Qt::Key_Up:
+            {
+                if (m_results->count() == 0)
+                    break;
+
+                const qint32 step = (keyEvent->key() == Qt::Key_Down) ? 1 : -1;
+                const qint32 row = qBound(0, m_results->currentRow() + step, m_results->count() - 1);
+                m_results->setCurrentRow(row);
+                return true;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    return QFrame::eventFilter(object, event);
+}
+
+void QNodeViewSearchBox::search(const QString& text)
+{
+    m_results->clear();
+
+    QNodeViewScene* nodeScene = scene();
+    if (!nodeScene)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QVector<QNodeViewSearchMatch> matches = nodeScene->searchIndex().search(text, s_resultLimit);
+
+    m_lastSearchTime = timer.nsecsElapsed();
+
+    Q_FOREACH (const QNodeViewSearchMatch& match, matches)
+    {
+        // Listing a released row leaves it a record, only activating it scrolls its block
+        const QNodeViewGraphPort record = nodeScene->namedRecord(match.key);
+        const bool title = (record.flags & QNodeViewPortLabel_Name) != 0;
+
+        QListWidgetItem* item = new QListWidgetItem(title ? record.name : tr("%1 (port)").arg(record.name), m_results);
+        item->setData(Qt::UserRole, match.key);
+    }
+
+    m_results->setCurrentRow(0);
+    m_results->setVisible(m_results->count() > 0);
+    adjustSize();
+}
+
+void QNodeViewSearchBox::activate()
+{
+    QNodeViewScene* nodeScene = scene();
+    QListWidgetItem* item = m_results->currentItem();
+
+    if (!nodeScene || !item)
+        return;
+
+    // The scene may have changed since the results were listed
+    QNodeViewPort* port = nodeScene->namedPort(item->data(Qt::UserRole).toULongLong());
+    if (!port)
+    {
+        search(m_edit->text());
+        return;
+    }
+
+    QNodeViewBlock* block = port->block();
+
+    nodeScene->clearSelection();
+
+    if (block)
+    {
+        block->setSelected(true);
+        m_canvas->focusOn(block->sceneBoundingRect());
+    }
+    else
+    {
+        m_canvas->focusOn(port->sceneBoundingRect());
+    }
+}
+
+QNodeViewScene* QNodeViewSearchBox::scene() const
+{
+    return qobject_cast<QNodeViewScene*>(m_canvas->scene());
+}
+
+void QNodeViewSearchBox::reposition()
+{
+    const QRect viewportRect = m_canvas->viewport()->geometry();
+
+    setFixedWidth(qMin(s_boxWidth, viewportRect.width() - s_boxMargin * 2));
+    move(viewportRect.right() - width() - s_boxMargin, viewportRect.top() + s_boxMargin);
+}
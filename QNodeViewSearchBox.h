@@ -0,0 +1,68 @@
+/*!
+  @file    QNodeViewSearchBox.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QtWidgets>
+
+class QNodeViewCanvas;
+class QNodeViewScene;
+
+/*!
+    Find box floating in the top right corner of a canvas.
+
+    Opened with the find shortcut, it lists the best matching block titles
+    and port names from the scene's search index on every keystroke, and
+    focuses the canvas on the chosen result. The canvas scene has to be a
+    QNodeViewScene.
+*/
+class QNodeViewSearchBox : public QFrame
+{
+    Q_OBJECT
+
+public:
+    explicit QNodeViewSearchBox(QNodeViewCanvas* canvas);
+    virtual ~QNodeViewSearchBox();
+
+    // Time taken by the last query, for checking the per keystroke budget
+    qint64 lastSearchTime() const { return m_lastSearchTime; }
+
+public slots:
+    void open();
+    void dismiss();
+
+protected:
+    virtual bool eventFilter(QObject* object, QEvent* event);
+
+private slots:
+    void search(const QString& text);
+    void activate();
+
+private:
+    QNodeViewScene* scene() const;
+    void reposition();
+
+private:
+    QNodeViewCanvas* m_canvas;
+    QLineEdit* m_edit;
+    QListWidget* m_results;
+    qint64 m_lastSearchTime;
+};
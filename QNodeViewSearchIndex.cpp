@@ -0,0 +1,269 @@
+/*!
+  @file    QNodeViewSearchIndex.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+
+#include <QNodeViewSearchIndex.h>
+
+namespace
+{
+    // Marks the start of a name, never part of a folded name itself
+    const QChar s_padding(0x0001);
+
+    // Stale postings are tolerated up to this many before any rebuild
+    const qint32 s_minStale = 4096;
+
+    // Candidates checked per search, a bit over a millisecond of work
+    const qint32 s_maxCandidates = 16384;
+
+    bool isWordStart(const QString& name, qint32 position)
+    {
+        if (position == 0)
+            return true;
+
+        const QChar previous = name[position - 1];
+        return !previous.isLetterOrNumber();
+    }
+
+    bool betterMatch(const QNodeViewSearchMatch& left, const QNodeViewSearchMatch& right)
+    {
+        if (left.rank != right.rank)
+            return left.rank < right.rank;
+
+        if (left.weight != right.weight)
+            return left.weight > right.weight;
+
+        if (left.length != right.length)
+            return left.length < right.length;
+
+        return left.key < right.key;
+    }
+
+    // The heap keeps the best matches with the worst of them on top
+    void keepMatch(QVector<QNodeViewSearchMatch>& matches, const QNodeViewSearchMatch& match, qint32 limit)
+    {
+        if (matches.size() < limit)
+        {
+            matches.append(match);
+            std::push_heap(matches.begin(), matches.end(), betterMatch);
+        }
+        else if (betterMatch(match, matches.first()))
+        {
+            std::pop_heap(matches.begin(), matches.end(), betterMatch);
+            matches.last() = match;
+            std::push_heap(matches.begin(), matches.end(), betterMatch);
+        }
+    }
+}
+
+QNodeViewSearchIndex::QNodeViewSearchIndex()
+: m_stale(0)
+{
+}
+
+void QNodeViewSearchIndex::clear()
+{
+    m_entries.clear();
+    m_slots.clear();
+    m_names.clear();
+    m_postings.clear();
+    m_stale = 0;
+}
+
+void QNodeViewSearchIndex::insert(quint64 key, const QString& name, qint32 weight)
+{
+    const QString folded = fold(name);
+
+    QHash<quint64, qint32>::const_iterator existing = m_slots.constFind(key);
+    if (existing != m_slots.constEnd())
+    {
+        Entry& entry = m_entries[existing.value()];
+
+        // Renames to the same text and weight changes keep the postings
+        if (entry.name == folded)
+        {
+            entry.weight = weight;
+            return;
+        }
+
+        remove(key);
+    }
+
+    const Entry entry = { key, folded, weight, true };
+    const qint32 slot = m_entries.size();
+
+    m_entries.append(entry);
+    m_slots.insert(key, slot);
+    m_names.insert(folded, slot);
+    addPostings(slot);
+}
+
+void QNodeViewSearchIndex::remove(quint64 key)
+{
+    QHash<quint64, qint32>::iterator existing = m_slots.find(key);
+    if (existing == m_slots.end())
+        return;
+
+    Entry& entry = m_entries[existing.value()];
+    m_names.remove(entry.name, existing.value());
+    entry.live = false;
+    entry.name.clear();
+
+    m_slots.erase(existing);
+
+    if (++m_stale > s_minStale && m_stale > m_slots.size())
+        rebuild();
+}
+
+QVector<QNodeViewSearchMatch> QNodeViewSearchIndex::search(const QString& query, qint32 limit) const
+{
+    QVector<QNodeViewSearchMatch> matches;
+
+    const QString folded = fold(query.trimmed());
+    if (folded.isEmpty() || limit <= 0)
+        return matches;
+
+    qint32 budget = s_maxCandidates;
+
+    // Exact names come from the name hash, without walking any postings
+    QMultiHash<QString, qint32>::const_iterator exact = m_names.constFind(folded);
+    for (; exact != m_names.constEnd() && exact.key() == folded && budget > 0; ++exact, --budget)
+    {
+        const Entry& entry = m_entries[exact.value()];
+
+        QNodeViewSearchMatch match;
+        match.key = entry.key;
+        match.rank = QNodeViewSearchRank_Exact;
+        match.weight = entry.weight;
+        match.length = entry.name.size();
+        keepMatch(matches, match, limit);
+    }
+
+    // Prefixes next, the padded query's trigrams only occur at the start of a name
+    const QVector<qint32>* prefixes = shortestPostings(QString(2, s_padding) + folded);
+
+    for (qint32 index = 0; prefixes && index < prefixes->size() && budget > 0; ++index, --budget)
+    {
+        const Entry& entry = m_entries[prefixes->at(index)];
+        if (!entry.live || entry.name.size() == folded.size() || !entry.name.startsWith(folded))
+            continue;
+
+        QNodeViewSearchMatch match;
+        match.key = entry.key;
+        match.rank = QNodeViewSearchRank_Prefix;
+        match.weight = entry.weight;
+        match.length = entry.name.size();
+        keepMatch(matches, match, limit);
+    }
+
+    // Other substrings rank below every prefix, so they are only looked for while there is room
+    const bool full = matches.size() == limit && matches.first().rank <= QNodeViewSearchRank_Prefix;
+    const QVector<qint32>* substrings = (folded.size() < 3 || full) ? NULL : shortestPostings(folded);
+
+    for (qint32 index = 0; substrings && index < substrings->size() && budget > 0; ++index, --budget)
+    {
+        // Names starting with the query were ranked above
+        const Entry& entry = m_entries[substrings->at(index)];
+        if (!entry.live || entry.name.startsWith(folded))
+            continue;
+
+        const qint32 position = entry.name.indexOf(folded, 1);
+        if (position < 0)
+            continue;
+
+        QNodeViewSearchMatch match;
+        match.key = entry.key;
+        match.rank = isWordStart(entry.name, position) ? QNodeViewSearchRank_WordStart : QNodeViewSearchRank_Substring;
+        match.weight = entry.weight;
+        match.length = entry.name.size();
+        keepMatch(matches, match, limit);
+    }
+
+    std::sort_heap(matches.begin(), matches.end(), betterMatch);
+    return matches;
+}
+
+void QNodeViewSearchIndex::addPostings(qint32 slot)
+{
+    const QString padded = QString(2, s_padding) + m_entries[slot].name;
+
+    QVarLengthArray<quint64, 64> trigrams;
+    for (qint32 index = 0; index + 3 <= padded.size(); ++index)
+        trigrams.append(trigram(padded.constData() + index));
+
+    // A trigram repeated within one name gets a single posting
+    std::sort(trigrams.begin(), trigrams.end());
+    quint64* end = std::unique(trigrams.begin(), trigrams.end());
+
+    for (quint64* trigramKey = trigrams.begin(); trigramKey != end; ++trigramKey)
+        m_postings[*trigramKey].append(slot);
+}
+
+const QVector<qint32>* QNodeViewSearchIndex::shortestPostings(const QString& pattern) const
+{
+    const QVector<qint32>* shortest = NULL;
+
+    for (qint32 index = 0; index + 3 <= pattern.size(); ++index)
+    {
+        PostingMap::const_iterator postings = m_postings.constFind(trigram(pattern.constData() + index));
+        if (postings == m_postings.constEnd())
+            return NULL;
+
+        if (!shortest || postings.value().size() < shortest->size())
+            shortest = &postings.value();
+    }
+
+    return shortest;
+}
+
+void QNodeViewSearchIndex::rebuild()
+{
+    QVector<Entry> entries;
+    entries.reserve(m_slots.size());
+
+    Q_FOREACH (const Entry& entry, m_entries)
+    {
+        if (entry.live)
+            entries.append(entry);
+    }
+
+    m_entries = entries;
+    m_slots.clear();
+    m_names.clear();
+    m_postings.clear();
+    m_stale = 0;
+
+    for (qint32 slot = 0; slot < m_entries.size(); ++slot)
+    {
+        m_slots.insert(m_entries[slot].key, slot);
+        m_names.insert(m_entries[slot].name, slot);
+        addPostings(slot);
+    }
+}
+
+QString QNodeViewSearchIndex::fold(const QString& name)
+{
+    QString folded = name.toCaseFolded();
+    folded.remove(s_padding);
+    return folded;
+}
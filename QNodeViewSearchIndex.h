@@ -0,0 +1,110 @@
+/*!
+  @file    QNodeViewSearchIndex.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+enum QNodeViewSearchRank
+{
+    QNodeViewSearchRank_Exact,
+    QNodeViewSearchRank_Prefix,
+    QNodeViewSearchRank_WordStart,
+    QNodeViewSearchRank_Substring
+};
+
+struct QNodeViewSearchMatch
+{
+    QNodeViewSearchMatch() : key(0), rank(QNodeViewSearchRank_Substring), weight(0), length(0) {}
+
+    quint64 key;
+    qint32 rank;
+    qint32 weight;
+    qint32 length;
+};
+
+/*!
+    Case insensitive substring index over short names, such as port labels.
+
+    Every name is broken into trigrams, each with a posting list of the
+    names containing it. Names are padded at the start, so the trigrams of a
+    padded query only occur in names starting with it. A search takes exact
+    names from a hash, then walks the shortest posting list of the padded
+    query for prefixes, and only looks for other substrings while fewer
+    than the requested number of matches were found, since those always rank
+    below prefixes. One and two character queries match prefixes only.
+
+    Each search checks at most a fixed number of candidates, so a common
+    query such as "in" stays cheap on a million names; once that budget is
+    spent the matches found so far are returned, best first.
+
+    Removal leaves stale postings behind that are skipped during search, and
+    the postings are rebuilt once stale entries outnumber live ones, so
+    inserting and removing stay proportional to the name length.
+*/
+class QNodeViewSearchIndex
+{
+public:
+    QNodeViewSearchIndex();
+
+    void clear();
+
+    // Replaces any existing name for the key; heavier weights rank first among equal matches
+    void insert(quint64 key, const QString& name, qint32 weight = 0);
+    void remove(quint64 key);
+
+    bool contains(quint64 key) const { return m_slots.contains(key); }
+    qint32 size() const { return m_slots.size(); }
+
+    // Best matches first: exact, prefix, word start, then any substring
+    QVector<QNodeViewSearchMatch> search(const QString& query, qint32 limit) const;
+
+private:
+    struct Entry
+    {
+        quint64 key;
+        QString name;
+        qint32 weight;
+        bool live;
+    };
+
+    typedef QHash<quint64, QVector<qint32> > PostingMap;
+
+    void addPostings(qint32 slot);
+    const QVector<qint32>* shortestPostings(const QString& pattern) const;
+    void rebuild();
+
+    static QString fold(const QString& name);
+
+    static quint64 trigram(const QChar* characters)
+    {
+        return (quint64(characters[0].unicode()) << 32) | (quint64(characters[1].unicode()) << 16) | characters[2].unicode();
+    }
+
+private:
+    QVector<Entry> m_entries;
+    QHash<quint64, qint32> m_slots;
+    QMultiHash<QString, qint32> m_names;
+    PostingMap m_postings;
+    qint32 m_stale;
+};
@@ -0,0 +1,709 @@
+/*!
+  @file    QNodeViewTool.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSharedPointer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <limits>
+
+#include <QNodeViewGraph.h>
+#include <QNodeViewGraphDiff.h>
+#include <QNodeViewGraphGenerator.h>
+#include <QNodeViewProbe.h>
+
+/*!
+    Batch processing for saved graph files, with no GUI dependency.
+
+        QNodeViewTool stats     <files or directories...>
+        QNodeViewTool validate  <files or directories...>
+        QNodeViewTool convert   --format-version 2 --output out/ <files or directories...>
+        QNodeViewTool convert   --json --output out/ <files or directories...>
+        QNodeViewTool generate  --blocks 1000000 --seed 7 <output file>
+        QNodeViewTool diff      <from> <to>
+        QNodeViewTool merge     --output merged.qnv <base> <ours> <theirs>
+        QNodeViewTool stress    --probes 16 --rate 50000 --duration 5
+        QNodeViewTool formats   <file>
+
+    Files are processed in parallel on the global thread pool, and results
+    are reported in input order. stress needs no files, it feeds port probes
+    from producer threads and drains them at display rate, checking that no
+    sample is lost or reordered. formats writes one graph as binary, chunked
+    and JSON and reads each back, reporting sizes and times.
+*/
+
+namespace
+{
+    struct InputFile
+    {
+        QString path;
+        QString relativePath;
+    };
+
+    struct FileResult
+    {
+        FileResult() : bytes(0), version(0), ok(false) {}
+
+        QString path;
+        QString error;
+        QStringList problems;
+        QNodeViewGraphStatistics statistics;
+        qint64 bytes;
+        qint32 version;
+        bool ok;
+    };
+
+    struct ProcessFile
+    {
+        typedef FileResult result_type;
+
+        QString command;
+        QString outputDirectory;
+        qint32 targetVersion;
+        bool compressed;
+        bool json;
+
+        FileResult operator()(const InputFile& input) const
+        {
+            FileResult result;
+            result.path = input.path;
+            result.bytes = QFileInfo(input.path).size();
+
+            QNodeViewGraph graph;
+            if (!graph.loadFile(input.path, &result.error))
+                return result;
+
+            result.version = graph.version;
+            result.statistics = graph.statistics();
+
+            if (command == "validate")
+                result.problems = graph.validate();
+
+            if (command == "convert")
+            {
+                QString outputPath = QDir(outputDirectory).filePath(input.relativePath);
+                if (json)
+                    outputPath = QFileInfo(outputPath).path() + "/" + QFileInfo(outputPath).completeBaseName() + ".json";
+
+                QDir().mkpath(QFileInfo(outputPath).absolutePath());
+
+                if (!graph.saveFile(outputPath, targetVersion, compressed, &result.error))
+                    return result;
+            }
+
+            result.ok = result.problems.isEmpty();
+            return result;
+        }
+    };
+
+    QVector<InputFile> collectInputs(const QStringList& arguments, const QStringList& filters)
+    {
+        QVector<InputFile> inputs;
+
+        Q_FOREACH (const QString& argument, arguments)
+        {
+            const QFileInfo info(argument);
+
+            if (!info.isDir())
+            {
+                InputFile input = { argument, info.fileName() };
+                inputs.append(input);
+                continue;
+            }
+
+            const QDir root(argument);
+            QStringList paths;
+
+            QDirIterator iterator(argument, filters, QDir::Files, QDirIterator::Subdirectories);
+            while (iterator.hasNext())
+                paths.append(iterator.next());
+
+            // Directory order is file system dependent, keep the output stable
+            paths.sort();
+
+            Q_FOREACH (const QString& path, paths)
+            {
+                InputFile input = { path, root.relativeFilePath(path) };
+                inputs.append(input);
+            }
+        }
+
+        return inputs;
+    }
+
+    // Accepts either a single count or an inclusive "minimum-maximum" range
+    bool parseRange(const QString& value, qint32& minimum, qint32& maximum)
+    {
+        const QStringList parts = value.split('-');
+        bool minimumOk = false;
+        bool maximumOk = false;
+
+        minimum = parts.first().toInt(&minimumOk);
+        maximum = parts.last().toInt(&maximumOk);
+
+        return parts.size() <= 2 && minimumOk && maximumOk && minimum >= 0 && minimum <= maximum;
+    }
+
+    QString describeChange(const QNodeViewGraphChange& change)
+    {
+        static const char* const s_changes[] = { "added", "removed", "modified", "moved" };
+        static const char* const s_items[] = { "block", "group", "connection" };
+
+        QString result = QString("%1 %2 %3").arg(s_changes[change.change], s_items[change.item]).arg(change.key);
+
+        if (change.item == QNodeViewGraphItem_Connection)
+            result += QString(" -> %1").arg(change.endKey);
+
+        if (change.change == QNodeViewGraphChange_Moved)
+            result += QString(" (%1, %2) -> (%3, %4)").arg(change.from.x()).arg(change.from.y()).arg(change.to.x()).arg(change.to.y());
+
+        return result;
+    }
+
+    bool loadGraphs(const QStringList& fileNames, QVector<QNodeViewGraph>& graphs, QTextStream& err)
+    {
+        graphs.resize(fileNames.size());
+
+        for (qint32 index = 0; index < fileNames.size(); ++index)
+        {
+            QString errorString;
+            if (!graphs[index].loadFile(fileNames[index], &errorString))
+            {
+                err << fileNames[index] << ": error: " << errorString << endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Samples copied out of a probe at a time by the stress consumer
+    const qint32 s_stressChunk = 1024;
+
+    // Display rate of the stress consumer
+    const qint32 s_stressFrameInterval = 16;
+
+    struct StressProducer
+    {
+        StressProducer() : rate(0), duration(0), produced(0) {}
+
+        QSharedPointer<QNodeViewProbe> probe;
+        qint64 rate;
+        qint64 duration;
+        quint64 produced;
+    };
+
+    void produce(StressProducer* producer)
+    {
+        QElapsedTimer clock;
+        clock.start();
+
+        quint64 counter = 0;
+
+        // Counter values, so the consumer can tell lost and reordered samples from dropped ones
+        while (clock.elapsed() < producer->duration)
+        {
+            const quint64 due = quint64(clock.nsecsElapsed() / 1000) * producer->rate / 1000000;
+            while (counter < due)
+                producer->probe->push(double(++counter));
+
+            QThread::usleep(200);
+        }
+
+        producer->produced = counter;
+    }
+
+    bool stress(qint32 probeCount, qint64 rate, qint64 duration, qint32 capacity, QTextStream& out, QTextStream& err)
+    {
+        QVector<StressProducer> producers(probeCount);
+        QVector<double> lastValues(probeCount, 0.0);
+
+        for (qint32 index = 0; index < probeCount; ++index)
+        {
+            producers[index].probe = QSharedPointer<QNodeViewProbe>(new QNodeViewProbe(capacity));
+            producers[index].rate = rate;
+            producers[index].duration = duration;
+        }
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(probeCount);
+
+        for (qint32 index = 0; index < probeCount; ++index)
+            QtConcurrent::run(&pool, produce, &producers[index]);
+
+        QVector<double> samples(s_stressChunk);
+        quint64 received = 0;
+        qint64 worstFrame = 0;
+        qint32 frames = 0;
+        bool ordered = true;
+        bool running = true;
+
+        QElapsedTimer total;
+        total.start();
+
+        while (running)
+        {
+            // Checked before draining, so the last pass sees everything the producers pushed
+            running = pool.activeThreadCount() > 0;
+
+            QElapsedTimer frame;
+            frame.start();
+
+            for (qint32 index = 0; index < probeCount; ++index)
+            {
+                qint32 count;
+                while ((count = producers[index].probe->read(samples.data(), s_stressChunk)) > 0)
+                {
+                    for (qint32 sample = 0; sample < count; ++sample)
+                    {
+                        if (samples[sample] <= lastValues[index])
+                            ordered = false;
+
+                        lastValues[index] = samples[sample];
+                    }
+
+                    received += count;
+                }
+            }
+
+            worstFrame = qMax(worstFrame, frame.nsecsElapsed());
+            ++frames;
+
+            if (running)
+                QThread::msleep(s_stressFrameInterval);
+        }
+
+        pool.waitForDone();
+
+        quint64 produced = 0;
+        quint64 dropped = 0;
+
+        Q_FOREACH (const StressProducer& producer, producers)
+        {
+            produced += producer.produced;
+            dropped += producer.probe->dropped();
+        }
+
+        const qint64 elapsed = qMax<qint64>(total.elapsed(), 1);
+
+        out << probeCount << " probes, " << produced << " samples produced in " << elapsed << " ms ("
+            << produced * 1000 / elapsed << " per second), " << received << " received, " << dropped << " dropped" << endl;
+
+        out << frames << " frames, slowest drain " << QString::number(worstFrame / 1000000.0, 'f', 3) << " ms" << endl;
+
+        if (!ordered)
+            err << "error: samples were reordered or duplicated" << endl;
+
+        if (received + dropped != produced)
+            err << "error: " << produced - received - dropped << " samples lost" << endl;
+
+        return ordered && received + dropped == produced;
+    }
+
+    // Best of a few rounds, the first one also pays for cold caches
+    const qint32 s_formatRounds = 3;
+
+    struct FileFormat
+    {
+        const char* name;
+        const char* suffix;
+        bool compressed;
+    };
+
+    const FileFormat s_formats[] =
+    {
+        { "binary",     "qnv",  false   },
+        { "chunked",    "qnvc", true    },
+        { "json",       "json", false   }
+    };
+
+    bool sameStatistics(const QNodeViewGraphStatistics& first, const QNodeViewGraphStatistics& second)
+    {
+        return first.blocks == second.blocks && first.groups == second.groups && first.ports == second.ports &&
+               first.connections == second.connections && first.splits == second.splits;
+    }
+
+    bool compareFormats(const QString& fileName, QTextStream& out, QTextStream& err)
+    {
+        QString errorString;
+        QNodeViewGraph graph;
+
+        if (!graph.loadFile(fileName, &errorString))
+        {
+            err << fileName << ": error: " << errorString << endl;
+            return false;
+        }
+
+        QTemporaryDir directory;
+        if (!directory.isValid())
+        {
+            err << "Could not create a temporary directory" << endl;
+            return false;
+        }
+
+        const QNodeViewGraphStatistics expected = graph.statistics();
+        out << fileName << ": " << expected.blocks << " blocks, " << expected.ports << " ports, " << expected.connections << " connections" << endl;
+
+        for (qint32 index = 0; index < qint32(sizeof(s_formats) / sizeof(s_formats[0])); ++index)
+        {
+            const FileFormat& format = s_formats[index];
+            const QString path = directory.filePath(QString("graph.%1").arg(format.suffix));
+
+            qint64 saveTime = std::numeric_limits<qint64>::max();
+            qint64 loadTime = std::numeric_limits<qint64>::max();
+
+            for (qint32 round = 0; round < s_formatRounds; ++round)
+            {
+                QElapsedTimer timer;
+                timer.start();
+
+                if (!graph.saveFile(path, QNodeViewFile_Version, format.compressed, &errorString))
+                {
+                    err << format.name << ": error: " << errorString << endl;
+                    return false;
+                }
+
+                saveTime = qMin(saveTime, timer.elapsed());
+
+                QNodeViewGraph loaded;
+                timer.start();
+
+                if (!loaded.loadFile(path, &errorString))
+                {
+                    err << format.name << ": error: " << errorString << endl;
+                    return false;
+                }
+
+                loadTime = qMin(loadTime, timer.elapsed());
+
+                if (!sameStatistics(loaded.statistics(), expected))
+                {
+                    err << format.name << ": the graph read back differs from the one written" << endl;
+                    return false;
+                }
+            }
+
+            out << format.name << ": " << QFileInfo(path).size() << " bytes, saved in " << saveTime << " ms, loaded in " << loadTime << " ms" << endl;
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("QNodeViewTool");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Loads, validates, converts and summarizes QNodeView graph files.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "stats, validate, convert, generate, diff, merge, stress or formats");
+    parser.addPositionalArgument("inputs", "Graph files, or directories to search recursively, or the file to generate", "<inputs...>");
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Output directory for convert, or output file for merge.", "path");
+    QCommandLineOption versionOption("format-version", "File format version written by convert.", "version", QString::number(QNodeViewFile_Version));
+    QCommandLineOption compressOption("compress", "Compress files written by convert.");
+    QCommandLineOption jsonOption("json", "Write JSON files with convert.");
+    QCommandLineOption filterOption("filter", "File name filter used inside directories.", "pattern", "*");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Number of files processed in parallel.", "count");
+
+    const QNodeViewGraphGeneratorOptions defaults;
+    QCommandLineOption seedOption("seed", "Random seed for generate.", "seed", QString::number(defaults.seed));
+    QCommandLineOption blocksOption("blocks", "Number of blocks to generate.", "count", QString::number(defaults.blocks));
+    QCommandLineOption inputsOption("inputs", "Inputs per generated block, a count or a min-max range.", "range", QString("%1-%2").arg(defaults.minInputs).arg(defaults.maxInputs));
+    QCommandLineOption outputsOption("outputs", "Outputs per generated block, a count or a min-max range.", "range", QString("%1-%2").arg(defaults.minOutputs).arg(defaults.maxOutputs));
+    QCommandLineOption connectedOption("connected", "Fraction of generated inputs that are connected.", "fraction", QString::number(defaults.connectedInputs));
+    QCommandLineOption fanInOption("fan-in", "Maximum connections per generated input.", "count", QString::number(defaults.maxFanIn));
+    QCommandLineOption fanOutOption("fan-out", "Maximum connections per generated output.", "count", QString::number(defaults.maxFanOut));
+    QCommandLineOption skewOption("fan-out-skew", "Values above 1 concentrate generated connections on hub blocks.", "skew", QString::number(defaults.fanOutSkew));
+    QCommandLineOption depthOption("depth", "Number of DAG layers to generate, 0 for the square root of the block count.", "layers", QString::number(defaults.depth));
+    QCommandLineOption spanOption("span", "How many layers back a generated connection may reach.", "layers", QString::number(defaults.maxLayerSpan));
+    QCommandLineOption splitsOption("splits", "Average splits per generated connection.", "density", QString::number(defaults.splitDensity));
+    QCommandLineOption layoutOption("layout", "Generated block layout: layered, grid or random.", "layout", "layered");
+
+    QCommandLineOption probesOption("probes", "Number of probes fed by their own producer thread for stress.", "count", "16");
+    QCommandLineOption rateOption("rate", "Samples per second pushed into each probe for stress.", "rate", "50000");
+    QCommandLineOption durationOption("duration", "Seconds the stress producers run for.", "seconds", "5");
+    QCommandLineOption capacityOption("capacity", "Samples each stress probe can hold.", "count", "4096");
+
+    parser.addOption(outputOption);
+    parser.addOption(versionOption);
+    parser.addOption(compressOption);
+    parser.addOption(jsonOption);
+    parser.addOption(filterOption);
+    parser.addOption(jobsOption);
+    parser.addOption(seedOption);
+    parser.addOption(blocksOption);
+    parser.addOption(inputsOption);
+    parser.addOption(outputsOption);
+    parser.addOption(connectedOption);
+    parser.addOption(fanInOption);
+    parser.addOption(fanOutOption);
+    parser.addOption(skewOption);
+    parser.addOption(depthOption);
+    parser.addOption(spanOption);
+    parser.addOption(splitsOption);
+    parser.addOption(layoutOption);
+    parser.addOption(probesOption);
+    parser.addOption(rateOption);
+    parser.addOption(durationOption);
+    parser.addOption(capacityOption);
+    parser.process(application);
+
+    QStringList arguments = parser.positionalArguments();
+    if (arguments.isEmpty() || (arguments.size() < 2 && arguments.first() != "stress"))
+        parser.showHelp(1);
+
+    ProcessFile process;
+    process.command = arguments.takeFirst();
+    process.outputDirectory = parser.value(outputOption);
+    process.targetVersion = parser.value(versionOption).toInt();
+    process.compressed = parser.isSet(compressOption);
+    process.json = parser.isSet(jsonOption);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (process.command == "stress")
+    {
+        const qint32 probeCount = parser.value(probesOption).toInt();
+        const qint64 rate = parser.value(rateOption).toLongLong();
+        const qint64 duration = parser.value(durationOption).toLongLong() * 1000;
+        const qint32 capacity = parser.value(capacityOption).toInt();
+
+        if (probeCount <= 0 || rate <= 0 || duration <= 0 || capacity <= 0)
+        {
+            err << "Invalid stress parameters" << endl;
+            return 1;
+        }
+
+        return stress(probeCount, rate, duration, capacity, out, err) ? 0 : 1;
+    }
+
+    if (process.command == "formats")
+    {
+        if (arguments.size() != 1)
+        {
+            err << "formats needs one file" << endl;
+            return 1;
+        }
+
+        return compareFormats(arguments.first(), out, err) ? 0 : 1;
+    }
+
+    if (process.command == "generate")
+    {
+        QNodeViewGraphGeneratorOptions options;
+        options.seed = parser.value(seedOption).toUInt();
+        options.blocks = parser.value(blocksOption).toInt();
+        options.connectedInputs = parser.value(connectedOption).toDouble();
+        options.maxFanIn = parser.value(fanInOption).toInt();
+        options.maxFanOut = parser.value(fanOutOption).toInt();
+        options.fanOutSkew = parser.value(skewOption).toDouble();
+        options.depth = parser.value(depthOption).toInt();
+        options.maxLayerSpan = parser.value(spanOption).toInt();
+        options.splitDensity = parser.value(splitsOption).toDouble();
+
+        if (!parseRange(parser.value(inputsOption), options.minInputs, options.maxInputs) ||
+            !parseRange(parser.value(outputsOption), options.minOutputs, options.maxOutputs))
+        {
+            err << "Invalid port count range" << endl;
+            return 1;
+        }
+
+        const QString layout = parser.value(layoutOption);
+        if (layout == "layered")
+            options.layout = QNodeViewGraphLayout_Layered;
+        else if (layout == "grid")
+            options.layout = QNodeViewGraphLayout_Grid;
+        else if (layout == "random")
+            options.layout = QNodeViewGraphLayout_Random;
+        else
+        {
+            err << "Unknown layout " << layout << endl;
+            return 1;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        const QNodeViewGraph graph = QNodeViewGraphGenerator::generate(options);
+        const qint64 generated = timer.elapsed();
+
+        QString errorString;
+        if (!graph.saveFile(arguments.first(), process.targetVersion, process.compressed, &errorString))
+        {
+            err << arguments.first() << ": error: " << errorString << endl;
+            return 1;
+        }
+
+        const QNodeViewGraphStatistics statistics = graph.statistics();
+        out << arguments.first()
+            << ": " << statistics.blocks << " blocks"
+            << ", " << statistics.ports << " ports"
+            << ", " << statistics.connections << " connections"
+            << ", " << statistics.splits << " splits"
+            << ", generated in " << generated << " ms, written in " << timer.elapsed() - generated << " ms" << endl;
+
+        return 0;
+    }
+
+    if (process.command == "diff" || process.command == "merge")
+    {
+        const qint32 expected = (process.command == "diff") ? 2 : 3;
+        if (arguments.size() != expected)
+        {
+            err << process.command << " needs " << expected << " files" << endl;
+            return 1;
+        }
+
+        if (process.command == "merge" && process.outputDirectory.isEmpty())
+        {
+            err << "merge needs --output" << endl;
+            return 1;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        QVector<QNodeViewGraph> graphs;
+        if (!loadGraphs(arguments, graphs, err))
+            return 1;
+
+        const qint64 loaded = timer.elapsed();
+
+        if (process.command == "diff")
+        {
+            const QVector<QNodeViewGraphChange> changes = QNodeViewGraphDiff::diff(graphs[0], graphs[1]);
+
+            Q_FOREACH (const QNodeViewGraphChange& change, changes)
+                out << describeChange(change) << endl;
+
+            out << changes.size() << " changes, loaded in " << loaded << " ms, compared in " << timer.elapsed() - loaded << " ms" << endl;
+            return changes.isEmpty() ? 0 : 1;
+        }
+
+        QStringList conflicts;
+        const QNodeViewGraph merged = QNodeViewGraphDiff::merge(graphs[0], graphs[1], graphs[2], &conflicts);
+        const qint64 mergeTime = timer.elapsed() - loaded;
+
+        Q_FOREACH (const QString& conflict, conflicts)
+            err << "conflict: " << conflict << endl;
+
+        QString errorString;
+        if (!merged.saveFile(process.outputDirectory, process.targetVersion, process.compressed, &errorString))
+        {
+            err << process.outputDirectory << ": error: " << errorString << endl;
+            return 1;
+        }
+
+        out << conflicts.size() << " conflicts, loaded in " << loaded << " ms, merged in " << mergeTime << " ms" << endl;
+        return conflicts.isEmpty() ? 0 : 1;
+    }
+
+    if (process.command != "stats" && process.command != "validate" && process.command != "convert")
+    {
+        err << "Unknown command " << process.command << endl;
+        return 1;
+    }
+
+    if (process.command == "convert" && process.outputDirectory.isEmpty())
+    {
+        err << "convert needs --output" << endl;
+        return 1;
+    }
+
+    if (parser.isSet(jobsOption))
+        QThreadPool::globalInstance()->setMaxThreadCount(qMax(1, parser.value(jobsOption).toInt()));
+
+    const QVector<InputFile> inputs = collectInputs(arguments, QStringList() << parser.value(filterOption));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QList<FileResult> results = QtConcurrent::blockingMapped<QList<FileResult> >(inputs, process);
+
+    const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+    qint64 bytes = 0;
+
+    QNodeViewGraphStatistics total;
+    qint32 failures = 0;
+
+    Q_FOREACH (const FileResult& result, results)
+    {
+        bytes += result.bytes;
+
+        if (!result.error.isEmpty())
+        {
+            err << result.path << ": error: " << result.error << endl;
+            ++failures;
+            continue;
+        }
+
+        Q_FOREACH (const QString& problem, result.problems)
+            err << result.path << ": " << problem << endl;
+
+        if (!result.ok)
+            ++failures;
+
+        total.blocks += result.statistics.blocks;
+        total.groups += result.statistics.groups;
+        total.ports += result.statistics.ports;
+        total.connections += result.statistics.connections;
+        total.splits += result.statistics.splits;
+
+        if (process.command == "stats")
+        {
+            out << result.path
+                << ": version " << result.version
+                << ", " << result.statistics.blocks << " blocks"
+                << ", " << result.statistics.groups << " groups"
+                << ", " << result.statistics.ports << " ports"
+                << ", " << result.statistics.connections << " connections"
+                << ", " << result.statistics.splits << " splits" << endl;
+        }
+    }
+
+    out << results.size() << " files, " << failures << " failed";
+
+    if (process.command == "stats")
+    {
+        out << ", " << total.blocks << " blocks"
+            << ", " << total.groups << " groups"
+            << ", " << total.ports << " ports"
+            << ", " << total.connections << " connections"
+            << ", " << total.splits << " splits";
+    }
+
+    out << " in " << elapsed << " ms (" << QString::number(bytes / 1048576.0 * 1000.0 / elapsed, 'f', 1) << " MB/s)" << endl;
+
+    return failures ? 1 : 0;
+}
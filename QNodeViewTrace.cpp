@@ -0,0 +1,198 @@
+/*!
+  @file    QNodeViewTrace.cpp
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+
+#include <QNodeViewTrace.h>
+
+namespace
+{
+    // Events kept per thread, older ones are overwritten
+    const quint32 s_capacity = 16384;
+
+    struct Event
+    {
+        const char* name;
+        qint64 start;
+        qint64 end;
+    };
+
+    struct ThreadBuffer
+    {
+        ThreadBuffer() : threadId(0) {}
+
+        Event events[s_capacity];
+
+        // Total events written, only ever advanced by the owning thread
+        QAtomicInteger<quint64> written;
+
+        qint32 threadId;
+        QString threadName;
+    };
+
+    QMutex& registryMutex()
+    {
+        static QMutex mutex;
+        return mutex;
+    }
+
+    // Buffers outlive their threads so events can still be exported afterwards
+    QVector<ThreadBuffer*>& registry()
+    {
+        static QVector<ThreadBuffer*> buffers;
+        return buffers;
+    }
+
+    thread_local ThreadBuffer* t_buffer = NULL;
+
+    ThreadBuffer* registerThread()
+    {
+        ThreadBuffer* buffer = new ThreadBuffer();
+
+        QThread* thread = QThread::currentThread();
+        buffer->threadName = thread->objectName();
+
+        if (buffer->threadName.isEmpty())
+        {
+            const bool mainThread = QCoreApplication::instance() && QCoreApplication::instance()->thread() == thread;
+            buffer->threadName = mainThread ? QString("Main") : QString("Thread");
+        }
+
+        QMutexLocker locker(&registryMutex());
+        buffer->threadId = registry().size() + 1;
+        registry().append(buffer);
+
+        t_buffer = buffer;
+        return buffer;
+    }
+
+    QElapsedTimer startedTimer()
+    {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }
+
+    void appendEscaped(QByteArray& output, const QByteArray& text)
+    {
+        Q_FOREACH (char character, text)
+        {
+            if (character == '"' || character == '\\')
+                output.append('\\');
+
+            output.append(character);
+        }
+    }
+}
+
+QAtomicInt QNodeViewTrace::s_enabled(0);
+
+qint64 QNodeViewTrace::now()
+{
+    static const QElapsedTimer timer = startedTimer();
+    return timer.nsecsElapsed();
+}
+
+void QNodeViewTrace::record(const char* name, qint64 start, qint64 end)
+{
+    ThreadBuffer* buffer = t_buffer;
+    if (!buffer)
+        buffer = registerThread();
+
+    const quint64 index = buffer->written.load();
+
+    Event& event = buffer->events[index % s_capacity];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+
+    // Publish the event to a concurrent export
+    buffer->written.storeRelease(index + 1);
+}
+
+QByteArray QNodeViewTrace::chromeTrace()
+{
+    QVector<ThreadBuffer*> buffers;
+
+    {
+        QMutexLocker locker(&registryMutex());
+        buffers = registry();
+    }
+
+    QByteArray output;
+    output.append("{\"traceEvents\":[");
+
+    bool first = true;
+
+    Q_FOREACH (ThreadBuffer* buffer, buffers)
+    {
+        if (!first)
+            output.append(',');
+
+        first = false;
+
+        output.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        output.append(QByteArray::number(buffer->threadId));
+        output.append(",\"args\":{\"name\":\"");
+        appendEscaped(output, buffer->threadName.toUtf8());
+        output.append("\"}}");
+
+        // Events being overwritten while exporting may come out torn, which only affects the oldest ones
+        const quint64 written = buffer->written.loadAcquire();
+        const quint64 begin = written > s_capacity ? written - s_capacity : 0;
+
+        for (quint64 index = begin; index < written; ++index)
+        {
+            const Event event = buffer->events[index % s_capacity];
+
+            output.append(",{\"name\":\"");
+            appendEscaped(output, QByteArray(event.name));
+            output.append("\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+            output.append(QByteArray::number(buffer->threadId));
+            output.append(",\"ts\":");
+            output.append(QByteArray::number(event.start / 1000.0, 'f', 3));
+            output.append(",\"dur\":");
+            output.append(QByteArray::number((event.end - event.start) / 1000.0, 'f', 3));
+            output.append('}');
+        }
+    }
+
+    output.append("]}");
+    return output;
+}
+
+bool QNodeViewTrace::writeChromeTrace(const QString& fileName, QString* errorString)
+{
+    QSaveFile file(fileName);
+
+    if (file.open(QFile::WriteOnly) && file.write(chromeTrace()) >= 0 && file.commit())
+        return true;
+
+    if (errorString)
+        *errorString = file.errorString();
+
+    return false;
+}
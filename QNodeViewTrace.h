@@ -0,0 +1,86 @@
+/*!
+  @file    QNodeViewTrace.h
+
+  Copyright (c) 2014 Graham Wihlidal
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @author  Graham Wihlidal
+  @date    January 19, 2014
+*/
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QString>
+
+/*!
+    Scoped trace points recorded into per-thread ring buffers.
+
+    Trace points are only compiled in when QNODEVIEW_TRACING is defined
+    (qmake CONFIG+=qnodeview_tracing). When compiled in but disabled at run
+    time, a trace point costs a single relaxed load and branch. Recording
+    never locks: each thread writes to its own ring buffer, and only the
+    first event on a new thread takes a mutex to register the buffer.
+
+    The most recent events of every thread can be exported in the Chrome
+    trace event format, which chrome://tracing and Perfetto both open.
+*/
+class QNodeViewTrace
+{
+public:
+    static void setEnabled(bool enabled) { s_enabled.store(enabled ? 1 : 0); }
+    static bool isEnabled() { return s_enabled.load() != 0; }
+
+    // Nanoseconds since tracing was first used
+    static qint64 now();
+    static void record(const char* name, qint64 start, qint64 end);
+
+    static QByteArray chromeTrace();
+    static bool writeChromeTrace(const QString& fileName, QString* errorString = NULL);
+
+private:
+    static QAtomicInt s_enabled;
+};
+
+class QNodeViewTraceScope
+{
+public:
+    explicit QNodeViewTraceScope(const char* name)
+    : m_name(QNodeViewTrace::isEnabled() ? name : NULL)
+    , m_start(m_name ? QNodeViewTrace::now() : 0)
+    {
+    }
+
+    ~QNodeViewTraceScope()
+    {
+        if (m_name)
+            QNodeViewTrace::record(m_name, m_start, QNodeViewTrace::now());
+    }
+
+private:
+    Q_DISABLE_COPY(QNodeViewTraceScope)
+
+    const char* m_name;
+    qint64 m_start;
+};
+
+#define QNODEVIEW_TRACE_CONCAT_(a, b) a##b
+#define QNODEVIEW_TRACE_CONCAT(a, b) QNODEVIEW_TRACE_CONCAT_(a, b)
+
+#ifdef QNODEVIEW_TRACING
+#define QNODEVIEW_TRACE_SCOPE(name) QNodeViewTraceScope QNODEVIEW_TRACE_CONCAT(qNodeViewTraceScope, __LINE__)(name)
+#else
+#define QNODEVIEW_TRACE_SCOPE(name) do {} while (false)
+#endif
@@ -0,0 +1,65 @@
+#/*!  @file    QNodeViewWidgets.pro
+#
+#  Copyright (c) 2014 Graham Wihlidal
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+#  @author  Graham Wihlidal
+#  @date    January 19, 2014
+#*/
+
+TARGET = QNodeViewWidgets
+TEMPLATE = lib
+
+CONFIG += staticlib c++11
+QT += core gui widgets
+
+# Build with qmake CONFIG+=qnodeview_tracing to compile in the trace points
+qnodeview_tracing: DEFINES += QNODEVIEW_TRACING
+
+DESTDIR = $$OUT_PWD
+
+SOURCES +=  \
+            QNodeViewEditor.cpp \
+            QNodeViewPort.cpp \
+            QNodeViewConnection.cpp \
+            QNodeViewBlock.cpp \
+            QNodeViewGroup.cpp \
+            QNodeViewCanvas.cpp \
+            QNodeViewChromeCache.cpp \
+            QNodeViewScene.cpp \
+            QNodeViewSceneIndex.cpp \
+            QNodeViewNodeTypeRegistry.cpp \
+            QNodeViewEventRecorder.cpp \
+            QNodeViewSearchBox.cpp \
+            QNodeViewFocus.cpp \
+            QNodeViewAnimator.cpp \
+            QNodeViewProbeSampler.cpp
+
+HEADERS  += \
+            QNodeViewEditor.h \
+            QNodeViewPort.h \
+            QNodeViewConnection.h \
+            QNodeViewBlock.h \
+            QNodeViewGroup.h \
+            QNodeViewCommon.h \
+            QNodeViewCanvas.h \
+            QNodeViewChromeCache.h \
+            QNodeViewScene.h \
+            QNodeViewSceneIndex.h \
+            QNodeViewNodeTypeRegistry.h \
+            QNodeViewEventRecorder.h \
+            QNodeViewSearchBox.h \
+            QNodeViewFocus.h \
+            QNodeViewAnimator.h \
+            QNodeViewProbeSampler.h